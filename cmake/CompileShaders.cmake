@@ -14,10 +14,12 @@ find_program(GLSL_VALIDATOR glslangValidator HINTS
         $ENV{VULKAN_SDK}/Bin32/
 )
 
-# get all .vert and .frag files in shaders directory
+# get all .vert, .frag, .comp and .mesh files in shaders directory
 file(GLOB_RECURSE GLSL_SOURCE_FILES
         "${PROJECT_SOURCE_DIR}/shaders/*.frag"
         "${PROJECT_SOURCE_DIR}/shaders/*.vert"
+        "${PROJECT_SOURCE_DIR}/shaders/*.comp"
+        "${PROJECT_SOURCE_DIR}/shaders/*.mesh"
 )
 
 foreach(GLSL ${GLSL_SOURCE_FILES})
@@ -25,7 +27,7 @@ foreach(GLSL ${GLSL_SOURCE_FILES})
     set(SPIRV "${PROJECT_SOURCE_DIR}/shaders/${FILE_NAME}.spv")
     add_custom_command(
             OUTPUT ${SPIRV}
-            COMMAND ${GLSL_VALIDATOR} -V ${GLSL} -o ${SPIRV}
+            COMMAND ${GLSL_VALIDATOR} -V --target-env vulkan1.3 ${GLSL} -o ${SPIRV}
             DEPENDS ${GLSL})
     list(APPEND SPIRV_BINARY_FILES ${SPIRV})
 endforeach(GLSL)
@@ -0,0 +1,127 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include "model/obj_loader.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Checks that IdaObjLoader returns exactly what tinyobj::LoadObj does for the bundled models, at
+// several thread counts
+namespace {
+const std::string MODEL_DIR = std::string(PROJECT_SOURCE_DIR) + "tests/shaderMgrTest/models/";
+const char* MODELS[] = {"colored_cube.obj", "cube.obj", "flat_vase.obj", "quad.obj", "smooth_vase.obj"};
+const uint32_t THREAD_COUNTS[] = {1, 2, 4, 16};
+
+// one triangle corner with every attribute resolved, compared bit for bit
+struct Corner {
+    float position[3]{};
+    float color[3]{};
+    float normal[3]{};
+    float uv[2]{};
+};
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+std::vector<Corner> LoadTinyObj(const std::string& contents, const std::string& name) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    std::istringstream stream(contents);
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream)) {
+        throw std::runtime_error("tinyobj failed to load " + name + ": " + err);
+    }
+    std::vector<Corner> corners;
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            Corner corner{};
+            if (index.vertex_index >= 0) {
+                std::memcpy(corner.position, &attrib.vertices[3 * index.vertex_index], sizeof(corner.position));
+                std::memcpy(corner.color, &attrib.colors[3 * index.vertex_index], sizeof(corner.color));
+            }
+            if (index.normal_index >= 0) {
+                std::memcpy(corner.normal, &attrib.normals[3 * index.normal_index], sizeof(corner.normal));
+            }
+            if (index.texcoord_index >= 0) {
+                std::memcpy(corner.uv, &attrib.texcoords[2 * index.texcoord_index], sizeof(corner.uv));
+            }
+            corners.push_back(corner);
+        }
+    }
+    return corners;
+}
+
+std::vector<Corner> LoadIdaObj(const std::string& contents, const std::string& name, uint32_t threadCount) {
+    ida::ObjMesh mesh = ida::IdaObjLoader::Parse(contents.data(), contents.size(), threadCount, name);
+    std::vector<Corner> corners;
+    for (const auto& index : mesh.indices) {
+        Corner corner{};
+        if (index.vertex >= 0) {
+            std::memcpy(corner.position, &mesh.positions[3 * index.vertex], sizeof(corner.position));
+            std::memcpy(corner.color, &mesh.colors[3 * index.vertex], sizeof(corner.color));
+        }
+        if (index.normal >= 0) {
+            std::memcpy(corner.normal, &mesh.normals[3 * index.normal], sizeof(corner.normal));
+        }
+        if (index.texcoord >= 0) {
+            std::memcpy(corner.uv, &mesh.texcoords[2 * index.texcoord], sizeof(corner.uv));
+        }
+        corners.push_back(corner);
+    }
+    return corners;
+}
+
+// returns the number of thread counts whose result differs from tinyobj
+int Compare(const std::string& contents, const std::string& name) {
+    auto expected = LoadTinyObj(contents, name);
+    int failures = 0;
+    for (uint32_t threadCount : THREAD_COUNTS) {
+        auto actual = LoadIdaObj(contents, name, threadCount);
+        bool same = actual.size() == expected.size() && std::memcmp(actual.data(), expected.data(), actual.size() * sizeof(Corner)) == 0;
+        std::cout << (same ? "[PASS] " : "[FAIL] ") << name << ", " << threadCount << " threads: " << actual.size()
+                  << " corners, tinyobj " << expected.size() << '\n';
+        failures += same ? 0 : 1;
+    }
+    return failures;
+}
+} // namespace
+
+int main() {
+    int failures = 0;
+    try {
+        std::string combined;
+        for (const char* model : MODELS) {
+            std::string contents = ReadFile(MODEL_DIR + model);
+            failures += Compare(contents, model);
+            combined += contents;
+            combined += '\n';
+        }
+        // every bundled model fits in one chunk, repeated they are split at every thread count above;
+        // faces of later copies reference the vertices of the first, which is valid OBJ
+        std::string repeated;
+        while (repeated.size() < 16 * ida::IdaObjLoader::MIN_CHUNK_SIZE) {
+            repeated += combined;
+        }
+        failures += Compare(repeated, "all models repeated");
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,51 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  uint meshletOffset;
+  uint meshletCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint batch;
+  float scale;
+  uint padding0;
+  uint padding1;
+};
+
+layout(set = 1, binding = 1) readonly buffer Instances {
+  Instance instances[];
+};
+
+void main() {
+  // the culling shader stores the instance in firstInstance
+  Instance instance = instances[gl_InstanceIndex];
+  vec4 positionWorld = instance.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+}
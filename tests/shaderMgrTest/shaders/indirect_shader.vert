@@ -0,0 +1,47 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+struct Object {
+  vec4 modelRows[3];
+  uint mesh;
+  float scale;
+  uint padding0;
+  uint padding1;
+};
+
+layout(set = 1, binding = 0) readonly buffer Objects {
+  Object objects[];
+};
+
+void main() {
+  // the culling shader stores the object in firstInstance
+  Object object = objects[gl_InstanceIndex];
+  mat4 modelMatrix = transpose(mat4(object.modelRows[0], object.modelRows[1], object.modelRows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+  vec4 positionWorld = modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(transpose(inverse(mat3(modelMatrix))) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+}
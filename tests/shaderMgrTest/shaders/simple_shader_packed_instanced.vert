@@ -0,0 +1,43 @@
+#version 450
+
+// IdaModel::PackedVertex, the normalized formats arrive already expanded to floats
+layout(location = 0) in vec3 position; // snorm16 inside the model bounds
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 normal; // octahedral snorm16
+layout(location = 3) in vec2 uv; // unorm16 inside the model uv bounds
+// per instance, from the instance buffer of SimpleRenderSystem
+layout(location = 4) in mat4 instanceModelMatrix; // already multiplied with the model's dequantize matrix
+layout(location = 8) in mat4 instanceNormalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+  return normalize(n);
+}
+
+void main() {
+  vec4 positionWorld = instanceModelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(instanceNormalMatrix) * decodeOctahedral(normal));
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+}
@@ -4,6 +4,8 @@
 #include "core/keyboard_controller.hpp"
 #include "global_info.hpp"
 #include "swapchain/swapchain.hpp"
+#include "system/cluster_render_system.hpp"
+#include "system/indirect_render_system.hpp"
 #include "system/point_light_system.hpp"
 #include "system/triangle_render_system.hpp"
 #include "system/simple_render_system.hpp"
@@ -21,8 +23,8 @@ Application::Application(const std::string& title, int width, int height) {
 
     // Init global descriptor pool
     globalPool = ida::IdaDescriptorPool::Builder()
-                     .SetMaxSets(ida::IdaSwapChain::MAX_FRAMES_IN_FLIGHT)
-                     .AddPoolSize(vk::DescriptorType::eUniformBuffer, ida::IdaSwapChain::MAX_FRAMES_IN_FLIGHT)
+                     .SetMaxSets(1)
+                     .AddPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1)
                      .Build();
 
     LoadGameObjects();
@@ -38,26 +40,17 @@ Application::~Application() {
 }
 
 int Application::Run() {
-    std::vector<std::unique_ptr<ida::IdaBuffer>> uboBuffers(ida::IdaSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < uboBuffers.size(); i++) {
-        uboBuffers[i] = std::make_unique<ida::IdaBuffer>(
-            ida::BufferType::UniformBuffer,
-            sizeof(ida::GlobalUbo),
-            1,
-            vk::BufferUsageFlagBits::eUniformBuffer,
-            vk::MemoryPropertyFlagBits::eHostVisible);
-        uboBuffers[i]->Map();
-    }
+    // the global UBO is written into the renderer's frame allocator every frame, one descriptor set
+    // covers every frame in flight through its dynamic offset
+    auto& frameAllocator = renderer_->GetFrameAllocator();
     auto globalSetLayout = ida::IdaDescriptorSetLayout::Builder()
-                               .AddBinding(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eAllGraphics)
+                               .AddBinding(0, vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eAllGraphics)
                                .Build();
-    std::vector<vk::DescriptorSet> globalDescriptorSets(ida::IdaSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < globalDescriptorSets.size(); i++) {
-        auto bufferInfo = uboBuffers[i]->GetDescriptorInfo();
-        ida::IdaDescriptorWriter(*globalSetLayout, *globalPool)
-            .WriteBuffer(0, &bufferInfo)
-            .Build(globalDescriptorSets[i]);
-    }
+    vk::DescriptorSet globalDescriptorSet;
+    auto bufferInfo = frameAllocator.GetDescriptorInfo(sizeof(ida::GlobalUbo));
+    ida::IdaDescriptorWriter(*globalSetLayout, *globalPool)
+        .WriteBuffer(0, &bufferInfo)
+        .Build(globalDescriptorSet);
 
     ida::SimpleRenderSystem simpleRenderSystem{
         renderer_->GetRenderPass(),
@@ -67,6 +60,26 @@ int Application::Run() {
         renderer_->GetRenderPass(),
         globalSetLayout->GetDescriptorSetLayout(),
     };
+    ida::ClusterRenderSystem clusterRenderSystem{
+        renderer_->GetRenderPass(),
+        globalSetLayout->GetDescriptorSetLayout(),
+    };
+    ida::IndirectRenderSystem indirectRenderSystem{
+        renderer_->GetRenderPass(),
+        globalSetLayout->GetDescriptorSetLayout(),
+    };
+    // a field of small vases registered once, then culled and drawn on the GPU every frame
+    ida::Context::GetInstance().assetRegistry->AcquireModelAsync("models/smooth_vase.obj", {}, [&indirectRenderSystem](std::shared_ptr<ida::IdaModel> model) {
+        constexpr int FIELD_SIZE = 128;
+        for (int x = 0; x < FIELD_SIZE; x++) {
+            for (int z = 0; z < FIELD_SIZE; z++) {
+                ida::TransformComponent transform{};
+                transform.translation = {(x - FIELD_SIZE / 2) * .25f, .5f, 2.f + z * .25f};
+                transform.scale = {.3f, .15f, .3f};
+                indirectRenderSystem.AddObject(model, transform.mat4());
+            }
+        }
+    });
     //    ida::TriangleRenderSystem triangleRenderSystem{
     //        renderer_->GetRenderPass(),
     //        globalSetLayout->GetDescriptorSetLayout(),
@@ -92,6 +105,9 @@ int Application::Run() {
         camera.SetViewYXZ(viewObject.transform.translation, viewObject.transform.rotation);
         float aspect = renderer_->GetAspectRatio();
         camera.SetPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.0f);
+        // hands finished background imports to their game objects
+        ida::Context::GetInstance().modelLoader->Update();
+        ida::Context::GetInstance().assetRegistry->Update();
 
         if (auto commandBuffer = renderer_->BeginFrame()) {
             int frameIndex = renderer_->GetCurrentFrameIndex();
@@ -100,8 +116,11 @@ int Application::Run() {
                 frameTime,
                 commandBuffer,
                 camera,
-                globalDescriptorSets[frameIndex],
+                globalDescriptorSet,
                 gameObjects_,
+                frameAllocator,
+                0,
+                renderer_->GetExtent(),
             };
             // update global UBO
             ida::GlobalUbo globalUbo{};
@@ -109,12 +128,16 @@ int Application::Run() {
             globalUbo.projection = camera.GetProjection();
             globalUbo.inverseView = camera.GetInverseView();
             pointLightSystem.Update(frameInfo, globalUbo);
-            uboBuffers[frameIndex]->WriteToBuffer(&globalUbo);
-            uboBuffers[frameIndex]->Flush();
+            frameInfo.globalUboOffset = frameAllocator.Push(globalUbo).dynamicOffset;
 
+            // meshlet and object culling write the indirect draws, so they run before the render pass
+            clusterRenderSystem.Cull(frameInfo);
+            indirectRenderSystem.Cull(frameInfo);
             renderer_->BeginSwapChainRenderPass(commandBuffer);
             {
                 simpleRenderSystem.RenderGameObjects(frameInfo);
+                clusterRenderSystem.Render(frameInfo);
+                indirectRenderSystem.Render(frameInfo);
                 pointLightSystem.Render(frameInfo);
                 //                triangleRenderSystem.Render(frameInfo);
             }
@@ -127,23 +150,27 @@ int Application::Run() {
 }
 
 void Application::LoadGameObjects() {
-    std::shared_ptr<ida::IdaModel> model = ida::IdaModel::ImportModel("models/flat_vase.obj");
+    ida::IdaModel::ImportOptions packed{};
+    packed.vertexFormat = ida::VertexFormat::Packed;
+    packed.optimize = true;
     auto vase = ida::IdaGameObject::CreateGameObject(ida::GameObjectType::Model);
-    vase.model = model;
+    LoadModelAsync(vase.GetId(), "models/flat_vase.obj", packed);
     vase.transform.translation = {-.5f, .5f, 0.f};
     vase.transform.scale = {3.f, 1.5f, 3.f};
     gameObjects_.emplace(vase.GetId(), std::move(vase));
 
-    model = ida::IdaModel::ImportModel("models/smooth_vase.obj");
+    // split into meshlets and culled per cluster on the GPU, which needs float vertices
+    ida::IdaModel::ImportOptions clustered{};
+    clustered.optimize = true;
+    clustered.buildMeshlets = true;
     auto vase2 = ida::IdaGameObject::CreateGameObject(ida::GameObjectType::Model);
-    vase2.model = model;
+    LoadModelAsync(vase2.GetId(), "models/smooth_vase.obj", clustered);
     vase2.transform.translation = {.5f, .5f, 0.f};
     vase2.transform.scale = {3.f, 1.5f, 3.f};
     gameObjects_.emplace(vase2.GetId(), std::move(vase2));
 
-    model = ida::IdaModel::ImportModel("models/quad.obj");
     auto quad = ida::IdaGameObject::CreateGameObject(ida::GameObjectType::Model);
-    quad.model = model;
+    LoadModelAsync(quad.GetId(), "models/quad.obj");
     quad.transform.translation = {0.f, .5f, 0.f};
     quad.transform.scale = {300.f, 100.f, 300.f};
     gameObjects_.emplace(quad.GetId(), std::move(quad));
@@ -180,3 +207,14 @@ void Application::LoadGameObjects() {
         gameObjects_.emplace(pointLight.GetId(), std::move(pointLight));
     }
 }
+
+void Application::LoadModelAsync(ida::IdaGameObject::id_t id, const std::string& path, const ida::IdaModel::ImportOptions& options) {
+    // objects sharing a mesh, or a scene loaded again, share one import through the registry
+    ida::Context::GetInstance().assetRegistry->AcquireModelAsync(path, options, [this, id](std::shared_ptr<ida::IdaModel> model) {
+        // the object may have been removed while its model was loading
+        auto it = gameObjects_.find(id);
+        if (it != gameObjects_.end()) {
+            it->second.model = std::move(model);
+        }
+    });
+}
@@ -27,6 +27,8 @@ class Application {
     ida::IdaGameObject::Map gameObjects_;
 
     void LoadGameObjects();
+    // Imports in the background, the object draws nothing until the model is resident
+    void LoadModelAsync(ida::IdaGameObject::id_t id, const std::string& path, const ida::IdaModel::ImportOptions& options = {});
 };
 
 #endif // VULKAN_LIB_APP_HPP
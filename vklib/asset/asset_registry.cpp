@@ -0,0 +1,359 @@
+#include "asset_registry.hpp"
+
+#include "core/mapped_file.hpp"
+#include "log/log.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ida {
+namespace {
+struct PathKey {
+    std::string path;
+    uint64_t optionsHash = 0;
+
+    bool operator==(const PathKey& other) const { return optionsHash == other.optionsHash && path == other.path; }
+};
+
+struct PathKeyHash {
+    size_t operator()(const PathKey& key) const { return static_cast<size_t>(hashBytes(key.path.data(), key.path.size(), key.optionsHash)); }
+};
+
+// what the file looked like when its path was resolved
+struct FileStamp {
+    uintmax_t size = 0;
+    std::filesystem::file_time_type time{};
+
+    bool operator==(const FileStamp& other) const { return size == other.size && time == other.time; }
+};
+
+uint64_t HashOptions(const IdaModel::ImportOptions& options) {
+    uint64_t hash = hashBytes(&options.weld, sizeof(WeldOptions));
+    uint32_t optimize = options.optimize ? 1 : 0;
+    hash = hashBytes(&optimize, sizeof(optimize), hash);
+    hash = hashBytes(&options.lod, sizeof(LodOptions), hash);
+    uint32_t format = static_cast<uint32_t>(options.vertexFormat);
+    hash = hashBytes(&format, sizeof(format), hash);
+    uint32_t meshlets = options.buildMeshlets ? 1 : 0;
+    return hashBytes(&meshlets, sizeof(meshlets), hash);
+}
+
+PathKey MakeKey(const std::string& path, const IdaModel::ImportOptions& options) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return {error ? path : canonical.string(), HashOptions(options)};
+}
+
+FileStamp StampFile(const std::string& path) {
+    FileStamp stamp;
+    std::error_code error;
+    stamp.size = std::filesystem::file_size(path, error);
+    stamp.time = std::filesystem::last_write_time(path, error);
+    return stamp;
+}
+} // namespace
+
+// ****** State ******
+// Shared with the handles, whose deleters can run on any thread and after the registry is gone
+struct IdaAssetRegistry::State {
+    struct Entry {
+        // keeps the model alive while it is in use or cached, the handles share its ownership
+        std::shared_ptr<IdaModel> model;
+        std::weak_ptr<IdaModel> handle;
+        // bumped with every new handle, so a late release of an older one is ignored
+        uint64_t handleGeneration = 0;
+        uint64_t contentHash = 0;
+        uint64_t optionsHash = 0;
+        vk::DeviceSize size = 0;
+        bool released = false;
+        uint64_t releaseOrder = 0;
+    };
+    struct PathEntry {
+        uint64_t id = 0;
+        FileStamp stamp;
+    };
+    struct Waiter {
+        ModelHandle handle; // set once the import finished
+        std::promise<std::shared_ptr<IdaModel>> promise;
+        IdaModelLoader::Callback onResident;
+    };
+    struct Loading {
+        IdaModelLoader::Future future;
+        FileStamp stamp;
+        std::vector<Waiter> waiters;
+    };
+
+    std::weak_ptr<State> self;
+    mutable std::mutex mutex;
+
+    std::unordered_map<uint64_t, Entry> entries;
+    std::unordered_map<PathKey, PathEntry, PathKeyHash> paths;
+    std::map<std::pair<uint64_t, uint64_t>, uint64_t> contents; // (content, options) hash
+    std::unordered_map<PathKey, Loading, PathKeyHash> loading;
+    std::vector<Waiter> waiting; // imported, completed once resident
+    uint64_t nextId = 1;
+    uint64_t releaseCounter = 0;
+
+    vk::DeviceSize memoryBudget = 0;
+    vk::DeviceSize totalBytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    bool FindPathLocked(const PathKey& key, const FileStamp& stamp, uint64_t& id) {
+        auto it = paths.find(key);
+        if (it == paths.end()) {
+            return false;
+        }
+        if (!(it->second.stamp == stamp)) {
+            // edited since, the old contents stay cached under their hash until evicted
+            paths.erase(it);
+            return false;
+        }
+        id = it->second.id;
+        return true;
+    }
+
+    uint64_t InstallLocked(const PathKey& key, const FileStamp& stamp, std::shared_ptr<IdaModel> model) {
+        auto content = contents.find({model->GetSourceHash(), key.optionsHash});
+        uint64_t id;
+        if (content != contents.end()) {
+            // another path already loaded these contents, the new import is dropped
+            id = content->second;
+        } else {
+            id = nextId++;
+            Entry& entry = entries[id];
+            entry.contentHash = model->GetSourceHash();
+            entry.optionsHash = key.optionsHash;
+            entry.size = model->GetMemorySize();
+            entry.model = std::move(model);
+            contents[{entry.contentHash, entry.optionsHash}] = id;
+            totalBytes += entry.size;
+        }
+        paths[key] = {id, stamp};
+        return id;
+    }
+
+    ModelHandle MakeHandleLocked(uint64_t id) {
+        Entry& entry = entries.at(id);
+        if (ModelHandle handle = entry.handle.lock()) {
+            return handle;
+        }
+        entry.released = false;
+        uint64_t generation = ++entry.handleGeneration;
+        // the deleter owns a reference of its own, so the model outlives an eviction, or the
+        // registry, until the last handle goes
+        ModelHandle handle(entry.model.get(), [owner = entry.model, state = self, id, generation](IdaModel*) {
+            if (auto locked = state.lock()) {
+                locked->Release(id, generation);
+            }
+        });
+        entry.handle = handle;
+        return handle;
+    }
+
+    void Release(uint64_t id, uint64_t generation) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(id);
+        if (it == entries.end() || it->second.handleGeneration != generation) {
+            return;
+        }
+        it->second.released = true;
+        it->second.releaseOrder = ++releaseCounter;
+        EvictLocked(memoryBudget);
+    }
+
+    // Evicts released entries, least recently released first, until the total fits the budget
+    void EvictLocked(vk::DeviceSize budget) {
+        while (totalBytes > budget) {
+            auto oldest = entries.end();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->second.released && (oldest == entries.end() || it->second.releaseOrder < oldest->second.releaseOrder)) {
+                    oldest = it;
+                }
+            }
+            if (oldest == entries.end()) {
+                return;
+            }
+            uint64_t id = oldest->first;
+            for (auto path = paths.begin(); path != paths.end();) {
+                path = path->second.id == id ? paths.erase(path) : std::next(path);
+            }
+            contents.erase({oldest->second.contentHash, oldest->second.optionsHash});
+            totalBytes -= oldest->second.size;
+            entries.erase(oldest);
+            evictions++;
+        }
+    }
+};
+
+// ****** IdaAssetRegistry ******
+IdaAssetRegistry::IdaAssetRegistry(IdaModelLoader& loader, vk::DeviceSize memoryBudget)
+    : loader_(loader), state_(std::make_shared<State>()) {
+    state_->self = state_;
+    state_->memoryBudget = memoryBudget;
+}
+
+IdaAssetRegistry::~IdaAssetRegistry() = default;
+
+IdaAssetRegistry::ModelHandle IdaAssetRegistry::AcquireModel(const std::string& path, const IdaModel::ImportOptions& options) {
+    PathKey key = MakeKey(path, options);
+    FileStamp stamp = StampFile(key.path);
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->FindPathLocked(key, stamp, id)) {
+            state_->hits++;
+            return state_->MakeHandleLocked(id);
+        }
+    }
+
+    // a path not seen yet may still be a copy of something loaded, hashing is far cheaper than importing
+    uint64_t contentHash;
+    {
+        IdaMappedFile file(path);
+        contentHash = hashBytes(file.GetData(), file.GetSize());
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        auto content = state_->contents.find({contentHash, key.optionsHash});
+        if (content != state_->contents.end()) {
+            state_->paths[key] = {content->second, stamp};
+            state_->hits++;
+            return state_->MakeHandleLocked(content->second);
+        }
+        state_->misses++;
+    }
+
+    std::shared_ptr<IdaModel> model = IdaModel::ImportModel(path, options);
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    ModelHandle handle = state_->MakeHandleLocked(state_->InstallLocked(key, stamp, std::move(model)));
+    state_->EvictLocked(state_->memoryBudget);
+    return handle;
+}
+
+IdaModelLoader::Future IdaAssetRegistry::AcquireModelAsync(const std::string& path, const IdaModel::ImportOptions& options, IdaModelLoader::Callback onResident) {
+    PathKey key = MakeKey(path, options);
+    FileStamp stamp = StampFile(key.path);
+    State::Waiter waiter;
+    waiter.onResident = std::move(onResident);
+    IdaModelLoader::Future future = waiter.promise.get_future().share();
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    uint64_t id;
+    if (state_->FindPathLocked(key, stamp, id)) {
+        state_->hits++;
+        waiter.handle = state_->MakeHandleLocked(id);
+        state_->waiting.push_back(std::move(waiter));
+        return future;
+    }
+    auto loading = state_->loading.find(key);
+    if (loading != state_->loading.end() && loading->second.stamp == stamp) {
+        state_->hits++;
+        loading->second.waiters.push_back(std::move(waiter));
+        return future;
+    }
+
+    // the contents are compared once the worker hashed them, see State::InstallLocked()
+    state_->misses++;
+    if (loading == state_->loading.end()) {
+        loading = state_->loading.emplace(key, State::Loading{}).first;
+    }
+    // a file that changed while it was loading is imported again, the result of the outdated
+    // import is dropped and the waiters already queued get the new one together with this waiter
+    State::Loading& request = loading->second;
+    request.future = loader_.ImportAsync(path, options);
+    request.stamp = stamp;
+    request.waiters.push_back(std::move(waiter));
+    return future;
+}
+
+void IdaAssetRegistry::Update() {
+    std::vector<State::Waiter> resident;
+    std::vector<std::pair<State::Waiter, std::exception_ptr>> failed;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        for (auto it = state_->loading.begin(); it != state_->loading.end();) {
+            State::Loading& request = it->second;
+            if (request.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            std::shared_ptr<IdaModel> model;
+            try {
+                model = request.future.get();
+            } catch (...) {
+                for (auto& waiter : request.waiters) {
+                    failed.emplace_back(std::move(waiter), std::current_exception());
+                }
+                it = state_->loading.erase(it);
+                continue;
+            }
+            ModelHandle handle = state_->MakeHandleLocked(state_->InstallLocked(it->first, request.stamp, std::move(model)));
+            for (auto& waiter : request.waiters) {
+                waiter.handle = handle;
+                state_->waiting.push_back(std::move(waiter));
+            }
+            it = state_->loading.erase(it);
+        }
+
+        auto ready = std::stable_partition(state_->waiting.begin(), state_->waiting.end(), [](const State::Waiter& waiter) {
+            return !waiter.handle->IsResident();
+        });
+        std::move(ready, state_->waiting.end(), std::back_inserter(resident));
+        state_->waiting.erase(ready, state_->waiting.end());
+        state_->EvictLocked(state_->memoryBudget);
+    }
+
+    // outside the lock, a callback may acquire again or drop the last handle of something
+    for (auto& [waiter, error] : failed) {
+        waiter.promise.set_exception(error);
+    }
+    for (auto& waiter : resident) {
+        waiter.promise.set_value(waiter.handle);
+        if (waiter.onResident) {
+            waiter.onResident(waiter.handle);
+        }
+    }
+}
+
+void IdaAssetRegistry::SetMemoryBudget(vk::DeviceSize bytes) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->memoryBudget = bytes;
+    state_->EvictLocked(bytes);
+}
+
+void IdaAssetRegistry::Trim() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->EvictLocked(0);
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Asset registry trimmed, {} assets still in use", state_->entries.size());
+}
+
+AssetRegistryStats IdaAssetRegistry::GetStats() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    AssetRegistryStats stats;
+    for (const auto& [id, entry] : state_->entries) {
+        if (entry.released) {
+            stats.cachedCount++;
+            stats.cachedBytes += entry.size;
+        } else {
+            stats.liveCount++;
+            stats.liveBytes += entry.size;
+        }
+    }
+    stats.loadingCount = static_cast<uint32_t>(state_->loading.size());
+    stats.hits = state_->hits;
+    stats.misses = state_->misses;
+    stats.evictions = state_->evictions;
+    return stats;
+}
+} // namespace ida
@@ -0,0 +1,73 @@
+#ifndef VULKAN_LIB_ASSET_REGISTRY_HPP
+#define VULKAN_LIB_ASSET_REGISTRY_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <memory>
+#include <string>
+
+#include "model/model.hpp"
+#include "model/model_loader.hpp"
+
+namespace ida {
+struct AssetRegistryStats {
+    uint32_t liveCount = 0;   // assets with handles out
+    uint32_t cachedCount = 0; // released but kept until evicted
+    uint32_t loadingCount = 0;
+    vk::DeviceSize liveBytes = 0;
+    vk::DeviceSize cachedBytes = 0;
+    uint64_t hits = 0; // acquisitions served without a new import
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+/**
+ * Hands out shared models so every asset is imported once, however many objects and scenes use it.
+ *
+ * Assets are looked up by canonical path and import options. The file size and modification time
+ * are stored with the lookup, so an edited file is imported again. Behind the path, assets are
+ * keyed by a hash of the file contents, so the same mesh reached through another path or copy
+ * shares the entry too.
+ *
+ * The registry only keeps weak references to assets in use. When their last handle is dropped
+ * the asset moves to a least recently released list and stays loaded, so a scene loaded again
+ * costs nothing. Released assets are evicted, oldest first, once everything the registry tracks
+ * exceeds the memory budget. Handles keep their asset alive even past the registry.
+ */
+class IdaAssetRegistry final {
+  public:
+    using ModelHandle = std::shared_ptr<IdaModel>;
+
+    static constexpr vk::DeviceSize DEFAULT_MEMORY_BUDGET = 256ull * 1024 * 1024;
+
+    explicit IdaAssetRegistry(IdaModelLoader& loader, vk::DeviceSize memoryBudget = DEFAULT_MEMORY_BUDGET);
+    ~IdaAssetRegistry();
+    IdaAssetRegistry(const IdaAssetRegistry&) = delete;
+    IdaAssetRegistry& operator=(const IdaAssetRegistry&) = delete;
+
+    // Imports on the calling thread on a miss, which must be the thread recording the frames
+    ModelHandle AcquireModel(const std::string& path, const IdaModel::ImportOptions& options = {});
+    // Imports through the model loader on a miss, acquisitions of an asset that is still loading
+    // share its import. The future and the callback complete in Update() once the model is resident.
+    IdaModelLoader::Future AcquireModelAsync(
+        const std::string& path,
+        const IdaModel::ImportOptions& options = {},
+        IdaModelLoader::Callback onResident = nullptr);
+
+    // Completes asynchronous acquisitions, once per frame after IdaModelLoader::Update()
+    void Update();
+
+    void SetMemoryBudget(vk::DeviceSize bytes);
+    // Evicts every released asset
+    void Trim();
+    AssetRegistryStats GetStats() const;
+
+  private:
+    struct State;
+
+    IdaModelLoader& loader_;
+    std::shared_ptr<State> state_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_ASSET_REGISTRY_HPP
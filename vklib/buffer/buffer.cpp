@@ -20,59 +20,85 @@ void IdaBuffer::Utils::CreateBuffer(
     vk::BufferUsageFlags usage,
     vk::MemoryPropertyFlags properties,
     vk::Buffer& buffer,
-    vk::DeviceMemory& bufferMemory) {
-    auto& device = Context::GetInstance().device;
+    IdaAllocation*& allocation) {
+    auto& ctx = Context::GetInstance();
     auto createInfo = vk::BufferCreateInfo()
                           .setSize(size)
                           .setUsage(usage)
                           .setSharingMode(vk::SharingMode::eExclusive);
-    buffer = device.createBuffer(createInfo);
-
-    auto memRequirements = Context::GetInstance().device.getBufferMemoryRequirements(buffer);
-    auto allocInfo = vk::MemoryAllocateInfo()
-                         .setAllocationSize(memRequirements.size)
-                         .setMemoryTypeIndex(FindMemoryType(memRequirements.memoryTypeBits, properties));
-    bufferMemory = device.allocateMemory(allocInfo);
-    device.bindBufferMemory(buffer, bufferMemory, 0);
+    buffer = ctx.device.createBuffer(createInfo);
+    allocation = ctx.allocator->AllocateForBuffer(buffer, properties);
 }
 
 uint32_t IdaBuffer::Utils::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
-    auto memProperties = Context::GetInstance().phyDevice.getMemoryProperties();
+    auto type = TryFindMemoryType(typeFilter, properties);
+    if (!type) {
+        IO::ThrowError("Failed to find suitable memory type!");
+    }
+    return type.value();
+}
+
+std::optional<uint32_t> IdaBuffer::Utils::TryFindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
+    auto& memProperties = Context::GetInstance().allocator->GetMemoryProperties();
     for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
         if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
             return i;
         }
     }
-    IO::ThrowError("Failed to find suitable memory type!");
+    return std::nullopt;
 }
 
-void IdaBuffer::Utils::CopyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size) {
+vk::MemoryPropertyFlags IdaBuffer::Utils::ChooseDeviceLocalProperties(vk::DeviceSize size, vk::BufferUsageFlags usage) {
     auto& ctx = Context::GetInstance();
-    ctx.ExecuteCommandBuffer(Context::GetInstance().graphicsQueue, [&](vk::CommandBuffer cmdBuf) {
-        auto copyRegion = vk::BufferCopy()
-                              .setSize(size);
-        cmdBuf.copyBuffer(srcBuffer, dstBuffer, copyRegion);
-    });
+    auto direct = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+
+    // memoryTypeBits only depend on usage and flags, so a throwaway buffer tells us which types qualify
+    auto probe = ctx.device.createBuffer(vk::BufferCreateInfo()
+                                             .setSize(size)
+                                             .setUsage(usage)
+                                             .setSharingMode(vk::SharingMode::eExclusive));
+    auto typeBits = ctx.device.getBufferMemoryRequirements(probe).memoryTypeBits;
+    ctx.device.destroyBuffer(probe);
+
+    auto type = TryFindMemoryType(typeBits, direct);
+    if (!type) {
+        return vk::MemoryPropertyFlagBits::eDeviceLocal;
+    }
+    // small BAR windows fill up quickly, keep a quarter of the budget for everyone else
+    vk::DeviceSize heapUsage = 0, budget = 0;
+    ctx.allocator->GetHeapBudget(ctx.allocator->GetMemoryProperties().memoryTypes[type.value()].heapIndex, heapUsage, budget);
+    if (heapUsage + size > budget / 4 * 3) {
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Host visible device local heap near its budget ({}/{} bytes), staging {} bytes", heapUsage, budget, size);
+        return vk::MemoryPropertyFlagBits::eDeviceLocal;
+    }
+    return direct;
 }
 
-void IdaBuffer::Utils::CopyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height, uint32_t layerCount) {
-    auto& ctx = Context::GetInstance();
-    ctx.ExecuteCommandBuffer(Context::GetInstance().graphicsQueue, [&](vk::CommandBuffer cmdBuf) {
-        auto region = vk::BufferImageCopy()
-                          .setBufferOffset(0)
-                          .setBufferRowLength(0)
-                          .setBufferImageHeight(0)
-                          .setImageSubresource(vk::ImageSubresourceLayers()
-                                                   .setAspectMask(vk::ImageAspectFlagBits::eColor)
-                                                   .setMipLevel(0)
-                                                   .setBaseArrayLayer(0)
-                                                   .setLayerCount(layerCount))
-                          .setImageExtent(vk::Extent3D()
-                                              .setWidth(width)
-                                              .setHeight(height)
-                                              .setDepth(1));
-        cmdBuf.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
-    });
+UploadToken IdaBuffer::Utils::CopyBuffer(
+    vk::Buffer srcBuffer,
+    vk::Buffer dstBuffer,
+    vk::DeviceSize size,
+    vk::DeviceSize srcOffset,
+    vk::DeviceSize dstOffset) {
+    return Context::GetInstance().uploadBatcher->CopyBuffer(srcBuffer, dstBuffer, size, srcOffset, dstOffset);
+}
+
+UploadToken IdaBuffer::Utils::CopyBufferToImage(
+    vk::Buffer buffer,
+    vk::Image image,
+    uint32_t width,
+    uint32_t height,
+    uint32_t layerCount,
+    vk::DeviceSize bufferOffset) {
+    return Context::GetInstance().uploadBatcher->CopyBufferToImage(buffer, image, width, height, layerCount, bufferOffset);
+}
+
+UploadToken IdaBuffer::Utils::UploadToBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset) {
+    return Context::GetInstance().uploadBatcher->UploadToBuffer(data, size, dstBuffer, dstOffset);
+}
+
+UploadToken IdaBuffer::Utils::UploadToImage(const void* data, vk::DeviceSize size, vk::Image image, uint32_t width, uint32_t height, uint32_t layerCount) {
+    return Context::GetInstance().uploadBatcher->UploadToImage(data, size, image, width, height, layerCount);
 }
 
 // **************************************** IdaBuffer ****************************************
@@ -86,32 +112,140 @@ IdaBuffer::IdaBuffer(
     : type_(type), instanceSize_(instanceSize), instanceCount_(instanceCount), usageFlags_(usageFlags), memoryFlags_(properties) {
     alignmentSize_ = GetAlignment(instanceSize, minOffsetAlignment);
     bufferSize_ = alignmentSize_ * instanceCount;
-    Utils::CreateBuffer(bufferSize_, usageFlags_, memoryFlags_, buffer_, bufferMemory_);
+    Utils::CreateBuffer(bufferSize_, usageFlags_, memoryFlags_, buffer_, allocation_);
+}
+
+IdaBuffer::IdaBuffer(BufferType type, vk::DeviceSize size, vk::BufferUsageFlags usage)
+    : type_(type), instanceSize_(size), instanceCount_(1), usageFlags_(usage), alignmentSize_(size), bufferSize_(size) {}
+
+std::unique_ptr<IdaBuffer> IdaBuffer::ImportHostMemory(
+    BufferType type,
+    const void* hostPointer,
+    vk::DeviceSize size,
+    vk::BufferUsageFlags usage,
+    std::shared_ptr<const void> keepAlive) {
+    if (Context::GetInstance().IsDeviceExtensionEnabled(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+        std::unique_ptr<IdaBuffer> buffer(new IdaBuffer(type, size, usage));
+        if (buffer->TryImport(hostPointer)) {
+            buffer->keepAlive_ = std::move(keepAlive);
+            return buffer;
+        }
+    }
+    // the staging write copies the data right away, so keepAlive can go with this scope
+    auto fallbackUsage = usage | vk::BufferUsageFlagBits::eTransferDst;
+    auto buffer = std::make_unique<IdaBuffer>(type, size, 1, fallbackUsage, Utils::ChooseDeviceLocalProperties(size, fallbackUsage));
+    buffer->Upload(hostPointer, size);
+    return buffer;
+}
+
+bool IdaBuffer::TryImport(const void* hostPointer) {
+    auto& ctx = Context::GetInstance();
+    auto hostProperties = ctx.phyDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>()
+                              .get<vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>();
+    auto alignment = hostProperties.minImportedHostPointerAlignment;
+    if (reinterpret_cast<uintptr_t>(hostPointer) % alignment != 0) {
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Host pointer is not aligned to {} bytes, uploading instead", alignment);
+        return false;
+    }
+
+    auto handleType = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT;
+    try {
+        auto pointerProperties = ctx.device.getMemoryHostPointerPropertiesEXT(handleType, hostPointer, ctx.dispatcher);
+        auto externalInfo = vk::ExternalMemoryBufferCreateInfo().setHandleTypes(handleType);
+        auto createInfo = vk::BufferCreateInfo()
+                              .setPNext(&externalInfo)
+                              .setSize(bufferSize_)
+                              .setUsage(usageFlags_)
+                              .setSharingMode(vk::SharingMode::eExclusive);
+        buffer_ = ctx.device.createBuffer(createInfo);
+
+        auto importSize = GetAlignment(bufferSize_, alignment);
+        auto requirements = ctx.device.getBufferMemoryRequirements(buffer_);
+        auto typeBits = requirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+        auto type = Utils::TryFindMemoryType(typeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        if (!type) {
+            type = Utils::TryFindMemoryType(typeBits, vk::MemoryPropertyFlags());
+        }
+        if (!type || requirements.size > importSize) {
+            IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "No memory type can import this host pointer, uploading instead");
+            ctx.device.destroyBuffer(buffer_);
+            buffer_ = nullptr;
+            return false;
+        }
+
+        auto importInfo = vk::ImportMemoryHostPointerInfoEXT()
+                              .setHandleType(handleType)
+                              .setPHostPointer(const_cast<void*>(hostPointer));
+        auto allocInfo = vk::MemoryAllocateInfo()
+                             .setPNext(&importInfo)
+                             .setAllocationSize(importSize)
+                             .setMemoryTypeIndex(type.value());
+        importedMemory_ = ctx.device.allocateMemory(allocInfo);
+        ctx.device.bindBufferMemory(buffer_, importedMemory_, 0);
+        memoryFlags_ = ctx.allocator->GetMemoryProperties().memoryTypes[type.value()].propertyFlags;
+    } catch (const vk::SystemError& e) {
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Host memory import failed ({}), uploading instead", e.what());
+        if (buffer_) {
+            ctx.device.destroyBuffer(buffer_);
+            buffer_ = nullptr;
+        }
+        return false;
+    }
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Imported {} bytes of host memory as {}", bufferSize_, GetTypeName());
+    return true;
 }
 
 IdaBuffer::~IdaBuffer() {
     IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Buffer destroyed, Type: {}", GetTypeName());
-    auto& device = Context::GetInstance().device;
     Unmap();
-    device.destroyBuffer(buffer_);
-    device.freeMemory(bufferMemory_);
+    SetMovable(false);
+    if (importedMemory_) {
+        // the host pages have to outlive the device memory wrapping them
+        Context::GetInstance().deletionQueue->Push([buffer = buffer_, memory = importedMemory_, keepAlive = keepAlive_]() {
+            auto& ctx = Context::GetInstance();
+            ctx.device.destroyBuffer(buffer);
+            ctx.device.freeMemory(memory);
+        });
+        return;
+    }
+    Context::GetInstance().deletionQueue->Push([buffer = buffer_, allocation = allocation_]() {
+        auto& ctx = Context::GetInstance();
+        ctx.device.destroyBuffer(buffer);
+        ctx.allocator->Free(allocation);
+    });
 }
 
+// Host visible blocks are persistently mapped by the allocator, so mapping only hands out
+// a pointer into the block and never calls vkMapMemory on the shared memory object.
 void IdaBuffer::Map(vk::DeviceSize size, vk::DeviceSize offset) {
-    auto& device = Context::GetInstance().device;
-    mapped_ = device.mapMemory(bufferMemory_, offset, size, vk::MemoryMapFlags());
+    IO::Assert(allocation_ != nullptr, "Can't map an imported buffer, Type: {}", GetTypeName());
+    auto data = allocation_->GetMappedData();
+    IO::Assert(data != nullptr, "Can't map a buffer that is not host visible, Type: {}", GetTypeName());
+    mapped_ = static_cast<char*>(data) + offset;
 }
 
-void IdaBuffer::Unmap() {
-    auto& device = Context::GetInstance().device;
-    if (mapped_) {
-        device.unmapMemory(bufferMemory_);
-        mapped_ = nullptr;
+void IdaBuffer::SetMovable(bool movable) {
+    if (movable == movable_) {
+        return;
+    }
+    movable_ = movable;
+    auto& defragmenter = Context::GetInstance().defragmenter;
+    if (!defragmenter) {
+        return;
+    }
+    if (movable_) {
+        defragmenter->Register(this);
+    } else {
+        defragmenter->Unregister(this);
     }
 }
 
+void IdaBuffer::Unmap() {
+    mapped_ = nullptr;
+}
+
 void IdaBuffer::WriteToBuffer(void* data, vk::DeviceSize size, vk::DeviceSize offset) {
-    if (size = vk::WholeSize) {
+    if (size == vk::WholeSize) {
         memcpy(mapped_, data, bufferSize_);
     } else {
         char* dst = static_cast<char*>(mapped_) + offset;
@@ -119,13 +253,23 @@ void IdaBuffer::WriteToBuffer(void* data, vk::DeviceSize size, vk::DeviceSize of
     }
 }
 
+UploadToken IdaBuffer::Upload(const void* data, vk::DeviceSize size, vk::DeviceSize offset) {
+    IO::Assert(allocation_ != nullptr, "Can't upload into an imported buffer, Type: {}", GetTypeName());
+    auto mapped = allocation_->GetMappedData();
+    if (mapped == nullptr) {
+        return Utils::UploadToBuffer(data, size, buffer_, offset);
+    }
+    // host writes are made visible to the device by the next queue submission
+    memcpy(static_cast<char*>(mapped) + offset, data, size);
+    Flush(size, offset);
+    return 0;
+}
+
 void IdaBuffer::Flush(vk::DeviceSize size, vk::DeviceSize offset) {
-    auto& device = Context::GetInstance().device;
-    auto range = vk::MappedMemoryRange()
-                     .setMemory(bufferMemory_)
-                     .setSize(size)
-                     .setOffset(offset);
-    device.flushMappedMemoryRanges(range);
+    if (allocation_ == nullptr) {
+        return;
+    }
+    Context::GetInstance().allocator->Flush(allocation_, size, offset);
 }
 
 vk::DescriptorBufferInfo IdaBuffer::GetDescriptorInfo(vk::DeviceSize size, vk::DeviceSize offset) {
@@ -136,12 +280,10 @@ vk::DescriptorBufferInfo IdaBuffer::GetDescriptorInfo(vk::DeviceSize size, vk::D
 }
 
 void IdaBuffer::Invalidate(vk::DeviceSize size, vk::DeviceSize offset) {
-    auto& device = Context::GetInstance().device;
-    auto range = vk::MappedMemoryRange()
-                     .setMemory(bufferMemory_)
-                     .setSize(size)
-                     .setOffset(offset);
-    device.invalidateMappedMemoryRanges(range);
+    if (allocation_ == nullptr) {
+        return;
+    }
+    Context::GetInstance().allocator->Invalidate(allocation_, size, offset);
 }
 
 void IdaBuffer::WriteToIndex(void* data, int index) {
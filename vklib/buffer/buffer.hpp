@@ -3,8 +3,13 @@
 
 #include "vulkan/vulkan.hpp"
 
+#include <memory>
+#include <optional>
 #include <unordered_map>
 
+#include "buffer/upload_batcher.hpp"
+#include "memory/allocator.hpp"
+
 namespace ida {
 
 enum BufferType {
@@ -12,6 +17,7 @@ enum BufferType {
     IndexBuffer,
     UniformBuffer,
     StagingBuffer,
+    StorageBuffer,
 };
 
 inline std::unordered_map<BufferType, std::string> BufferTypeNames = {
@@ -19,6 +25,7 @@ inline std::unordered_map<BufferType, std::string> BufferTypeNames = {
     {IndexBuffer, "IndexBuffer"},
     {UniformBuffer, "UniformBuffer"},
     {StagingBuffer, "StagingBuffer"},
+    {StorageBuffer, "StorageBuffer"},
 };
 
 class IdaBuffer {
@@ -29,10 +36,31 @@ class IdaBuffer {
             vk::BufferUsageFlags usage,
             vk::MemoryPropertyFlags properties,
             vk::Buffer& buffer,
-            vk::DeviceMemory& bufferMemory);
+            IdaAllocation*& allocation);
         static uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
-        static void CopyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
-        static void CopyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height, uint32_t layerCount);
+        static std::optional<uint32_t> TryFindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+        // DEVICE_LOCAL | HOST_VISIBLE when a buffer of this usage fits such a memory type (UMA, ReBAR) and its
+        // heap is not close to its budget, so IdaBuffer::Upload() writes straight into it. DEVICE_LOCAL
+        // otherwise, and uploads go through the staging ring.
+        static vk::MemoryPropertyFlags ChooseDeviceLocalProperties(vk::DeviceSize size, vk::BufferUsageFlags usage);
+        // Transfers are recorded into the context's upload batcher and complete asynchronously,
+        // the returned token can be polled or waited on through Context::uploadBatcher
+        static UploadToken CopyBuffer(
+            vk::Buffer srcBuffer,
+            vk::Buffer dstBuffer,
+            vk::DeviceSize size,
+            vk::DeviceSize srcOffset = 0,
+            vk::DeviceSize dstOffset = 0);
+        static UploadToken CopyBufferToImage(
+            vk::Buffer buffer,
+            vk::Image image,
+            uint32_t width,
+            uint32_t height,
+            uint32_t layerCount,
+            vk::DeviceSize bufferOffset = 0);
+        // Write through the context's staging ring and copy into a device local resource
+        static UploadToken UploadToBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset = 0);
+        static UploadToken UploadToImage(const void* data, vk::DeviceSize size, vk::Image image, uint32_t width, uint32_t height, uint32_t layerCount);
     };
 
     IdaBuffer(
@@ -44,12 +72,32 @@ class IdaBuffer {
         vk::DeviceSize minOffsetAlignment = 1);
     ~IdaBuffer();
     IdaBuffer(const IdaBuffer&) = delete;
+
+    // Wraps host memory, e.g. a mapped cache file, as a buffer without copying it (VK_EXT_external_memory_host).
+    // hostPointer must be aligned to minImportedHostPointerAlignment and readable up to size rounded up to it,
+    // which holds for mmap'ed files. keepAlive is released together with the buffer. When the extension is
+    // missing or the pointer can't be imported the data is uploaded into a regular device local buffer instead.
+    static std::unique_ptr<IdaBuffer> ImportHostMemory(
+        BufferType type,
+        const void* hostPointer,
+        vk::DeviceSize size,
+        vk::BufferUsageFlags usage,
+        std::shared_ptr<const void> keepAlive = nullptr);
+
     IdaBuffer& operator=(const IdaBuffer&) = delete;
 
+    // Lets the defragmenter move this buffer to other memory. The vk::Buffer handle changes when it does,
+    // so only opt in for buffers whose handle is fetched with GetBuffer() every frame (no descriptor sets)
+    void SetMovable(bool movable);
+
     void Map(vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
     void Unmap();
 
     void WriteToBuffer(void* data, vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
+    // Writes directly when the memory is host visible, otherwise stages through the upload batcher.
+    // Returns the upload token, 0 for direct writes which are visible to the next submission.
+    UploadToken Upload(const void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+    bool IsHostVisible() { return static_cast<bool>(memoryFlags_ & vk::MemoryPropertyFlagBits::eHostVisible); }
     void Flush(vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
     vk::DescriptorBufferInfo GetDescriptorInfo(vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
     void Invalidate(vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
@@ -60,7 +108,10 @@ class IdaBuffer {
     void InvalidateIndex(int index);
 
     vk::Buffer GetBuffer() { return buffer_; }
-    vk::DeviceMemory GetBufferMemory() { return bufferMemory_; }
+    vk::DeviceMemory GetBufferMemory() { return allocation_ ? allocation_->memory : importedMemory_; }
+    vk::DeviceSize GetMemoryOffset() { return allocation_ ? allocation_->offset : 0; }
+    bool IsImported() { return importedMemory_ != nullptr; }
+    IdaAllocation* GetAllocation() { return allocation_; }
     void* GetMappedMemory() { return mapped_; }
     vk::DeviceSize GetBufferSize() { return bufferSize_; }
     vk::BufferUsageFlags GetUsageFlags() { return usageFlags_; }
@@ -68,16 +119,26 @@ class IdaBuffer {
     BufferType GetType() { return type_; }
     std::string GetTypeName() { return BufferTypeNames[type_]; }
 
-  private:
+    vk::DeviceSize GetInstanceSize() { return instanceSize_; }
+    vk::DeviceSize GetAlignmentSize() { return alignmentSize_; }
+    uint32_t GetInstanceCount() { return instanceCount_; }
+
     static vk::DeviceSize GetAlignment(vk::DeviceSize instanceSize, vk::DeviceSize minOffsetAlignment);
 
+  private:
+    friend class IdaDefragmenter;
+
+    // used by ImportHostMemory, creates no buffer and no memory
+    IdaBuffer(BufferType type, vk::DeviceSize size, vk::BufferUsageFlags usage);
+    bool TryImport(const void* hostPointer);
+
     BufferType type_;
 
     vk::BufferUsageFlags usageFlags_;
     vk::MemoryPropertyFlags memoryFlags_;
 
     vk::Buffer buffer_;
-    vk::DeviceMemory bufferMemory_;
+    IdaAllocation* allocation_ = nullptr;
 
     vk::DeviceSize bufferSize_;
     vk::DeviceSize instanceSize_;
@@ -86,6 +147,10 @@ class IdaBuffer {
     uint32_t instanceCount_;
 
     void* mapped_ = nullptr;
+    bool movable_ = false;
+
+    vk::DeviceMemory importedMemory_ = nullptr;
+    std::shared_ptr<const void> keepAlive_;
 };
 
 } // namespace ida
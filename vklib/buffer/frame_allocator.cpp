@@ -0,0 +1,74 @@
+#include "frame_allocator.hpp"
+#include "core/context.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+
+namespace ida {
+IdaFrameAllocator::IdaFrameAllocator(uint32_t frameCount, vk::DeviceSize frameSize) {
+    auto limits = Context::GetInstance().phyDevice.getProperties().limits;
+    minOffsetAlignment_ = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+    // every frame region starts on an alignment boundary, see IdaBuffer::GetAlignment
+    buffer_ = std::make_unique<IdaBuffer>(
+        BufferType::UniformBuffer,
+        frameSize,
+        frameCount,
+        vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible,
+        minOffsetAlignment_);
+    buffer_->Map();
+    BeginFrame(0);
+}
+
+void IdaFrameAllocator::BeginFrame(uint32_t frameIndex) {
+    auto region = buffer_->GetDescriptorInfo(static_cast<int>(frameIndex));
+    frameBegin_ = region.offset;
+    frameEnd_ = region.offset + buffer_->GetInstanceSize();
+    head_ = frameBegin_;
+    flushedHead_ = frameBegin_;
+}
+
+TransientAllocation IdaFrameAllocator::Allocate(vk::DeviceSize size) {
+    auto offset = head_;
+    auto alignedSize = IdaBuffer::GetAlignment(size, minOffsetAlignment_);
+    if (offset + size > frameEnd_) {
+        IO::ThrowError("Frame allocator out of memory: {} bytes requested, {} of {} bytes used",
+                       size,
+                       head_ - frameBegin_,
+                       frameEnd_ - frameBegin_);
+    }
+    head_ = std::min(offset + alignedSize, frameEnd_);
+
+    TransientAllocation allocation{};
+    allocation.buffer = buffer_->GetBuffer();
+    allocation.dynamicOffset = static_cast<uint32_t>(offset);
+    allocation.size = size;
+    allocation.data = static_cast<char*>(buffer_->GetMappedMemory()) + offset;
+    return allocation;
+}
+
+TransientAllocation IdaFrameAllocator::Push(const void* data, vk::DeviceSize size) {
+    auto allocation = Allocate(size);
+    buffer_->WriteToBuffer(const_cast<void*>(data), size, allocation.dynamicOffset);
+    return allocation;
+}
+
+void IdaFrameAllocator::Flush() {
+    if (head_ == flushedHead_) {
+        return;
+    }
+    // a single range for everything written since the last flush, widened to nonCoherentAtomSize by the
+    // allocator and skipped entirely on coherent memory
+    buffer_->Flush(head_ - flushedHead_, flushedHead_);
+    flushedHead_ = head_;
+}
+
+vk::DescriptorBufferInfo IdaFrameAllocator::GetDescriptorInfo(vk::DeviceSize range) const {
+    return vk::DescriptorBufferInfo()
+        .setBuffer(buffer_->GetBuffer())
+        .setOffset(0)
+        .setRange(range);
+}
+
+} // namespace ida
@@ -0,0 +1,62 @@
+#ifndef VULKAN_LIB_FRAME_ALLOCATOR_HPP
+#define VULKAN_LIB_FRAME_ALLOCATOR_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <memory>
+
+#include "buffer/buffer.hpp"
+
+namespace ida {
+struct TransientAllocation {
+    vk::Buffer buffer;
+    // offset to pass to vkCmdBindDescriptorSets for a dynamic uniform/storage binding
+    uint32_t dynamicOffset = 0;
+    vk::DeviceSize size = 0;
+    void* data = nullptr;
+};
+
+/**
+ * Bump allocator for data that only lives for one frame (per-pass and per-draw uniforms, small storage arrays).
+ *
+ * One persistently mapped buffer is split into a region per frame in flight. BeginFrame() rewinds the
+ * region of the frame being recorded, which the swap chain has already waited on, and every allocation
+ * is aligned to minUniformBufferOffsetAlignment / minStorageBufferOffsetAlignment so it can be bound
+ * through a single UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC descriptor with its dynamic offset.
+ * On non-coherent memory Flush() issues one range covering everything written this frame. Allocations
+ * can also be used as the source of transfers recorded into the frame's command buffer.
+ */
+class IdaFrameAllocator final {
+  public:
+    static constexpr vk::DeviceSize DEFAULT_FRAME_SIZE = 1024ull * 1024;
+
+    IdaFrameAllocator(uint32_t frameCount, vk::DeviceSize frameSize = DEFAULT_FRAME_SIZE);
+    ~IdaFrameAllocator() = default;
+    IdaFrameAllocator(const IdaFrameAllocator&) = delete;
+    IdaFrameAllocator& operator=(const IdaFrameAllocator&) = delete;
+
+    void BeginFrame(uint32_t frameIndex);
+    void Flush();
+
+    TransientAllocation Allocate(vk::DeviceSize size);
+    TransientAllocation Push(const void* data, vk::DeviceSize size);
+    template <typename T>
+    TransientAllocation Push(const T& data) { return Push(&data, sizeof(T)); }
+
+    // Descriptor for a dynamic binding, range is the size the shader sees at each dynamic offset
+    vk::DescriptorBufferInfo GetDescriptorInfo(vk::DeviceSize range) const;
+    vk::Buffer GetBuffer() const { return buffer_->GetBuffer(); }
+    vk::DeviceSize GetUsedBytes() const { return head_ - frameBegin_; }
+
+  private:
+    std::unique_ptr<IdaBuffer> buffer_;
+    vk::DeviceSize minOffsetAlignment_;
+
+    vk::DeviceSize frameBegin_ = 0;
+    vk::DeviceSize frameEnd_ = 0;
+    vk::DeviceSize head_ = 0;
+    vk::DeviceSize flushedHead_ = 0;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_FRAME_ALLOCATOR_HPP
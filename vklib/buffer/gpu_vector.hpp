@@ -0,0 +1,202 @@
+#ifndef VULKAN_LIB_GPU_VECTOR_HPP
+#define VULKAN_LIB_GPU_VECTOR_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer.hpp"
+#include "buffer/frame_allocator.hpp"
+
+namespace ida {
+/**
+ * Device local array of T with a host side copy, for data that changes size at runtime (instances, lights).
+ *
+ * Writes only touch the host copy and mark a dirty range. Sync() is recorded at the start of a frame,
+ * outside any render pass: when the vector has grown it first copies the old contents into the new,
+ * larger buffer on the GPU, then stages the merged dirty ranges through the frame allocator and copies
+ * them in. The old buffer is handed to the deletion queue, so frames still in flight keep reading it.
+ * Large arrays can be streamed in over several frames by limiting the bytes each Sync() stages.
+ *
+ * Sync() makes its copies visible to every later command, but it does not wait for earlier reads:
+ * the dirty ranges are written in place into the buffer that earlier frames read. The caller has to record a
+ * dependency from the stages that read the vector to eTransfer before calling Sync(), see
+ * ClusterRenderSystem::Cull().
+ */
+template <typename T>
+class IdaGpuVector final {
+    static_assert(std::is_trivially_copyable_v<T>, "IdaGpuVector elements are copied with memcpy");
+
+  public:
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    explicit IdaGpuVector(vk::BufferUsageFlags usage, size_t capacity = MIN_CAPACITY)
+        : usage_(usage | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc) {
+        Reserve(capacity);
+    }
+    IdaGpuVector(const IdaGpuVector&) = delete;
+    IdaGpuVector& operator=(const IdaGpuVector&) = delete;
+
+    size_t Size() const { return data_.size(); }
+    size_t Capacity() const { return capacity_; }
+    bool Empty() const { return data_.empty(); }
+    const T& operator[](size_t index) const { return data_[index]; }
+    const T* Data() const { return data_.data(); }
+
+    void PushBack(const T& value) {
+        if (data_.size() == capacity_) {
+            Reserve(capacity_ * 2);
+        }
+        data_.push_back(value);
+        MarkDirty(data_.size() - 1, 1);
+    }
+
+    void Set(size_t index, const T& value) {
+        data_[index] = value;
+        MarkDirty(index, 1);
+    }
+
+    // Direct access to an element, the caller has to mark it dirty after changing it
+    T& At(size_t index) { return data_[index]; }
+
+    void Resize(size_t size) {
+        auto oldSize = data_.size();
+        if (size > capacity_) {
+            Reserve(std::max(size, capacity_ * 2));
+        }
+        data_.resize(size);
+        syncedSize_ = std::min(syncedSize_, size);
+        if (size > oldSize) {
+            MarkDirty(oldSize, size - oldSize);
+        }
+    }
+
+    void Assign(const std::vector<T>& values) {
+        Resize(values.size());
+        std::copy(values.begin(), values.end(), data_.begin());
+        MarkDirty(0, values.size());
+    }
+
+    // Shrinking keeps the capacity, like std::vector
+    void Clear() {
+        data_.clear();
+        syncedSize_ = 0;
+    }
+
+    void Reserve(size_t capacity) {
+        capacity = std::max(capacity, MIN_CAPACITY);
+        if (capacity <= capacity_) {
+            return;
+        }
+        // keep the buffer that holds the GPU side contents until Sync() copies it over
+        if (!previous_) {
+            previous_ = std::move(buffer_);
+        }
+        buffer_ = std::make_unique<IdaBuffer>(
+            BufferType::StorageBuffer,
+            sizeof(T),
+            static_cast<uint32_t>(capacity),
+            usage_,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+        capacity_ = capacity;
+        generation_++;
+    }
+
+    void MarkDirty(size_t first, size_t count) {
+        if (count > 0) {
+            dirty_.emplace_back(first, first + count);
+        }
+    }
+
+    // Returns the number of bytes uploaded. Dirty ranges past maxBytes stay dirty for the next Sync(),
+    // the lowest elements are uploaded first.
+    vk::DeviceSize Sync(vk::CommandBuffer cmd, IdaFrameAllocator& frameAllocator, vk::DeviceSize maxBytes = VK_WHOLE_SIZE) {
+        bool copied = false;
+        if (previous_) {
+            auto bytes = std::min<vk::DeviceSize>(gpuSize_, data_.size()) * sizeof(T);
+            if (bytes > 0) {
+                cmd.copyBuffer(previous_->GetBuffer(), buffer_->GetBuffer(), vk::BufferCopy(0, 0, bytes));
+                copied = true;
+            }
+            previous_.reset();
+        }
+
+        vk::DeviceSize uploaded = 0;
+        if (!dirty_.empty()) {
+            if (copied) {
+                // the dirty ranges may overwrite what the growth copy just wrote
+                auto barrier = vk::MemoryBarrier()
+                                   .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                   .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), barrier, nullptr, nullptr);
+            }
+            std::sort(dirty_.begin(), dirty_.end());
+            std::vector<std::pair<size_t, size_t>> ranges;
+            for (auto [first, last] : dirty_) {
+                last = std::min(last, data_.size());
+                if (first >= last) {
+                    continue;
+                }
+                if (!ranges.empty() && first <= ranges.back().second) {
+                    ranges.back().second = std::max(ranges.back().second, last);
+                } else {
+                    ranges.emplace_back(first, last);
+                }
+            }
+            dirty_.clear();
+
+            for (auto [first, last] : ranges) {
+                auto end = std::min<size_t>(last, first + (maxBytes - uploaded) / sizeof(T));
+                if (end > first) {
+                    auto bytes = (end - first) * sizeof(T);
+                    auto staging = frameAllocator.Push(data_.data() + first, bytes);
+                    cmd.copyBuffer(staging.buffer, buffer_->GetBuffer(), vk::BufferCopy(staging.dynamicOffset, first * sizeof(T), bytes));
+                    uploaded += bytes;
+                    if (first <= syncedSize_) {
+                        syncedSize_ = std::max(syncedSize_, end);
+                    }
+                }
+                if (end < last) {
+                    dirty_.emplace_back(end, last);
+                }
+            }
+        }
+
+        if (copied || uploaded > 0) {
+            auto barrier = vk::MemoryBarrier()
+                               .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                               .setDstAccessMask(vk::AccessFlagBits::eMemoryRead);
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(), barrier, nullptr, nullptr);
+        }
+        gpuSize_ = data_.size();
+        return uploaded;
+    }
+
+    vk::Buffer GetBuffer() const { return buffer_->GetBuffer(); }
+    vk::DescriptorBufferInfo GetDescriptorInfo() const { return buffer_->GetDescriptorInfo(); }
+    // Changes whenever the buffer is replaced, descriptor sets pointing at it must be rewritten
+    uint32_t GetGeneration() const { return generation_; }
+    // Leading elements the GPU holds a copy of, possibly an outdated one while they are still dirty
+    size_t GetSyncedSize() const { return syncedSize_; }
+    bool IsSynced() const { return dirty_.empty(); }
+
+  private:
+    vk::BufferUsageFlags usage_;
+    std::unique_ptr<IdaBuffer> buffer_;
+    std::unique_ptr<IdaBuffer> previous_;
+    size_t capacity_ = 0;
+    uint32_t generation_ = 0;
+
+    std::vector<T> data_;
+    // elements whose contents the GPU has, ranges past it are always dirty
+    size_t gpuSize_ = 0;
+    size_t syncedSize_ = 0;
+    std::vector<std::pair<size_t, size_t>> dirty_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_GPU_VECTOR_HPP
@@ -0,0 +1,172 @@
+#include "staging_ring.hpp"
+#include "core/context.hpp"
+
+#include <cstring>
+
+namespace ida {
+IdaStagingRing::IdaStagingRing(vk::DeviceSize capacity) : capacity_(capacity) {
+    buffer_ = std::make_unique<IdaBuffer>(
+        BufferType::StagingBuffer,
+        capacity_,
+        1,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    buffer_->Map();
+}
+
+IdaStagingRing::~IdaStagingRing() {
+    auto& device = Context::GetInstance().device;
+    for (auto& batch : inFlight_) {
+        device.waitForFences(batch.fence, true, std::numeric_limits<std::uint64_t>::max());
+        device.destroyFence(batch.fence);
+    }
+    inFlight_.clear();
+    for (auto fence : freeFences_) {
+        device.destroyFence(fence);
+    }
+    freeFences_.clear();
+    batchSpills_.clear();
+    buffer_.reset();
+}
+
+StagingRegion IdaStagingRing::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size = std::max<vk::DeviceSize>(size, 1);
+    if (size > capacity_) {
+        return Spill(size);
+    }
+
+    ReclaimLocked(false);
+    vk::DeviceSize offset = 0;
+    while (!TryAllocate(size, alignment, offset)) {
+        // only the open batch is left in the ring, nothing to wait for
+        if (inFlight_.empty()) {
+            return Spill(size);
+        }
+        ReclaimLocked(true);
+    }
+
+    if (!batchOpen_) {
+        batchOpen_ = true;
+        batchBegin_ = offset;
+    }
+    head_ = offset + size;
+
+    StagingRegion region{};
+    region.buffer = buffer_->GetBuffer();
+    region.offset = offset;
+    region.size = size;
+    region.data = static_cast<char*>(buffer_->GetMappedMemory()) + offset;
+    return region;
+}
+
+StagingRegion IdaStagingRing::Write(const void* data, vk::DeviceSize size, vk::DeviceSize alignment) {
+    auto region = Allocate(size, alignment);
+    memcpy(region.data, data, size);
+    return region;
+}
+
+vk::Fence IdaStagingRing::Commit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!batchOpen_ && batchSpills_.empty()) {
+        return nullptr;
+    }
+    Batch batch{};
+    batch.fence = AcquireFence();
+    batch.usesRing = batchOpen_;
+    batch.begin = batchBegin_;
+    batch.spills = std::move(batchSpills_);
+    inFlight_.push_back(std::move(batch));
+
+    batchOpen_ = false;
+    batchSpills_.clear();
+    return inFlight_.back().fence;
+}
+
+void IdaStagingRing::Reclaim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ReclaimLocked(false);
+}
+
+bool IdaStagingRing::TryAllocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset) {
+    // the oldest byte still owned by the GPU or by the open batch
+    std::optional<vk::DeviceSize> start;
+    for (auto& batch : inFlight_) {
+        if (batch.usesRing) {
+            start = batch.begin;
+            break;
+        }
+    }
+    if (!start && batchOpen_) {
+        start = batchBegin_;
+    }
+    if (!start) {
+        head_ = 0;
+        offset = 0;
+        return size <= capacity_;
+    }
+
+    auto candidate = alignment > 1 ? (head_ + alignment - 1) & ~(alignment - 1) : head_;
+    if (head_ > *start) {
+        // free space is [head_, capacity_) and [0, start)
+        if (candidate + size <= capacity_) {
+            offset = candidate;
+            return true;
+        }
+        if (size <= *start) {
+            offset = 0;
+            return true;
+        }
+        return false;
+    }
+    if (head_ < *start && candidate + size <= *start) {
+        offset = candidate;
+        return true;
+    }
+    // head_ == start means the ring is full
+    return false;
+}
+
+StagingRegion IdaStagingRing::Spill(vk::DeviceSize size) {
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Staging ring can't fit {} bytes, spilling to a temporary buffer", size);
+    auto spill = std::make_unique<IdaBuffer>(
+        BufferType::StagingBuffer,
+        size,
+        1,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    spill->Map();
+
+    StagingRegion region{};
+    region.buffer = spill->GetBuffer();
+    region.offset = 0;
+    region.size = size;
+    region.data = spill->GetMappedMemory();
+    region.spilled = true;
+    batchSpills_.push_back(std::move(spill));
+    return region;
+}
+
+void IdaStagingRing::ReclaimLocked(bool wait) {
+    auto& device = Context::GetInstance().device;
+    if (wait && !inFlight_.empty()) {
+        device.waitForFences(inFlight_.front().fence, true, std::numeric_limits<std::uint64_t>::max());
+    }
+    while (!inFlight_.empty() && device.getFenceStatus(inFlight_.front().fence) == vk::Result::eSuccess) {
+        freeFences_.push_back(inFlight_.front().fence);
+        inFlight_.pop_front();
+    }
+}
+
+vk::Fence IdaStagingRing::AcquireFence() {
+    auto& device = Context::GetInstance().device;
+    if (freeFences_.empty()) {
+        return device.createFence(vk::FenceCreateInfo());
+    }
+    auto fence = freeFences_.back();
+    freeFences_.pop_back();
+    device.resetFences(fence);
+    return fence;
+}
+
+} // namespace ida
@@ -0,0 +1,76 @@
+#ifndef VULKAN_LIB_STAGING_RING_HPP
+#define VULKAN_LIB_STAGING_RING_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "buffer/buffer.hpp"
+
+namespace ida {
+struct StagingRegion {
+    vk::Buffer buffer;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* data = nullptr;
+    bool spilled = false;
+};
+
+/**
+ * One persistently mapped host visible buffer that every upload writes into.
+ *
+ * Regions handed out by Allocate() belong to the current batch until Commit() is called. Commit()
+ * returns the fence the caller must submit the copies with, and the batch's space is reclaimed once
+ * that fence signals. Uploads larger than the ring, or that can't fit while the current batch is
+ * still open, spill into a temporary staging buffer that lives until the same fence.
+ */
+class IdaStagingRing final {
+  public:
+    static constexpr vk::DeviceSize DEFAULT_SIZE = 32ull * 1024 * 1024;
+    static constexpr vk::DeviceSize DEFAULT_ALIGNMENT = 16;
+
+    explicit IdaStagingRing(vk::DeviceSize capacity = DEFAULT_SIZE);
+    ~IdaStagingRing();
+    IdaStagingRing(const IdaStagingRing&) = delete;
+    IdaStagingRing& operator=(const IdaStagingRing&) = delete;
+
+    StagingRegion Allocate(vk::DeviceSize size, vk::DeviceSize alignment = DEFAULT_ALIGNMENT);
+    StagingRegion Write(const void* data, vk::DeviceSize size, vk::DeviceSize alignment = DEFAULT_ALIGNMENT);
+    vk::Fence Commit();
+    void Reclaim();
+
+    vk::DeviceSize GetCapacity() const { return capacity_; }
+
+  private:
+    struct Batch {
+        vk::Fence fence;
+        bool usesRing = false;
+        vk::DeviceSize begin = 0;
+        std::vector<std::unique_ptr<IdaBuffer>> spills;
+    };
+
+    bool TryAllocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+    StagingRegion Spill(vk::DeviceSize size);
+    void ReclaimLocked(bool wait);
+    vk::Fence AcquireFence();
+
+    std::unique_ptr<IdaBuffer> buffer_;
+    vk::DeviceSize capacity_;
+    vk::DeviceSize head_ = 0;
+
+    // the batch that is still being recorded
+    bool batchOpen_ = false;
+    vk::DeviceSize batchBegin_ = 0;
+    std::vector<std::unique_ptr<IdaBuffer>> batchSpills_;
+
+    std::deque<Batch> inFlight_;
+    std::vector<vk::Fence> freeFences_;
+    std::mutex mutex_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_STAGING_RING_HPP
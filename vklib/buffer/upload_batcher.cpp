@@ -0,0 +1,345 @@
+#include "upload_batcher.hpp"
+#include "core/context.hpp"
+
+namespace ida {
+IdaUploadBatcher::IdaUploadBatcher(vk::Queue queue, uint32_t queueFamilyIndex, uint32_t ownerFamilyIndex)
+    : queue_(queue), queueFamilyIndex_(queueFamilyIndex), ownerFamilyIndex_(ownerFamilyIndex) {
+    auto& device = Context::GetInstance().device;
+    auto poolInfo = vk::CommandPoolCreateInfo()
+                        .setQueueFamilyIndex(queueFamilyIndex_)
+                        .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
+    commandPool_ = device.createCommandPool(poolInfo);
+
+    auto timelineInfo = vk::SemaphoreTypeCreateInfo()
+                            .setSemaphoreType(vk::SemaphoreType::eTimeline)
+                            .setInitialValue(0);
+    timeline_ = device.createSemaphore(vk::SemaphoreCreateInfo().setPNext(&timelineInfo));
+}
+
+IdaUploadBatcher::~IdaUploadBatcher() {
+    WaitIdle();
+    auto& device = Context::GetInstance().device;
+    device.destroySemaphore(timeline_);
+    device.destroyCommandPool(commandPool_);
+}
+
+UploadToken IdaUploadBatcher::Record(const std::function<void(vk::CommandBuffer)>& func, vk::DeviceSize stagedBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    func(BeginLocked());
+    openStagedBytes_ += stagedBytes;
+    auto token = lastSubmitted_ + 1;
+    FlushIfFullLocked();
+    return token;
+}
+
+UploadToken IdaUploadBatcher::CopyBuffer(
+    vk::Buffer srcBuffer,
+    vk::Buffer dstBuffer,
+    vk::DeviceSize size,
+    vk::DeviceSize srcOffset,
+    vk::DeviceSize dstOffset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto copyRegion = vk::BufferCopy()
+                          .setSrcOffset(srcOffset)
+                          .setDstOffset(dstOffset)
+                          .setSize(size);
+    BeginLocked().copyBuffer(srcBuffer, dstBuffer, copyRegion);
+    TrackBufferLocked(dstBuffer, dstOffset, size);
+    auto token = lastSubmitted_ + 1;
+    FlushIfFullLocked();
+    return token;
+}
+
+UploadToken IdaUploadBatcher::CopyBufferToImage(
+    vk::Buffer buffer,
+    vk::Image image,
+    uint32_t width,
+    uint32_t height,
+    uint32_t layerCount,
+    vk::DeviceSize bufferOffset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto region = vk::BufferImageCopy()
+                      .setBufferOffset(bufferOffset)
+                      .setBufferRowLength(0)
+                      .setBufferImageHeight(0)
+                      .setImageSubresource(vk::ImageSubresourceLayers()
+                                               .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                                               .setMipLevel(0)
+                                               .setBaseArrayLayer(0)
+                                               .setLayerCount(layerCount))
+                      .setImageExtent(vk::Extent3D()
+                                          .setWidth(width)
+                                          .setHeight(height)
+                                          .setDepth(1));
+    BeginLocked().copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+    TrackImageLocked(image, layerCount);
+    auto token = lastSubmitted_ + 1;
+    FlushIfFullLocked();
+    return token;
+}
+
+// The staging write happens under the batcher lock so the ring can't be committed between
+// the write and the copy that reads it.
+UploadToken IdaUploadBatcher::UploadToBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto staging = Context::GetInstance().stagingRing->Write(data, size);
+    auto copyRegion = vk::BufferCopy()
+                          .setSrcOffset(staging.offset)
+                          .setDstOffset(dstOffset)
+                          .setSize(size);
+    BeginLocked().copyBuffer(staging.buffer, dstBuffer, copyRegion);
+    TrackBufferLocked(dstBuffer, dstOffset, size);
+    openStagedBytes_ += size;
+    auto token = lastSubmitted_ + 1;
+    FlushIfFullLocked();
+    return token;
+}
+
+UploadToken IdaUploadBatcher::UploadToImage(const void* data, vk::DeviceSize size, vk::Image image, uint32_t width, uint32_t height, uint32_t layerCount) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // bufferOffset of an image copy must be a multiple of the texel size and of 4
+    auto staging = Context::GetInstance().stagingRing->Write(data, size, 16);
+    auto region = vk::BufferImageCopy()
+                      .setBufferOffset(staging.offset)
+                      .setBufferRowLength(0)
+                      .setBufferImageHeight(0)
+                      .setImageSubresource(vk::ImageSubresourceLayers()
+                                               .setAspectMask(vk::ImageAspectFlagBits::eColor)
+                                               .setMipLevel(0)
+                                               .setBaseArrayLayer(0)
+                                               .setLayerCount(layerCount))
+                      .setImageExtent(vk::Extent3D()
+                                          .setWidth(width)
+                                          .setHeight(height)
+                                          .setDepth(1));
+    BeginLocked().copyBufferToImage(staging.buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+    TrackImageLocked(image, layerCount);
+    openStagedBytes_ += size;
+    auto token = lastSubmitted_ + 1;
+    FlushIfFullLocked();
+    return token;
+}
+
+UploadToken IdaUploadBatcher::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return FlushLocked();
+}
+
+bool IdaUploadBatcher::IsComplete(UploadToken token) {
+    if (token == 0) {
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (token > lastSubmitted_) {
+            return false;
+        }
+    }
+    return Context::GetInstance().device.getSemaphoreCounterValue(timeline_) >= token;
+}
+
+void IdaUploadBatcher::Wait(UploadToken token) {
+    if (token == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (token > lastSubmitted_) {
+            FlushLocked();
+        }
+    }
+    auto waitInfo = vk::SemaphoreWaitInfo()
+                        .setSemaphores(timeline_)
+                        .setValues(token);
+    auto result = Context::GetInstance().device.waitSemaphores(waitInfo, std::numeric_limits<std::uint64_t>::max());
+    if (result != vk::Result::eSuccess) {
+        IO::ThrowError("Failed to wait for upload batch {}", token);
+    }
+}
+
+void IdaUploadBatcher::WaitIdle() {
+    UploadToken token;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        token = FlushLocked();
+    }
+    Wait(token);
+}
+
+UploadToken IdaUploadBatcher::AcquireForOwner(vk::CommandBuffer cmd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FlushLocked();
+    if (!NeedsOwnershipTransfer()) {
+        // same queue: submission order plus the barrier at the end of each batch is enough
+        availableToken_ = lastSubmitted_;
+        return 0;
+    }
+
+    // only take over batches the transfer queue has finished, so the frame never waits on them
+    auto completed = Context::GetInstance().device.getSemaphoreCounterValue(timeline_);
+    std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    UploadToken waitValue = 0;
+    for (auto& batch : inFlight_) {
+        if (batch.token > completed) {
+            break;
+        }
+        if (batch.acquired) {
+            continue;
+        }
+        for (auto barrier : batch.bufferBarriers) {
+            barrier.setSrcAccessMask(vk::AccessFlags())
+                .setDstAccessMask(vk::AccessFlagBits::eMemoryRead);
+            bufferBarriers.push_back(barrier);
+        }
+        for (auto barrier : batch.imageBarriers) {
+            barrier.setSrcAccessMask(vk::AccessFlags())
+                .setDstAccessMask(vk::AccessFlagBits::eMemoryRead);
+            imageBarriers.push_back(barrier);
+        }
+        batch.acquired = true;
+        waitValue = batch.token;
+    }
+    if (waitValue == 0) {
+        return 0;
+    }
+    if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                            vk::PipelineStageFlagBits::eAllCommands,
+                            vk::DependencyFlags(),
+                            nullptr,
+                            bufferBarriers,
+                            imageBarriers);
+    }
+    availableToken_ = waitValue;
+    return waitValue;
+}
+
+bool IdaUploadBatcher::IsAvailable(UploadToken token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return token <= availableToken_;
+}
+
+vk::CommandBuffer IdaUploadBatcher::BeginLocked() {
+    if (openCommandBuffer_) {
+        return openCommandBuffer_;
+    }
+    if (freeCommandBuffers_.empty()) {
+        auto allocInfo = vk::CommandBufferAllocateInfo()
+                             .setCommandPool(commandPool_)
+                             .setLevel(vk::CommandBufferLevel::ePrimary)
+                             .setCommandBufferCount(1);
+        openCommandBuffer_ = Context::GetInstance().device.allocateCommandBuffers(allocInfo)[0];
+    } else {
+        openCommandBuffer_ = freeCommandBuffers_.back();
+        freeCommandBuffers_.pop_back();
+    }
+    openCommandBuffer_.begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    pendingToken_ = lastSubmitted_ + 1;
+    return openCommandBuffer_;
+}
+
+void IdaUploadBatcher::FlushIfFullLocked() {
+    // don't let one batch pin the whole ring, later writes would only spill
+    if (openStagedBytes_ > Context::GetInstance().stagingRing->GetCapacity() / 2) {
+        FlushLocked();
+    }
+}
+
+UploadToken IdaUploadBatcher::FlushLocked() {
+    CollectLocked();
+    if (!openCommandBuffer_) {
+        return lastSubmitted_;
+    }
+    auto& ctx = Context::GetInstance();
+
+    if (NeedsOwnershipTransfer()) {
+        // release every written range to the owner family, it is acquired in AcquireForOwner()
+        if (!openBufferBarriers_.empty() || !openImageBarriers_.empty()) {
+            openCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                               vk::PipelineStageFlagBits::eBottomOfPipe,
+                                               vk::DependencyFlags(),
+                                               nullptr,
+                                               openBufferBarriers_,
+                                               openImageBarriers_);
+        }
+    } else {
+        // make the copies visible to whatever is submitted after this batch
+        auto barrier = vk::MemoryBarrier()
+                           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                           .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+        openCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                           vk::PipelineStageFlagBits::eAllCommands,
+                                           vk::DependencyFlags(),
+                                           barrier,
+                                           nullptr,
+                                           nullptr);
+    }
+    openCommandBuffer_.end();
+
+    auto token = lastSubmitted_ + 1;
+    auto timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+                            .setSignalSemaphoreValues(token);
+    auto submitInfo = vk::SubmitInfo()
+                          .setPNext(&timelineInfo)
+                          .setCommandBuffers(openCommandBuffer_)
+                          .setSignalSemaphores(timeline_);
+    queue_.submit(submitInfo, ctx.stagingRing->Commit());
+
+    Batch batch{};
+    batch.token = token;
+    batch.commandBuffer = openCommandBuffer_;
+    batch.bufferBarriers = std::move(openBufferBarriers_);
+    batch.imageBarriers = std::move(openImageBarriers_);
+    batch.acquired = !NeedsOwnershipTransfer();
+    inFlight_.push_back(std::move(batch));
+
+    lastSubmitted_ = token;
+    pendingToken_ = token;
+    openCommandBuffer_ = nullptr;
+    openStagedBytes_ = 0;
+    openBufferBarriers_.clear();
+    openImageBarriers_.clear();
+    return token;
+}
+
+// A batch is recycled once it has completed and, when ownership moves, once the owner acquired it
+void IdaUploadBatcher::CollectLocked() {
+    if (inFlight_.empty()) {
+        return;
+    }
+    auto completed = Context::GetInstance().device.getSemaphoreCounterValue(timeline_);
+    while (!inFlight_.empty() && inFlight_.front().token <= completed && inFlight_.front().acquired) {
+        freeCommandBuffers_.push_back(inFlight_.front().commandBuffer);
+        inFlight_.pop_front();
+    }
+}
+
+void IdaUploadBatcher::TrackBufferLocked(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size) {
+    if (!NeedsOwnershipTransfer()) {
+        return;
+    }
+    openBufferBarriers_.push_back(vk::BufferMemoryBarrier()
+                                      .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                      .setSrcQueueFamilyIndex(queueFamilyIndex_)
+                                      .setDstQueueFamilyIndex(ownerFamilyIndex_)
+                                      .setBuffer(buffer)
+                                      .setOffset(offset)
+                                      .setSize(size));
+}
+
+void IdaUploadBatcher::TrackImageLocked(vk::Image image, uint32_t layerCount) {
+    if (!NeedsOwnershipTransfer()) {
+        return;
+    }
+    openImageBarriers_.push_back(vk::ImageMemoryBarrier()
+                                     .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                                     .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                                     .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+                                     .setSrcQueueFamilyIndex(queueFamilyIndex_)
+                                     .setDstQueueFamilyIndex(ownerFamilyIndex_)
+                                     .setImage(image)
+                                     .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, layerCount}));
+}
+
+} // namespace ida
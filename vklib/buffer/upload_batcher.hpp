@@ -0,0 +1,108 @@
+#ifndef VULKAN_LIB_UPLOAD_BATCHER_HPP
+#define VULKAN_LIB_UPLOAD_BATCHER_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace ida {
+// Timeline value of the batch an upload was recorded into, 0 means "nothing to wait for"
+using UploadToken = uint64_t;
+
+/**
+ * Records transfer commands from many callers into one command buffer and submits them together.
+ *
+ * Every recorded command returns the token of the batch it belongs to. A batch is submitted when
+ * Flush() is called (the renderer does so before every frame), when a caller waits on its token,
+ * or when it has staged more than half of the staging ring. Completion is tracked with a timeline
+ * semaphore, so tokens can be polled or waited on without stalling the queue.
+ *
+ * When the batcher runs on a queue family other than the owner (graphics) family, every tracked
+ * destination is released at the end of its batch, and AcquireForOwner() records the matching
+ * acquire barriers into the owner's command buffer once the batch has completed.
+ */
+class IdaUploadBatcher final {
+  public:
+    IdaUploadBatcher(vk::Queue queue, uint32_t queueFamilyIndex, uint32_t ownerFamilyIndex);
+    ~IdaUploadBatcher();
+    IdaUploadBatcher(const IdaUploadBatcher&) = delete;
+    IdaUploadBatcher& operator=(const IdaUploadBatcher&) = delete;
+
+    // Untracked commands, the caller is responsible for any ownership transfer
+    UploadToken Record(const std::function<void(vk::CommandBuffer)>& func, vk::DeviceSize stagedBytes = 0);
+    UploadToken CopyBuffer(
+        vk::Buffer srcBuffer,
+        vk::Buffer dstBuffer,
+        vk::DeviceSize size,
+        vk::DeviceSize srcOffset = 0,
+        vk::DeviceSize dstOffset = 0);
+    UploadToken CopyBufferToImage(
+        vk::Buffer buffer,
+        vk::Image image,
+        uint32_t width,
+        uint32_t height,
+        uint32_t layerCount,
+        vk::DeviceSize bufferOffset = 0);
+    UploadToken UploadToBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset = 0);
+    UploadToken UploadToImage(const void* data, vk::DeviceSize size, vk::Image image, uint32_t width, uint32_t height, uint32_t layerCount);
+
+    UploadToken Flush();
+    bool IsComplete(UploadToken token);
+    void Wait(UploadToken token);
+    void WaitIdle();
+
+    // Flushes, records acquire barriers for completed batches into cmd and returns the timeline
+    // value the owner submission has to wait on (0 if none)
+    UploadToken AcquireForOwner(vk::CommandBuffer cmd);
+    // Whether the owner queue may use resources written by the batch
+    bool IsAvailable(UploadToken token);
+    // Token of the batch still being recorded, or of the last submitted one if none is open. Lock free,
+    // so it can be called from destructors that run while the batcher lock is held (staging spills)
+    UploadToken GetPendingToken() const { return pendingToken_.load(); }
+
+    bool NeedsOwnershipTransfer() const { return queueFamilyIndex_ != ownerFamilyIndex_; }
+    vk::Queue GetQueue() const { return queue_; }
+    uint32_t GetQueueFamilyIndex() const { return queueFamilyIndex_; }
+    vk::Semaphore GetTimelineSemaphore() const { return timeline_; }
+
+  private:
+    struct Batch {
+        UploadToken token;
+        vk::CommandBuffer commandBuffer;
+        std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+        std::vector<vk::ImageMemoryBarrier> imageBarriers;
+        bool acquired = false;
+    };
+
+    vk::CommandBuffer BeginLocked();
+    UploadToken FlushLocked();
+    void FlushIfFullLocked();
+    void CollectLocked();
+    void TrackBufferLocked(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size);
+    void TrackImageLocked(vk::Image image, uint32_t layerCount);
+
+    vk::Queue queue_;
+    uint32_t queueFamilyIndex_;
+    uint32_t ownerFamilyIndex_;
+    vk::CommandPool commandPool_;
+    vk::Semaphore timeline_;
+
+    vk::CommandBuffer openCommandBuffer_;
+    vk::DeviceSize openStagedBytes_ = 0;
+    std::vector<vk::BufferMemoryBarrier> openBufferBarriers_;
+    std::vector<vk::ImageMemoryBarrier> openImageBarriers_;
+    UploadToken lastSubmitted_ = 0;
+    UploadToken availableToken_ = 0;
+    std::atomic<UploadToken> pendingToken_{0};
+
+    std::deque<Batch> inFlight_;
+    std::vector<vk::CommandBuffer> freeCommandBuffers_;
+    std::mutex mutex_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_UPLOAD_BATCHER_HPP
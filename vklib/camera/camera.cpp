@@ -1,5 +1,9 @@
 #include "camera.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace ida {
 
 void IdaCamera::SetOrthographicProjection(float left, float right, float bottom, float top, float near, float far) {
@@ -99,4 +103,33 @@ void IdaCamera::SetViewYXZ(glm::vec3 position, glm::vec3 rotation) {
     inverseView[3][2] = position.z;
 }
 
+float IdaCamera::ProjectLength(float length, float distance, float viewportHeight) const {
+    // projection[1][1] is 1 / tan(fov / 2) for perspective and 2 / (top - bottom) for orthographic
+    // projections, a clip space height of 2 covers the viewport
+    float scale = std::abs(projection[1][1]) * viewportHeight * 0.5f;
+    // only perspective projections divide by the distance
+    if (projection[2][3] != 0.0f) {
+        scale /= std::max(distance, std::numeric_limits<float>::epsilon());
+    }
+    return length * scale;
+}
+
+std::array<glm::vec4, 6> IdaCamera::GetFrustumPlanes() const {
+    // Gribb and Hartmann: the clip space tests -w <= x <= w, -w <= y <= w and 0 <= z <= w are
+    // plane equations in world space when expressed with the rows of projection * view
+    glm::mat4 m = glm::transpose(projection * view);
+    std::array<glm::vec4, 6> planes = {
+        m[3] + m[0],
+        m[3] - m[0],
+        m[3] + m[1],
+        m[3] - m[1],
+        m[2],
+        m[3] - m[2],
+    };
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
 } // namespace ida
\ No newline at end of file
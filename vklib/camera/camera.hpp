@@ -5,6 +5,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include "glm/glm.hpp"
 
+#include <array>
+
 namespace ida {
 class IdaCamera {
   public:
@@ -20,6 +22,12 @@ class IdaCamera {
     const glm::mat4& GetInverseView() const { return inverseView; }
     const glm::vec3 GetPosition() const { return glm::vec3(inverseView[3]); }
 
+    // Height in pixels of a world space length seen at the given view distance
+    float ProjectLength(float length, float distance, float viewportHeight) const;
+    // World space planes (normal, distance) facing inwards, in the order left, right, bottom, top,
+    // near, far. A point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them.
+    std::array<glm::vec4, 6> GetFrustumPlanes() const;
+
   private:
     glm::mat4 projection;
     glm::mat4 view;
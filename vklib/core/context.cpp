@@ -2,11 +2,22 @@
 #include "log/log.hpp"
 #include "tools.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <set>
+
 namespace ida {
 Context* Context::instance_ = nullptr;
 
 void Context::Init(std::vector<const char*>& extensions, GetSurfaceCallback cb) {
     instance_ = new Context(extensions, cb);
+    // resources built on IdaBuffer need GetInstance(), so they are created once the context exists
+    instance_->stagingRing = std::make_unique<IdaStagingRing>();
+    auto& families = instance_->queueFamilies;
+    instance_->uploadBatcher = std::make_unique<IdaUploadBatcher>(instance_->transferQueue, families.TransferFamily(), families.graphicsIndex.value());
+    instance_->geometryArena = std::make_unique<IdaGeometryArena>();
+    instance_->modelLoader = std::make_unique<IdaModelLoader>();
+    instance_->assetRegistry = std::make_unique<IdaAssetRegistry>(*instance_->modelLoader);
 }
 
 void Context::Quit() {
@@ -37,15 +48,43 @@ Context::Context(std::vector<const char*>& extensions, GetSurfaceCallback cb) {
         IO::ThrowError("Failed to create device");
     }
 
-    auto queueInfo = QueryQueueFamily(surface_);
-    graphicsQueue = device.getQueue(queueInfo.graphicsIndex.value(), 0);
-    presentQueue = device.getQueue(queueInfo.presentIndex.value(), 0);
+    dispatcher = vk::DispatchLoaderDynamic(instance, vkGetInstanceProcAddr, device, vkGetDeviceProcAddr);
 
+    queueFamilies = QueryQueueFamily(surface_);
+    graphicsQueue = device.getQueue(queueFamilies.graphicsIndex.value(), 0);
+    presentQueue = device.getQueue(queueFamilies.presentIndex.value(), 0);
+    transferQueue = device.getQueue(queueFamilies.TransferFamily(), 0);
+    computeQueue = device.getQueue(queueFamilies.ComputeFamily(), 0);
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO,
+                 "Queue families: graphics {}, present {}, transfer {}{}, compute {}{}",
+                 queueFamilies.graphicsIndex.value(),
+                 queueFamilies.presentIndex.value(),
+                 queueFamilies.TransferFamily(),
+                 queueFamilies.transferIndex ? " (dedicated)" : "",
+                 queueFamilies.ComputeFamily(),
+                 queueFamilies.computeIndex ? " (async)" : "");
+
+    allocator = std::make_unique<IdaAllocator>(phyDevice, device, IsDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+    deletionQueue = std::make_unique<IdaDeletionQueue>(IdaSwapChain::MAX_FRAMES_IN_FLIGHT);
+    defragmenter = std::make_unique<IdaDefragmenter>(IdaSwapChain::MAX_FRAMES_IN_FLIGHT);
     commandPool = CreateCommandPool();
 }
 
 Context::~Context() {
+    // nothing is in flight any more, so deferred resources can go immediately
+    device.waitIdle();
+    // drops the cached models, then the imports still waiting on the loader
+    assetRegistry.reset();
+    // joins the workers, models that were still uploading release their ranges into the queue
+    modelLoader.reset();
+    deletionQueue->Flush();
+    defragmenter.reset();
+    geometryArena.reset();
+    uploadBatcher.reset();
+    stagingRing.reset();
+    deletionQueue.reset();
     device.destroyCommandPool(commandPool);
+    allocator.reset();
     device.destroy();
 
     instance.destroySurfaceKHR(surface_);
@@ -54,7 +93,7 @@ Context::~Context() {
 
 vk::Instance Context::CreateInstance(std::vector<const char*>& extensions) {
     auto appInfo = vk::ApplicationInfo()
-                       .setApiVersion(VK_VERSION_1_3);
+                       .setApiVersion(VK_API_VERSION_1_3);
     auto createInfo = vk::InstanceCreateInfo()
                           .setPApplicationInfo(&appInfo)
                           .setPEnabledExtensionNames(extensions)
@@ -73,56 +112,97 @@ vk::PhysicalDevice Context::PickupPhysicalDevice() {
 vk::Device Context::CreateDevice(vk::SurfaceKHR surface) {
     vk::DeviceCreateInfo deviceCreateInfo;
     QueueFamilyIndices queueInfo = QueryQueueFamily(surface);
-    deviceCreateInfo.setPEnabledExtensionNames(deviceExtensions);
+    enabledDeviceExtensions_ = deviceExtensions;
+    auto supportedExtensions = phyDevice.enumerateDeviceExtensionProperties();
+    for (auto name : optionalDeviceExtensions) {
+        auto supported = std::any_of(supportedExtensions.begin(), supportedExtensions.end(), [&](const vk::ExtensionProperties& ext) {
+            return std::strcmp(ext.extensionName.data(), name) == 0;
+        });
+        if (supported) {
+            enabledDeviceExtensions_.push_back(name);
+            IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Optional device extension enabled: {}", name);
+        }
+    }
+    deviceCreateInfo.setPEnabledExtensionNames(enabledDeviceExtensions_);
+
+    std::set<uint32_t> uniqueFamilies = {queueInfo.graphicsIndex.value(), queueInfo.presentIndex.value()};
+    if (queueInfo.transferIndex) {
+        uniqueFamilies.insert(queueInfo.transferIndex.value());
+    }
+    if (queueInfo.computeIndex) {
+        uniqueFamilies.insert(queueInfo.computeIndex.value());
+    }
 
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
     float priority = 1.0;
-    if (queueInfo.graphicsIndex.value() == queueInfo.presentIndex.value()) {
+    for (auto family : uniqueFamilies) {
         vk::DeviceQueueCreateInfo queueCreateInfo;
         queueCreateInfo.setPQueuePriorities(&priority);
-        queueCreateInfo.setQueueFamilyIndex(queueInfo.graphicsIndex.value());
+        queueCreateInfo.setQueueFamilyIndex(family);
         queueCreateInfo.setQueueCount(1);
         queueCreateInfos.push_back(queueCreateInfo);
-    } else {
-        vk::DeviceQueueCreateInfo queueCreateInfo;
-        queueCreateInfo.setPQueuePriorities(&priority);
-        queueCreateInfo.setQueueFamilyIndex(queueInfo.graphicsIndex.value());
-        queueCreateInfo.setQueueCount(1);
-        queueCreateInfos.push_back(queueCreateInfo);
-
-        queueCreateInfo.setQueueFamilyIndex(queueInfo.presentIndex.value());
-        queueCreateInfos.push_back(queueCreateInfo);
     }
     deviceCreateInfo.setQueueCreateInfos(queueCreateInfos);
 
+    // cluster culling writes indirect draws, the mesh shader path replaces them when available
+    auto supported = phyDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    features.drawIndirectFirstInstance = supported.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance;
+    features.multiDrawIndirect = supported.get<vk::PhysicalDeviceFeatures2>().features.multiDrawIndirect;
+    features.drawIndirectCount = supported.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount;
+    auto features10 = vk::PhysicalDeviceFeatures()
+                          .setDrawIndirectFirstInstance(features.drawIndirectFirstInstance)
+                          .setMultiDrawIndirect(features.multiDrawIndirect);
+    deviceCreateInfo.setPEnabledFeatures(&features10);
+
+    // timeline semaphores track upload batches
+    auto features12 = vk::PhysicalDeviceVulkan12Features()
+                          .setTimelineSemaphore(true)
+                          .setDrawIndirectCount(features.drawIndirectCount);
+    deviceCreateInfo.setPNext(&features12);
+
+    vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures;
+    if (IsDeviceExtensionEnabled(VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+        auto meshSupport = phyDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+        features.meshShader = meshSupport.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>().meshShader;
+        meshShaderFeatures.setMeshShader(features.meshShader);
+        features12.setPNext(&meshShaderFeatures);
+    }
+
     return phyDevice.createDevice(deviceCreateInfo);
 }
 
+bool Context::IsDeviceExtensionEnabled(const char* name) const {
+    return std::any_of(enabledDeviceExtensions_.begin(), enabledDeviceExtensions_.end(), [&](const char* ext) {
+        return std::strcmp(ext, name) == 0;
+    });
+}
+
 QueueFamilyIndices Context::QueryQueueFamily(vk::SurfaceKHR surface) {
     QueueFamilyIndices queueFamilyIndices;
     auto queueFamilies = phyDevice.getQueueFamilyProperties();
     for (uint32_t i = 0; i < queueFamilies.size(); i++) {
-        if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics) {
+        if (queueFamilies[i].queueCount == 0) {
+            continue;
+        }
+        auto flags = queueFamilies[i].queueFlags;
+        bool graphics = static_cast<bool>(flags & vk::QueueFlagBits::eGraphics);
+        bool compute = static_cast<bool>(flags & vk::QueueFlagBits::eCompute);
+        bool transfer = static_cast<bool>(flags & vk::QueueFlagBits::eTransfer);
+        if (graphics && !queueFamilyIndices.graphicsIndex) {
             queueFamilyIndices.graphicsIndex = i;
         }
-        if (queueFamilies[i].queueCount > 0 && phyDevice.getSurfaceSupportKHR(i, surface)) {
+        if (!queueFamilyIndices.presentIndex && phyDevice.getSurfaceSupportKHR(i, surface)) {
             queueFamilyIndices.presentIndex = i;
         }
-        if (queueFamilyIndices) {
-            break;
+        // DMA-only family, uploads on it overlap with frame rendering
+        if (transfer && !graphics && !compute && !queueFamilyIndices.transferIndex) {
+            queueFamilyIndices.transferIndex = i;
         }
-    }
-    return queueFamilyIndices;
-}
-
-uint32_t Context::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
-    auto memProperties = phyDevice.getMemoryProperties();
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+        if (compute && !graphics && !queueFamilyIndices.computeIndex) {
+            queueFamilyIndices.computeIndex = i;
         }
     }
-    IO::ThrowError("Failed to find suitable memory type!");
+    return queueFamilyIndices;
 }
 
 SwapChainSupportDetails Context::QuerySwapChainSupport() {
@@ -145,14 +225,9 @@ vk::Format Context::QuerySupportedFormat(const std::vector<vk::Format>& candidat
     IO::ThrowError("Failed to find supported format");
 }
 
-void Context::CreateImageWithInfo(const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory) {
+void Context::CreateImageWithInfo(const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags properties, vk::Image& image, IdaAllocation*& imageAllocation) {
     image = device.createImage(imageInfo);
-    vk::MemoryRequirements memRequirements = device.getImageMemoryRequirements(image);
-    vk::MemoryAllocateInfo allocInfo;
-    allocInfo.setAllocationSize(memRequirements.size);
-    allocInfo.setMemoryTypeIndex(FindMemoryType(memRequirements.memoryTypeBits, properties));
-    imageMemory = device.allocateMemory(allocInfo);
-    device.bindImageMemory(image, imageMemory, 0);
+    imageAllocation = allocator->AllocateForImage(image, properties);
 }
 
 std::vector<vk::CommandBuffer> Context::CreateCommandBuffer(int count) {
@@ -173,9 +248,11 @@ void Context::ExecuteCommandBuffer(vk::Queue queue, std::function<void(vk::Comma
     cmdBuf.end();
     vk::SubmitInfo submitInfo;
     submitInfo.setCommandBuffers(cmdBuf);
-    queue.submit(submitInfo);
-    queue.waitIdle();
-    device.waitIdle();
+    // only wait for this submission, bulk transfers go through uploadBatcher instead
+    auto fence = device.createFence(vk::FenceCreateInfo());
+    queue.submit(submitInfo, fence);
+    device.waitForFences(fence, true, std::numeric_limits<std::uint64_t>::max());
+    device.destroyFence(fence);
     device.freeCommandBuffers(commandPool, cmdBuf);
 }
 
@@ -8,6 +8,14 @@
 #include <optional>
 
 #include "tools.hpp"
+#include "core/deletion_queue.hpp"
+#include "memory/allocator.hpp"
+#include "memory/defragmenter.hpp"
+#include "buffer/staging_ring.hpp"
+#include "buffer/upload_batcher.hpp"
+#include "model/geometry_arena.hpp"
+#include "model/model_loader.hpp"
+#include "asset/asset_registry.hpp"
 #include "swapchain/swapchain.hpp"
 #include "render/renderer.hpp"
 
@@ -21,10 +29,24 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices final {
     std::optional<std::uint32_t> graphicsIndex;
     std::optional<std::uint32_t> presentIndex;
+    // only set when the device has a family without graphics (and, for transfer, without compute)
+    std::optional<std::uint32_t> transferIndex;
+    std::optional<std::uint32_t> computeIndex;
 
     operator bool() {
         return graphicsIndex.has_value() && presentIndex.has_value();
     }
+
+    uint32_t TransferFamily() const { return transferIndex.value_or(graphicsIndex.value()); }
+    uint32_t ComputeFamily() const { return computeIndex.value_or(graphicsIndex.value()); }
+};
+
+// Optional device features, enabled when the physical device supports them
+struct DeviceFeatures final {
+    bool drawIndirectFirstInstance = false;
+    bool multiDrawIndirect = false;
+    bool drawIndirectCount = false;
+    bool meshShader = false;
 };
 
 class Context final {
@@ -39,8 +61,10 @@ class Context final {
     QueueFamilyIndices QueryQueueFamily(vk::SurfaceKHR);
     vk::Format QuerySupportedFormat(const std::vector<vk::Format>&, vk::ImageTiling, vk::FormatFeatureFlags);
 
-    void CreateImageWithInfo(const vk::ImageCreateInfo&, vk::MemoryPropertyFlags, vk::Image&, vk::DeviceMemory&);
+    void CreateImageWithInfo(const vk::ImageCreateInfo&, vk::MemoryPropertyFlags, vk::Image&, IdaAllocation*&);
     void ExecuteCommandBuffer(vk::Queue queue, std::function<void(vk::CommandBuffer&)> func);
+    // Required extensions plus the optional ones the physical device supports
+    bool IsDeviceExtensionEnabled(const char* name) const;
 
     ~Context();
 
@@ -49,18 +73,38 @@ class Context final {
     vk::Device device;
     vk::Queue graphicsQueue;
     vk::Queue presentQueue;
+    // fall back to graphicsQueue when the device has no dedicated family
+    vk::Queue transferQueue;
+    vk::Queue computeQueue;
+    QueueFamilyIndices queueFamilies;
+    DeviceFeatures features;
+    // entry points of optional extensions, which the loader does not export
+    vk::DispatchLoaderDynamic dispatcher;
     std::unique_ptr<IdaSwapChain> swapChain;
     vk::CommandPool commandPool;
+    std::unique_ptr<IdaAllocator> allocator;
+    std::unique_ptr<IdaDeletionQueue> deletionQueue;
+    std::unique_ptr<IdaDefragmenter> defragmenter;
+    std::unique_ptr<IdaStagingRing> stagingRing;
+    std::unique_ptr<IdaUploadBatcher> uploadBatcher;
+    std::unique_ptr<IdaGeometryArena> geometryArena;
+    std::unique_ptr<IdaModelLoader> modelLoader;
+    std::unique_ptr<IdaAssetRegistry> assetRegistry;
 
   private:
     const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    const std::vector<const char*> optionalDeviceExtensions = {
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+        VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME,
+        VK_EXT_MESH_SHADER_EXTENSION_NAME,
+    };
+    std::vector<const char*> enabledDeviceExtensions_;
     static Context* instance_;
     vk::SurfaceKHR surface_ = nullptr;
     GetSurfaceCallback getSurfaceCb_ = nullptr;
 
     Context(std::vector<const char*>& extensions, GetSurfaceCallback);
-    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
     vk::Instance CreateInstance(std::vector<const char*>& extensions);
     vk::PhysicalDevice PickupPhysicalDevice();
     vk::Device CreateDevice(vk::SurfaceKHR);
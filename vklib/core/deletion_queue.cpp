@@ -0,0 +1,76 @@
+#include "deletion_queue.hpp"
+#include "core/context.hpp"
+
+#include <algorithm>
+
+namespace ida {
+IdaDeletionQueue::IdaDeletionQueue(uint32_t framesInFlight) : framesInFlight_(framesInFlight) {}
+
+IdaDeletionQueue::~IdaDeletionQueue() {
+    Flush();
+}
+
+void IdaDeletionQueue::Push(std::function<void()>&& deleter) {
+    auto& batcher = Context::GetInstance().uploadBatcher;
+    // commands already recorded into the batcher may still reference the resource
+    UploadToken token = batcher ? batcher->GetPendingToken() : 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back({frame_, token, token == 0, std::move(deleter)});
+}
+
+void IdaDeletionQueue::BeginFrame() {
+    auto& batcher = Context::GetInstance().uploadBatcher;
+    std::vector<std::function<void()>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frame_++;
+        auto it = std::remove_if(entries_.begin(), entries_.end(), [&](Entry& entry) {
+            if (!entry.uploadAvailable) {
+                if (!batcher->IsAvailable(entry.uploadToken)) {
+                    return false;
+                }
+                // the acquire barrier naming the resource may have been recorded into this frame
+                entry.uploadAvailable = true;
+                entry.frame = std::max(entry.frame, frame_);
+            }
+            if (entry.frame + framesInFlight_ > frame_) {
+                return false;
+            }
+            released.push_back(std::move(entry.deleter));
+            return true;
+        });
+        entries_.erase(it, entries_.end());
+    }
+    // deleters run unlocked, they may push again (e.g. a model releasing its buffers)
+    for (auto& deleter : released) {
+        deleter();
+    }
+}
+
+void IdaDeletionQueue::Flush() {
+    while (true) {
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries.swap(entries_);
+        }
+        if (entries.empty()) {
+            return;
+        }
+        for (auto& entry : entries) {
+            entry.deleter();
+        }
+    }
+}
+
+uint64_t IdaDeletionQueue::GetFrameIndex() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_;
+}
+
+size_t IdaDeletionQueue::GetPendingCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+} // namespace ida
@@ -0,0 +1,49 @@
+#ifndef VULKAN_LIB_DELETION_QUEUE_HPP
+#define VULKAN_LIB_DELETION_QUEUE_HPP
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "buffer/upload_batcher.hpp"
+
+namespace ida {
+/**
+ * Defers destruction of GPU objects until no frame in flight, and no pending upload, can still use them.
+ *
+ * Push() stamps the deleter with the frame being recorded and with the upload batch that is currently
+ * open. The renderer calls BeginFrame() once the swap chain has waited on the frame's fence, which
+ * proves every frame framesInFlight behind it has finished, and entries older than that whose upload
+ * batch has been handed to the graphics queue are released.
+ */
+class IdaDeletionQueue final {
+  public:
+    explicit IdaDeletionQueue(uint32_t framesInFlight);
+    ~IdaDeletionQueue();
+    IdaDeletionQueue(const IdaDeletionQueue&) = delete;
+    IdaDeletionQueue& operator=(const IdaDeletionQueue&) = delete;
+
+    void Push(std::function<void()>&& deleter);
+    void BeginFrame();
+    // Releases everything, the caller guarantees the device is idle
+    void Flush();
+
+    uint64_t GetFrameIndex();
+    size_t GetPendingCount();
+
+  private:
+    struct Entry {
+        uint64_t frame;
+        UploadToken uploadToken;
+        bool uploadAvailable;
+        std::function<void()> deleter;
+    };
+
+    uint32_t framesInFlight_;
+    uint64_t frame_ = 0;
+    std::vector<Entry> entries_;
+    std::mutex mutex_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_DELETION_QUEUE_HPP
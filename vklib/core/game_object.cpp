@@ -59,6 +59,34 @@ glm::mat3 TransformComponent::normalMatrix() {
     };
 }
 
+TransformComponent TransformComponent::FromMatrix(const glm::mat4& matrix) {
+    TransformComponent transform{};
+    transform.translation = glm::vec3(matrix[3]);
+    glm::vec3 axes[3] = {glm::vec3(matrix[0]), glm::vec3(matrix[1]), glm::vec3(matrix[2])};
+    for (int i = 0; i < 3; i++) {
+        transform.scale[i] = glm::length(axes[i]);
+        if (transform.scale[i] > 0.0f) {
+            axes[i] /= transform.scale[i];
+        }
+    }
+    if (glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f) {
+        transform.scale.x = -transform.scale.x;
+        axes[0] = -axes[0];
+    }
+
+    // mat4() rotates by Y(rotation.y) * X(rotation.x) * Z(rotation.z)
+    transform.rotation.x = glm::asin(glm::clamp(-axes[2].y, -1.0f, 1.0f));
+    if (glm::abs(axes[2].y) < 0.9999f) {
+        transform.rotation.y = glm::atan(axes[2].x, axes[2].z);
+        transform.rotation.z = glm::atan(axes[0].y, axes[1].y);
+    } else {
+        // gimbal lock, only the sum of the y and z angles is defined
+        transform.rotation.y = glm::atan(-axes[0].z, axes[0].x);
+        transform.rotation.z = 0.0f;
+    }
+    return transform;
+}
+
 IdaGameObject IdaGameObject::MakePointLight(float intensity, float radius, glm::vec3 color) {
     IdaGameObject gameObj = IdaGameObject::CreateGameObject(GameObjectType::Light);
     gameObj.color = color;
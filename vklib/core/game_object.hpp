@@ -29,6 +29,9 @@ struct TransformComponent {
     glm::mat4 mat4();
 
     glm::mat3 normalMatrix();
+
+    // Inverse of mat4() for affine matrices without shear, mirroring is folded into scale.x
+    static TransformComponent FromMatrix(const glm::mat4& matrix);
 };
 
 struct PointLightComponent {
@@ -0,0 +1,103 @@
+#include "mapped_file.hpp"
+
+#include "log/log.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ida {
+#ifdef _WIN32
+IdaMappedFile::IdaMappedFile(const std::string& path) : path_(path) {
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        IO::ThrowError("Failed to open file: {}", path);
+    }
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        IO::ThrowError("Failed to query the size of file: {}", path);
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    // mapping an empty file fails, an empty view is all we need
+    if (size_ == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        IO::ThrowError("Failed to map file: {}", path);
+    }
+    mapping_ = mapping;
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        IO::ThrowError("Failed to map file: {}", path);
+    }
+}
+
+IdaMappedFile::~IdaMappedFile() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(mapping_));
+    }
+    if (file_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(file_));
+    }
+}
+#else
+IdaMappedFile::IdaMappedFile(const std::string& path) : path_(path) {
+    file_ = open(path.c_str(), O_RDONLY);
+    if (file_ < 0) {
+        IO::ThrowError("Failed to open file: {}", path);
+    }
+
+    struct stat info {};
+    if (fstat(file_, &info) != 0) {
+        close(file_);
+        IO::ThrowError("Failed to query the size of file: {}", path);
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ == 0) {
+        return;
+    }
+
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+    if (data == MAP_FAILED) {
+        close(file_);
+        IO::ThrowError("Failed to map file: {}", path);
+    }
+    // the file is read front to back by every worker, let the kernel read ahead aggressively
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+}
+
+IdaMappedFile::~IdaMappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    if (file_ >= 0) {
+        close(file_);
+    }
+}
+#endif
+} // namespace ida
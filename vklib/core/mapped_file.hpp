@@ -0,0 +1,37 @@
+#ifndef VULKAN_LIB_MAPPED_FILE_HPP
+#define VULKAN_LIB_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace ida {
+/**
+ * Read-only memory mapping of a whole file. The pages are faulted in lazily by the OS, so large
+ * files can be scanned by several threads without first copying them into a std::string.
+ */
+class IdaMappedFile final {
+  public:
+    explicit IdaMappedFile(const std::string& path);
+    ~IdaMappedFile();
+    IdaMappedFile(const IdaMappedFile&) = delete;
+    IdaMappedFile& operator=(const IdaMappedFile&) = delete;
+
+    const char* GetData() const { return data_; }
+    size_t GetSize() const { return size_; }
+    const std::string& GetPath() const { return path_; }
+
+  private:
+    std::string path_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int file_ = -1;
+#endif
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_MAPPED_FILE_HPP
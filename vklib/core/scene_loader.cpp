@@ -0,0 +1,38 @@
+#include "scene_loader.hpp"
+
+#include "log/log.hpp"
+#include "model/gltf_loader.hpp"
+
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace ida {
+std::vector<IdaGameObject> IdaSceneLoader::LoadGltf(const std::string& path, const IdaModel::ImportOptions& options) {
+    std::shared_ptr<const GltfAsset> asset = IdaGltfLoader::Load(path);
+    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<IdaModel>> models;
+    std::vector<IdaGameObject> objects;
+    for (uint32_t index : asset->sceneNodes) {
+        const GltfNode& node = asset->nodes[index];
+        if (node.mesh < 0) {
+            continue;
+        }
+        const auto& primitives = asset->meshes[node.mesh].primitives;
+        for (uint32_t i = 0; i < primitives.size(); i++) {
+            if (primitives[i].mode != GltfPrimitive::MODE_TRIANGLES) {
+                continue;
+            }
+            auto& model = models[{static_cast<uint32_t>(node.mesh), i}];
+            if (!model) {
+                model = IdaModel::CreateModel(*IdaModel::ParseGltfPrimitive(asset, node.mesh, i, options));
+            }
+            auto object = IdaGameObject::CreateGameObject(GameObjectType::Model);
+            object.model = model;
+            object.transform = TransformComponent::FromMatrix(node.worldTransform);
+            objects.push_back(std::move(object));
+        }
+    }
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Loaded glTF scene {}: {} objects sharing {} models", path, objects.size(), models.size());
+    return objects;
+}
+} // namespace ida
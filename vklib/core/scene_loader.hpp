@@ -0,0 +1,23 @@
+#ifndef VULKAN_LIB_SCENE_LOADER_HPP
+#define VULKAN_LIB_SCENE_LOADER_HPP
+
+#include <string>
+#include <vector>
+
+#include "core/game_object.hpp"
+#include "model/model.hpp"
+
+namespace ida {
+/**
+ * Turns the default scene of a glTF file into game objects: one per triangle primitive of every
+ * node with a mesh, placed at the node's world transform. Nodes instancing the same mesh share its
+ * models, and primitives laid out like IdaModel::Vertex upload straight from the mapped file.
+ */
+class IdaSceneLoader final {
+  public:
+    // Creates the models on the calling thread, which must be the one recording the frames
+    static std::vector<IdaGameObject> LoadGltf(const std::string& path, const IdaModel::ImportOptions& options = {});
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_SCENE_LOADER_HPP
@@ -3,6 +3,7 @@
 
 #include "glm/glm.hpp"
 
+#include "buffer/frame_allocator.hpp"
 #include "camera/camera.hpp"
 #include "core/game_object.hpp"
 
@@ -31,6 +32,10 @@ struct FrameInfo {
     IdaCamera& camera;
     vk::DescriptorSet globalDescriptorSet;
     IdaGameObject::Map& gameObjects;
+    IdaFrameAllocator& frameAllocator;
+    // dynamic offset of this frame's GlobalUbo inside frameAllocator
+    uint32_t globalUboOffset;
+    vk::Extent2D extent;
 };
 } // namespace ida
 #endif // VULKAN_LIB_GLOBAL_INFO_HPP
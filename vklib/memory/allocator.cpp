@@ -0,0 +1,371 @@
+#include "allocator.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+
+namespace ida {
+static vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+}
+
+static vk::DeviceSize AlignDown(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return alignment > 1 ? value & ~(alignment - 1) : value;
+}
+
+void* IdaAllocation::GetMappedData() const {
+    if (block == nullptr || block->GetMappedData() == nullptr) {
+        return nullptr;
+    }
+    return static_cast<char*>(block->GetMappedData()) + offset;
+}
+
+// ******************************* IdaMemoryBlock *******************************
+IdaMemoryBlock::IdaMemoryBlock(vk::DeviceMemory memory, vk::DeviceSize size, AllocationMode mode, void* mapped)
+    : memory_(memory), size_(size), mode_(mode), mapped_(mapped), freeList_(size) {}
+
+bool IdaMemoryBlock::Allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset) {
+    if (mode_ == AllocationMode::Linear) {
+        auto aligned = AlignUp(linearHead_, alignment);
+        if (aligned + size > size_) {
+            return false;
+        }
+        offset = aligned;
+        linearHead_ = aligned + size;
+        allocationCount_++;
+        usedBytes_ += size;
+        return true;
+    }
+
+    if (!freeList_.Allocate(size, alignment, offset)) {
+        return false;
+    }
+    allocationCount_++;
+    usedBytes_ += size;
+    return true;
+}
+
+void IdaMemoryBlock::Free(vk::DeviceSize offset, vk::DeviceSize size) {
+    allocationCount_--;
+    usedBytes_ -= size;
+
+    if (mode_ == AllocationMode::Linear) {
+        if (allocationCount_ == 0) {
+            linearHead_ = 0;
+        }
+        return;
+    }
+
+    freeList_.Free(offset, size);
+}
+
+// ******************************* IdaMemoryPool *******************************
+IdaMemoryPool::IdaMemoryPool(
+    vk::Device device,
+    uint32_t memoryTypeIndex,
+    bool hostVisible,
+    AllocationMode mode,
+    vk::DeviceSize blockSize)
+    : device_(device), memoryTypeIndex_(memoryTypeIndex), hostVisible_(hostVisible), mode_(mode), blockSize_(blockSize) {}
+
+IdaMemoryPool::~IdaMemoryPool() {
+    for (auto& block : blocks_) {
+        if (!block->IsEmpty()) {
+            IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Memory block destroyed with {} live allocations", block->GetAllocationCount());
+        }
+        if (block->GetMappedData()) {
+            device_.unmapMemory(block->GetMemory());
+        }
+        device_.freeMemory(block->GetMemory());
+    }
+    blocks_.clear();
+}
+
+IdaAllocation* IdaMemoryPool::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+    vk::DeviceSize offset = 0;
+    IdaMemoryBlock* target = nullptr;
+
+    // large requests get a block of their own so they don't waste the tail of a shared one
+    if (size > blockSize_ / 2) {
+        target = CreateBlock(size);
+        target->Allocate(size, alignment, offset);
+    } else {
+        for (auto& block : blocks_) {
+            if (block->GetSize() == blockSize_ && block->Allocate(size, alignment, offset)) {
+                target = block.get();
+                break;
+            }
+        }
+        if (target == nullptr) {
+            target = CreateBlock(blockSize_);
+            if (!target->Allocate(size, alignment, offset)) {
+                IO::ThrowError("Failed to sub-allocate {} bytes from a fresh memory block", size);
+            }
+        }
+    }
+
+    return CreateAllocation(target, offset, size);
+}
+
+IdaAllocation* IdaMemoryPool::AllocateForMove(vk::DeviceSize size, vk::DeviceSize alignment, const IdaMemoryBlock* source) {
+    // fullest blocks first, so live data piles up in as few blocks as possible
+    std::vector<IdaMemoryBlock*> targets;
+    for (auto& block : blocks_) {
+        if (block.get() != source && IsSharedBlock(block.get()) && block->GetUsedBytes() >= source->GetUsedBytes()) {
+            targets.push_back(block.get());
+        }
+    }
+    std::sort(targets.begin(), targets.end(), [](auto* a, auto* b) { return a->GetUsedBytes() > b->GetUsedBytes(); });
+    for (auto* block : targets) {
+        vk::DeviceSize offset = 0;
+        if (block->Allocate(size, alignment, offset)) {
+            return CreateAllocation(block, offset, size);
+        }
+    }
+    return nullptr;
+}
+
+IdaAllocation* IdaMemoryPool::CreateAllocation(IdaMemoryBlock* block, vk::DeviceSize offset, vk::DeviceSize size) {
+    auto allocation = new IdaAllocation();
+    allocation->memory = block->GetMemory();
+    allocation->offset = offset;
+    allocation->size = size;
+    allocation->memoryTypeIndex = memoryTypeIndex_;
+    allocation->block = block;
+    allocation->pool = this;
+    return allocation;
+}
+
+void IdaMemoryPool::Free(IdaAllocation* allocation) {
+    auto block = allocation->block;
+    block->Free(allocation->offset, allocation->size);
+    delete allocation;
+
+    if (!block->IsEmpty()) {
+        return;
+    }
+    // dedicated blocks go straight away, shared ones are kept while they are the only empty block
+    bool keep = block->GetSize() == blockSize_ &&
+                std::none_of(blocks_.begin(), blocks_.end(), [&](const auto& other) {
+                    return other.get() != block && other->IsEmpty() && other->GetSize() == blockSize_;
+                });
+    if (!keep) {
+        DestroyBlock(block);
+    }
+}
+
+IdaMemoryBlock* IdaMemoryPool::CreateBlock(vk::DeviceSize size) {
+    auto allocInfo = vk::MemoryAllocateInfo()
+                         .setAllocationSize(size)
+                         .setMemoryTypeIndex(memoryTypeIndex_);
+    auto memory = device_.allocateMemory(allocInfo);
+    void* mapped = nullptr;
+    if (hostVisible_) {
+        mapped = device_.mapMemory(memory, 0, vk::WholeSize, vk::MemoryMapFlags());
+    }
+    blocks_.push_back(std::make_unique<IdaMemoryBlock>(memory, size, mode_, mapped));
+    return blocks_.back().get();
+}
+
+void IdaMemoryPool::DestroyBlock(IdaMemoryBlock* block) {
+    auto it = std::find_if(blocks_.begin(), blocks_.end(), [&](const auto& b) { return b.get() == block; });
+    if (it == blocks_.end()) {
+        return;
+    }
+    if (block->GetMappedData()) {
+        device_.unmapMemory(block->GetMemory());
+    }
+    device_.freeMemory(block->GetMemory());
+    blocks_.erase(it);
+}
+
+// ******************************* IdaAllocator *******************************
+IdaAllocator::IdaAllocator(vk::PhysicalDevice phyDevice, vk::Device device, bool memoryBudgetSupported)
+    : phyDevice_(phyDevice), device_(device), memoryBudgetSupported_(memoryBudgetSupported) {
+    memProperties_ = phyDevice.getMemoryProperties();
+    nonCoherentAtomSize_ = phyDevice.getProperties().limits.nonCoherentAtomSize;
+}
+
+IdaAllocator::~IdaAllocator() {
+    PrintStatistics();
+    customPools_.clear();
+    for (auto& pools : defaultPools_) {
+        for (auto& pool : pools) {
+            pool.reset();
+        }
+    }
+}
+
+IdaAllocation* IdaAllocator::Allocate(
+    const vk::MemoryRequirements& requirements,
+    vk::MemoryPropertyFlags properties,
+    ResourceKind kind,
+    IdaMemoryPool* pool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pool == nullptr) {
+        auto typeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+        auto& defaultPool = defaultPools_[static_cast<int>(kind)][typeIndex];
+        if (!defaultPool) {
+            bool hostVisible = static_cast<bool>(memProperties_.memoryTypes[typeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+            defaultPool = std::make_unique<IdaMemoryPool>(device_, typeIndex, hostVisible, AllocationMode::FreeList, GetPreferredBlockSize(typeIndex));
+        }
+        pool = defaultPool.get();
+    }
+    IO::Assert(requirements.memoryTypeBits & (1u << pool->GetMemoryTypeIndex()), "Memory pool type does not match resource requirements");
+    return pool->Allocate(requirements.size, requirements.alignment);
+}
+
+IdaAllocation* IdaAllocator::AllocateForBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties, IdaMemoryPool* pool) {
+    auto requirements = device_.getBufferMemoryRequirements(buffer);
+    auto allocation = Allocate(requirements, properties, ResourceKind::Buffer, pool);
+    device_.bindBufferMemory(buffer, allocation->memory, allocation->offset);
+    return allocation;
+}
+
+IdaAllocation* IdaAllocator::AllocateForImage(vk::Image image, vk::MemoryPropertyFlags properties, IdaMemoryPool* pool) {
+    auto requirements = device_.getImageMemoryRequirements(image);
+    auto allocation = Allocate(requirements, properties, ResourceKind::Image, pool);
+    device_.bindImageMemory(image, allocation->memory, allocation->offset);
+    return allocation;
+}
+
+void IdaAllocator::Free(IdaAllocation* allocation) {
+    if (allocation == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    allocation->pool->Free(allocation);
+}
+
+IdaAllocation* IdaAllocator::AllocateForMove(const vk::MemoryRequirements& requirements, const IdaAllocation* source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pool = source->pool;
+    if (pool->GetMode() != AllocationMode::FreeList || !(requirements.memoryTypeBits & (1u << pool->GetMemoryTypeIndex()))) {
+        return nullptr;
+    }
+    return pool->AllocateForMove(requirements.size, requirements.alignment, source->block);
+}
+
+IdaMemoryPool* IdaAllocator::CreatePool(uint32_t memoryTypeIndex, AllocationMode mode, vk::DeviceSize blockSize) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool hostVisible = static_cast<bool>(memProperties_.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+    if (blockSize == 0) {
+        blockSize = GetPreferredBlockSize(memoryTypeIndex);
+    }
+    customPools_.push_back(std::make_unique<IdaMemoryPool>(device_, memoryTypeIndex, hostVisible, mode, blockSize));
+    return customPools_.back().get();
+}
+
+void IdaAllocator::DestroyPool(IdaMemoryPool* pool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(customPools_.begin(), customPools_.end(), [&](const auto& p) { return p.get() == pool; });
+    if (it != customPools_.end()) {
+        customPools_.erase(it);
+    }
+}
+
+vk::MappedMemoryRange IdaAllocator::GetAlignedRange(IdaAllocation* allocation, vk::DeviceSize size, vk::DeviceSize offset) const {
+    if (size == vk::WholeSize) {
+        size = allocation->size - offset;
+    }
+    // ranges on non-coherent memory must start and end on nonCoherentAtomSize, clamp to the block end
+    auto begin = AlignDown(allocation->offset + offset, nonCoherentAtomSize_);
+    auto end = std::min(AlignUp(allocation->offset + offset + size, nonCoherentAtomSize_), allocation->block->GetSize());
+    return vk::MappedMemoryRange()
+        .setMemory(allocation->memory)
+        .setOffset(begin)
+        .setSize(end - begin);
+}
+
+void IdaAllocator::Flush(IdaAllocation* allocation, vk::DeviceSize size, vk::DeviceSize offset) {
+    if (IsHostCoherent(allocation->memoryTypeIndex)) {
+        return;
+    }
+    device_.flushMappedMemoryRanges(GetAlignedRange(allocation, size, offset));
+}
+
+void IdaAllocator::Invalidate(IdaAllocation* allocation, vk::DeviceSize size, vk::DeviceSize offset) {
+    if (IsHostCoherent(allocation->memoryTypeIndex)) {
+        return;
+    }
+    device_.invalidateMappedMemoryRanges(GetAlignedRange(allocation, size, offset));
+}
+
+uint32_t IdaAllocator::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memProperties_.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties_.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    IO::ThrowError("Failed to find suitable memory type!");
+    return 0;
+}
+
+bool IdaAllocator::IsHostCoherent(uint32_t memoryTypeIndex) const {
+    return static_cast<bool>(memProperties_.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+vk::DeviceSize IdaAllocator::GetPreferredBlockSize(uint32_t memoryTypeIndex) const {
+    auto heapIndex = memProperties_.memoryTypes[memoryTypeIndex].heapIndex;
+    auto heapSize = memProperties_.memoryHeaps[heapIndex].size;
+    return heapSize <= SMALL_HEAP_LIMIT ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+}
+
+void IdaAllocator::GetHeapBudget(uint32_t heapIndex, vk::DeviceSize& usage, vk::DeviceSize& budget) {
+    if (memoryBudgetSupported_) {
+        auto properties = phyDevice_.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        auto& budgetProperties = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        usage = budgetProperties.heapUsage[heapIndex];
+        budget = budgetProperties.heapBudget[heapIndex];
+        return;
+    }
+    usage = GetHeapStatistics()[heapIndex].blockBytes;
+    budget = memProperties_.memoryHeaps[heapIndex].size / 10 * 8;
+}
+
+std::vector<HeapStatistics> IdaAllocator::GetHeapStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<HeapStatistics> stats(memProperties_.memoryHeapCount);
+    for (uint32_t i = 0; i < memProperties_.memoryHeapCount; i++) {
+        stats[i].heapSize = memProperties_.memoryHeaps[i].size;
+        stats[i].heapFlags = memProperties_.memoryHeaps[i].flags;
+    }
+
+    auto accumulate = [&](const IdaMemoryPool& pool) {
+        auto& heap = stats[memProperties_.memoryTypes[pool.GetMemoryTypeIndex()].heapIndex];
+        for (auto& block : pool.GetBlocks()) {
+            heap.blockCount++;
+            heap.blockBytes += block->GetSize();
+            heap.allocationCount += block->GetAllocationCount();
+            heap.allocationBytes += block->GetUsedBytes();
+        }
+    };
+    for (auto& pools : defaultPools_) {
+        for (auto& pool : pools) {
+            if (pool) {
+                accumulate(*pool);
+            }
+        }
+    }
+    for (auto& pool : customPools_) {
+        accumulate(*pool);
+    }
+    return stats;
+}
+
+void IdaAllocator::PrintStatistics() {
+    auto stats = GetHeapStatistics();
+    for (size_t i = 0; i < stats.size(); i++) {
+        auto& heap = stats[i];
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO,
+                     "Heap {}{}: {} blocks ({} bytes), {} allocations ({} bytes), heap size {} bytes",
+                     i,
+                     heap.heapFlags & vk::MemoryHeapFlagBits::eDeviceLocal ? " (device local)" : "",
+                     heap.blockCount,
+                     heap.blockBytes,
+                     heap.allocationCount,
+                     heap.allocationBytes,
+                     heap.heapSize);
+    }
+}
+
+} // namespace ida
@@ -0,0 +1,174 @@
+#ifndef VULKAN_LIB_ALLOCATOR_HPP
+#define VULKAN_LIB_ALLOCATOR_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "memory/range_allocator.hpp"
+
+namespace ida {
+
+enum class AllocationMode {
+    FreeList, // general purpose, freed ranges are coalesced and reused
+    Linear,   // bump allocator, a block is recycled once all its allocations are freed
+};
+
+// Buffers and optimal-tiling images are kept in separate blocks so we never have to
+// care about bufferImageGranularity between neighbouring allocations.
+enum class ResourceKind {
+    Buffer,
+    Image,
+};
+
+class IdaMemoryBlock;
+class IdaMemoryPool;
+
+struct IdaAllocation {
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+
+    IdaMemoryBlock* block = nullptr;
+    IdaMemoryPool* pool = nullptr;
+
+    // Persistently mapped pointer to the start of this allocation, null if the memory is not host visible
+    void* GetMappedData() const;
+};
+
+struct HeapStatistics {
+    vk::DeviceSize heapSize = 0;
+    vk::MemoryHeapFlags heapFlags;
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    vk::DeviceSize blockBytes = 0;
+    vk::DeviceSize allocationBytes = 0;
+};
+
+class IdaMemoryBlock final {
+  public:
+    IdaMemoryBlock(vk::DeviceMemory memory, vk::DeviceSize size, AllocationMode mode, void* mapped);
+    IdaMemoryBlock(const IdaMemoryBlock&) = delete;
+    IdaMemoryBlock& operator=(const IdaMemoryBlock&) = delete;
+
+    bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+    void Free(vk::DeviceSize offset, vk::DeviceSize size);
+
+    vk::DeviceMemory GetMemory() const { return memory_; }
+    vk::DeviceSize GetSize() const { return size_; }
+    vk::DeviceSize GetUsedBytes() const { return usedBytes_; }
+    uint32_t GetAllocationCount() const { return allocationCount_; }
+    void* GetMappedData() const { return mapped_; }
+    bool IsEmpty() const { return allocationCount_ == 0; }
+
+  private:
+    vk::DeviceMemory memory_;
+    vk::DeviceSize size_;
+    AllocationMode mode_;
+    void* mapped_ = nullptr;
+
+    IdaRangeAllocator freeList_; // only used in free-list mode
+    vk::DeviceSize linearHead_ = 0;
+
+    uint32_t allocationCount_ = 0;
+    vk::DeviceSize usedBytes_ = 0;
+};
+
+class IdaMemoryPool final {
+  public:
+    IdaMemoryPool(
+        vk::Device device,
+        uint32_t memoryTypeIndex,
+        bool hostVisible,
+        AllocationMode mode,
+        vk::DeviceSize blockSize);
+    ~IdaMemoryPool();
+    IdaMemoryPool(const IdaMemoryPool&) = delete;
+    IdaMemoryPool& operator=(const IdaMemoryPool&) = delete;
+
+    IdaAllocation* Allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+    // Places an allocation in an existing shared block fuller than source, never creates a block
+    IdaAllocation* AllocateForMove(vk::DeviceSize size, vk::DeviceSize alignment, const IdaMemoryBlock* source);
+    void Free(IdaAllocation* allocation);
+    // Whether the block is shared between allocations rather than dedicated to a large one
+    bool IsSharedBlock(const IdaMemoryBlock* block) const { return block->GetSize() == blockSize_; }
+
+    uint32_t GetMemoryTypeIndex() const { return memoryTypeIndex_; }
+    AllocationMode GetMode() const { return mode_; }
+    vk::DeviceSize GetBlockSize() const { return blockSize_; }
+    const std::vector<std::unique_ptr<IdaMemoryBlock>>& GetBlocks() const { return blocks_; }
+
+  private:
+    IdaAllocation* CreateAllocation(IdaMemoryBlock* block, vk::DeviceSize offset, vk::DeviceSize size);
+    IdaMemoryBlock* CreateBlock(vk::DeviceSize size);
+    void DestroyBlock(IdaMemoryBlock* block);
+
+    vk::Device device_;
+    uint32_t memoryTypeIndex_;
+    bool hostVisible_;
+    AllocationMode mode_;
+    vk::DeviceSize blockSize_;
+
+    std::vector<std::unique_ptr<IdaMemoryBlock>> blocks_;
+};
+
+class IdaAllocator final {
+  public:
+    static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+    static constexpr vk::DeviceSize SMALL_HEAP_LIMIT = 1024ull * 1024 * 1024;
+
+    IdaAllocator(vk::PhysicalDevice phyDevice, vk::Device device, bool memoryBudgetSupported = false);
+    ~IdaAllocator();
+    IdaAllocator(const IdaAllocator&) = delete;
+    IdaAllocator& operator=(const IdaAllocator&) = delete;
+
+    IdaAllocation* Allocate(
+        const vk::MemoryRequirements& requirements,
+        vk::MemoryPropertyFlags properties,
+        ResourceKind kind = ResourceKind::Buffer,
+        IdaMemoryPool* pool = nullptr);
+    IdaAllocation* AllocateForBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties, IdaMemoryPool* pool = nullptr);
+    IdaAllocation* AllocateForImage(vk::Image image, vk::MemoryPropertyFlags properties, IdaMemoryPool* pool = nullptr);
+    void Free(IdaAllocation* allocation);
+    // Used by the defragmenter to find a better home for an existing allocation, null if there is none
+    IdaAllocation* AllocateForMove(const vk::MemoryRequirements& requirements, const IdaAllocation* source);
+
+    // Custom pools, e.g. a linear pool for transient data. Pools must be destroyed before the allocator.
+    IdaMemoryPool* CreatePool(uint32_t memoryTypeIndex, AllocationMode mode, vk::DeviceSize blockSize = 0);
+    void DestroyPool(IdaMemoryPool* pool);
+
+    void Flush(IdaAllocation* allocation, vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
+    void Invalidate(IdaAllocation* allocation, vk::DeviceSize size = vk::WholeSize, vk::DeviceSize offset = 0);
+
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+    bool IsHostCoherent(uint32_t memoryTypeIndex) const;
+    const vk::PhysicalDeviceMemoryProperties& GetMemoryProperties() const { return memProperties_; }
+
+    // Current usage and budget of a heap, from VK_EXT_memory_budget when available, otherwise our own
+    // block usage against 80% of the heap size
+    void GetHeapBudget(uint32_t heapIndex, vk::DeviceSize& usage, vk::DeviceSize& budget);
+    std::vector<HeapStatistics> GetHeapStatistics();
+    void PrintStatistics();
+
+  private:
+    vk::DeviceSize GetPreferredBlockSize(uint32_t memoryTypeIndex) const;
+    vk::MappedMemoryRange GetAlignedRange(IdaAllocation* allocation, vk::DeviceSize size, vk::DeviceSize offset) const;
+
+    vk::PhysicalDevice phyDevice_;
+    vk::Device device_;
+    bool memoryBudgetSupported_;
+    vk::PhysicalDeviceMemoryProperties memProperties_;
+    vk::DeviceSize nonCoherentAtomSize_;
+
+    // default pools indexed by [kind][memoryTypeIndex]
+    std::unique_ptr<IdaMemoryPool> defaultPools_[2][VK_MAX_MEMORY_TYPES];
+    std::vector<std::unique_ptr<IdaMemoryPool>> customPools_;
+    std::mutex mutex_;
+};
+
+} // namespace ida
+
+#endif // VULKAN_LIB_ALLOCATOR_HPP
@@ -0,0 +1,158 @@
+#include "defragmenter.hpp"
+#include "buffer/buffer.hpp"
+#include "core/context.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+
+namespace ida {
+IdaDefragmenter::IdaDefragmenter(uint32_t framesInFlight, vk::DeviceSize maxBytesPerFrame)
+    : framesInFlight_(framesInFlight), maxBytesPerFrame_(maxBytesPerFrame) {}
+
+void IdaDefragmenter::Register(IdaBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    movable_.insert(buffer);
+}
+
+void IdaDefragmenter::Unregister(IdaBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    movable_.erase(buffer);
+}
+
+void IdaDefragmenter::Begin() {
+    if (state_ != State::Idle) {
+        return;
+    }
+    Snapshot(startBlockCount_, startBlockBytes_);
+    stats_ = DefragmentationStats{};
+    lastMoveFrame_ = Context::GetInstance().deletionQueue->GetFrameIndex();
+    state_ = State::Moving;
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Defragmentation started: {} blocks, {} bytes", startBlockCount_, startBlockBytes_);
+}
+
+void IdaDefragmenter::Step(vk::CommandBuffer cmd) {
+    if (state_ == State::Idle) {
+        return;
+    }
+    auto& ctx = Context::GetInstance();
+    auto frame = ctx.deletionQueue->GetFrameIndex();
+    stats_.frames++;
+
+    if (state_ == State::Moving) {
+        // a pending upload could still write to a source range, or its barriers name the old buffer
+        if (!ctx.uploadBatcher->IsAvailable(ctx.uploadBatcher->GetPendingToken())) {
+            return;
+        }
+        uint32_t moved = 0;
+        auto bytes = ctx.geometryArena->Compact(cmd, maxBytesPerFrame_, moved);
+        if (bytes < maxBytesPerFrame_) {
+            bytes += MoveBuffers(cmd, maxBytesPerFrame_ - bytes, moved);
+        }
+        if (moved == 0) {
+            state_ = State::Draining;
+            return;
+        }
+        // the copies have to land before anything recorded later in this frame reads the new ranges
+        auto barrier = vk::MemoryBarrier()
+                           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                           .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                            vk::PipelineStageFlagBits::eAllCommands,
+                            vk::DependencyFlags(),
+                            barrier,
+                            nullptr,
+                            nullptr);
+        stats_.bytesMoved += bytes;
+        stats_.allocationsMoved += moved;
+        lastMoveFrame_ = frame;
+        return;
+    }
+
+    // pages only become empty once the deletion queue has freed the ranges moved out of them
+    auto pages = ctx.geometryArena->ReleaseEmptyPages();
+    if (pages > 0) {
+        stats_.pagesFreed += pages;
+        lastMoveFrame_ = frame;
+    }
+    if (frame < lastMoveFrame_ + framesInFlight_) {
+        return;
+    }
+
+    uint32_t blockCount = 0;
+    vk::DeviceSize blockBytes = 0;
+    Snapshot(blockCount, blockBytes);
+    stats_.blocksFreed = startBlockCount_ > blockCount ? startBlockCount_ - blockCount : 0;
+    stats_.bytesFreed = startBlockBytes_ > blockBytes ? startBlockBytes_ - blockBytes : 0;
+    lastStats_ = stats_;
+    state_ = State::Idle;
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO,
+                 "Defragmentation finished in {} frames: moved {} allocations ({} bytes), freed {} blocks ({} bytes) and {} geometry pages",
+                 stats_.frames,
+                 stats_.allocationsMoved,
+                 stats_.bytesMoved,
+                 stats_.blocksFreed,
+                 stats_.bytesFreed,
+                 stats_.pagesFreed);
+}
+
+vk::DeviceSize IdaDefragmenter::MoveBuffers(vk::CommandBuffer cmd, vk::DeviceSize maxBytes, uint32_t& movedCount) {
+    auto& ctx = Context::GetInstance();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // host visible buffers are skipped, their mapped pointers are handed out to callers
+    std::vector<IdaBuffer*> candidates;
+    for (auto* buffer : movable_) {
+        auto allocation = buffer->allocation_;
+        bool copyable = (buffer->usageFlags_ & vk::BufferUsageFlagBits::eTransferSrc) &&
+                        (buffer->usageFlags_ & vk::BufferUsageFlagBits::eTransferDst);
+        if (copyable && !(buffer->memoryFlags_ & vk::MemoryPropertyFlagBits::eHostVisible) &&
+            allocation->pool->IsSharedBlock(allocation->block)) {
+            candidates.push_back(buffer);
+        }
+    }
+    // empty the least used blocks first
+    std::sort(candidates.begin(), candidates.end(), [](auto* a, auto* b) {
+        return a->allocation_->block->GetUsedBytes() < b->allocation_->block->GetUsedBytes();
+    });
+
+    vk::DeviceSize moved = 0;
+    for (auto* buffer : candidates) {
+        if (moved >= maxBytes) {
+            break;
+        }
+        auto createInfo = vk::BufferCreateInfo()
+                              .setSize(buffer->bufferSize_)
+                              .setUsage(buffer->usageFlags_)
+                              .setSharingMode(vk::SharingMode::eExclusive);
+        auto newBuffer = ctx.device.createBuffer(createInfo);
+        auto newAllocation = ctx.allocator->AllocateForMove(ctx.device.getBufferMemoryRequirements(newBuffer), buffer->allocation_);
+        if (newAllocation == nullptr) {
+            ctx.device.destroyBuffer(newBuffer);
+            continue;
+        }
+        ctx.device.bindBufferMemory(newBuffer, newAllocation->memory, newAllocation->offset);
+        cmd.copyBuffer(buffer->buffer_, newBuffer, vk::BufferCopy(0, 0, buffer->bufferSize_));
+
+        ctx.deletionQueue->Push([oldBuffer = buffer->buffer_, oldAllocation = buffer->allocation_]() {
+            auto& ctx = Context::GetInstance();
+            ctx.device.destroyBuffer(oldBuffer);
+            ctx.allocator->Free(oldAllocation);
+        });
+        buffer->buffer_ = newBuffer;
+        buffer->allocation_ = newAllocation;
+        moved += buffer->bufferSize_;
+        movedCount++;
+    }
+    return moved;
+}
+
+void IdaDefragmenter::Snapshot(uint32_t& blockCount, vk::DeviceSize& blockBytes) {
+    blockCount = 0;
+    blockBytes = 0;
+    for (auto& heap : Context::GetInstance().allocator->GetHeapStatistics()) {
+        blockCount += heap.blockCount;
+        blockBytes += heap.blockBytes;
+    }
+}
+
+} // namespace ida
@@ -0,0 +1,74 @@
+#ifndef VULKAN_LIB_DEFRAGMENTER_HPP
+#define VULKAN_LIB_DEFRAGMENTER_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace ida {
+class IdaBuffer;
+
+struct DefragmentationStats {
+    vk::DeviceSize bytesMoved = 0;
+    uint32_t allocationsMoved = 0;
+    vk::DeviceSize bytesFreed = 0;
+    uint32_t blocksFreed = 0;
+    uint32_t pagesFreed = 0;
+    uint32_t frames = 0;
+};
+
+/**
+ * Incremental compaction of device local memory, driven by the renderer one step per frame.
+ *
+ * A pass started with Begin() records GPU copies at the start of the frame's command buffer, at most
+ * maxBytesPerFrame per frame: model geometry is packed towards the first geometry arena pages, and
+ * buffers that opted in with IdaBuffer::SetMovable() leave the emptiest shared memory blocks for fuller
+ * ones. Handles are patched right away and the old copies are released through the deletion queue,
+ * after which emptied arena pages and memory blocks are returned and the pass reports what it freed.
+ */
+class IdaDefragmenter final {
+  public:
+    static constexpr vk::DeviceSize DEFAULT_BYTES_PER_FRAME = 8ull * 1024 * 1024;
+
+    explicit IdaDefragmenter(uint32_t framesInFlight, vk::DeviceSize maxBytesPerFrame = DEFAULT_BYTES_PER_FRAME);
+    IdaDefragmenter(const IdaDefragmenter&) = delete;
+    IdaDefragmenter& operator=(const IdaDefragmenter&) = delete;
+
+    void Register(IdaBuffer* buffer);
+    void Unregister(IdaBuffer* buffer);
+
+    void Begin();
+    // Called by the renderer right after the frame's command buffer has begun
+    void Step(vk::CommandBuffer cmd);
+
+    bool IsActive() const { return state_ != State::Idle; }
+    const DefragmentationStats& GetLastStats() const { return lastStats_; }
+    void SetMaxBytesPerFrame(vk::DeviceSize maxBytes) { maxBytesPerFrame_ = maxBytes; }
+
+  private:
+    enum class State {
+        Idle,
+        Moving,   // copies are recorded every frame until nothing can move any more
+        Draining, // waiting for the deletion queue to release what was moved away
+    };
+
+    vk::DeviceSize MoveBuffers(vk::CommandBuffer cmd, vk::DeviceSize maxBytes, uint32_t& movedCount);
+    static void Snapshot(uint32_t& blockCount, vk::DeviceSize& blockBytes);
+
+    uint32_t framesInFlight_;
+    vk::DeviceSize maxBytesPerFrame_;
+    State state_ = State::Idle;
+    uint64_t lastMoveFrame_ = 0;
+
+    uint32_t startBlockCount_ = 0;
+    vk::DeviceSize startBlockBytes_ = 0;
+    DefragmentationStats stats_;
+    DefragmentationStats lastStats_;
+
+    std::unordered_set<IdaBuffer*> movable_;
+    std::mutex mutex_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_DEFRAGMENTER_HPP
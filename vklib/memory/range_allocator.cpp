@@ -0,0 +1,65 @@
+#include "range_allocator.hpp"
+
+#include <algorithm>
+
+namespace ida {
+IdaRangeAllocator::IdaRangeAllocator(vk::DeviceSize size) : size_(size) {
+    if (size_ > 0) {
+        freeRanges_[0] = size_;
+    }
+}
+
+bool IdaRangeAllocator::Allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset) {
+    alignment = std::max<vk::DeviceSize>(alignment, 1);
+    // the leading padding and the tail go back to the free list
+    for (auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it) {
+        auto [rangeOffset, rangeSize] = *it;
+        auto aligned = (rangeOffset + alignment - 1) / alignment * alignment;
+        auto padding = aligned - rangeOffset;
+        if (padding + size > rangeSize) {
+            continue;
+        }
+        freeRanges_.erase(it);
+        if (padding > 0) {
+            freeRanges_[rangeOffset] = padding;
+        }
+        auto tail = rangeSize - padding - size;
+        if (tail > 0) {
+            freeRanges_[aligned + size] = tail;
+        }
+        offset = aligned;
+        allocationCount_++;
+        usedBytes_ += size;
+        return true;
+    }
+    return false;
+}
+
+void IdaRangeAllocator::Free(vk::DeviceSize offset, vk::DeviceSize size) {
+    allocationCount_--;
+    usedBytes_ -= size;
+
+    auto it = freeRanges_.emplace(offset, size).first;
+    auto next = std::next(it);
+    if (next != freeRanges_.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        freeRanges_.erase(next);
+    }
+    if (it != freeRanges_.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            freeRanges_.erase(it);
+        }
+    }
+}
+
+vk::DeviceSize IdaRangeAllocator::GetLargestFreeRange() const {
+    vk::DeviceSize largest = 0;
+    for (auto& [_, size] : freeRanges_) {
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
+
+} // namespace ida
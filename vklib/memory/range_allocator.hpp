@@ -0,0 +1,35 @@
+#ifndef VULKAN_LIB_RANGE_ALLOCATOR_HPP
+#define VULKAN_LIB_RANGE_ALLOCATOR_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <map>
+
+namespace ida {
+/**
+ * First-fit free-list over an abstract [0, size) range. Freed ranges are coalesced with their
+ * neighbours. Alignment does not need to be a power of two, so ranges can be aligned to a vertex stride.
+ */
+class IdaRangeAllocator final {
+  public:
+    explicit IdaRangeAllocator(vk::DeviceSize size);
+
+    bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+    void Free(vk::DeviceSize offset, vk::DeviceSize size);
+
+    vk::DeviceSize GetSize() const { return size_; }
+    vk::DeviceSize GetUsedBytes() const { return usedBytes_; }
+    uint32_t GetAllocationCount() const { return allocationCount_; }
+    vk::DeviceSize GetLargestFreeRange() const;
+    const std::map<vk::DeviceSize, vk::DeviceSize>& GetFreeRanges() const { return freeRanges_; }
+
+  private:
+    vk::DeviceSize size_;
+    // offset -> size of every free range
+    std::map<vk::DeviceSize, vk::DeviceSize> freeRanges_;
+    uint32_t allocationCount_ = 0;
+    vk::DeviceSize usedBytes_ = 0;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_RANGE_ALLOCATOR_HPP
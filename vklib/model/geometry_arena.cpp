@@ -0,0 +1,241 @@
+#include "geometry_arena.hpp"
+#include "core/context.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+
+namespace ida {
+IdaGeometryArena::Page::Page(vk::DeviceSize vertexSize, vk::DeviceSize indexSize)
+    : vertexRanges(vertexSize), indexRanges(indexSize) {
+    // mesh shaders fetch vertices themselves through storage buffer descriptors
+    auto vertexUsage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                       vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc;
+    auto indexUsage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc;
+    // pages in host visible VRAM are written directly, the others are filled through staging
+    vertexBuffer = std::make_unique<IdaBuffer>(
+        BufferType::VertexBuffer,
+        vertexSize,
+        1,
+        vertexUsage,
+        IdaBuffer::Utils::ChooseDeviceLocalProperties(vertexSize, vertexUsage));
+    indexBuffer = std::make_unique<IdaBuffer>(
+        BufferType::IndexBuffer,
+        indexSize,
+        1,
+        indexUsage,
+        IdaBuffer::Utils::ChooseDeviceLocalProperties(indexSize, indexUsage));
+}
+
+IdaGeometryArena::IdaGeometryArena(vk::DeviceSize vertexPageSize, vk::DeviceSize indexPageSize)
+    : vertexPageSize_(vertexPageSize), indexPageSize_(indexPageSize) {}
+
+IdaGeometryArena::~IdaGeometryArena() {
+    PrintStatistics();
+    pages_.clear();
+}
+
+GeometryAllocation IdaGeometryArena::Allocate(
+    vk::DeviceSize vertexSize,
+    vk::DeviceSize vertexStride,
+    vk::DeviceSize indexSize,
+    vk::DeviceSize indexStride) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return AllocateLocked(vertexSize, vertexStride, indexSize, indexStride);
+}
+
+GeometryAllocation IdaGeometryArena::AllocateLocked(
+    vk::DeviceSize vertexSize,
+    vk::DeviceSize vertexStride,
+    vk::DeviceSize indexSize,
+    vk::DeviceSize indexStride) {
+    GeometryAllocation allocation{};
+    for (uint32_t i = 0; i < pages_.size(); i++) {
+        if (pages_[i] && TryAllocate(*pages_[i], vertexSize, vertexStride, indexSize, indexStride, allocation)) {
+            allocation.page = i;
+            return allocation;
+        }
+    }
+
+    // leave room for the stride padding in front of the first range
+    auto pageVertexSize = std::max(vertexPageSize_, vertexSize + vertexStride);
+    auto pageIndexSize = std::max(indexPageSize_, std::max<vk::DeviceSize>(indexSize, 1) + indexStride);
+    auto slot = std::find(pages_.begin(), pages_.end(), nullptr);
+    if (slot == pages_.end()) {
+        slot = pages_.insert(pages_.end(), nullptr);
+    }
+    *slot = std::make_unique<Page>(pageVertexSize, pageIndexSize);
+    auto pageIndex = static_cast<uint32_t>(slot - pages_.begin());
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO,
+                 "Geometry arena page {} created ({} vertex bytes, {} index bytes{})",
+                 pageIndex,
+                 pageVertexSize,
+                 pageIndexSize,
+                 (*slot)->vertexBuffer->IsHostVisible() ? ", direct upload" : "");
+    if (!TryAllocate(**slot, vertexSize, vertexStride, indexSize, indexStride, allocation)) {
+        IO::ThrowError("Failed to sub-allocate {} vertex bytes and {} index bytes from a fresh geometry page", vertexSize, indexSize);
+    }
+    allocation.page = pageIndex;
+    return allocation;
+}
+
+bool IdaGeometryArena::TryAllocate(
+    Page& page,
+    vk::DeviceSize vertexSize,
+    vk::DeviceSize vertexStride,
+    vk::DeviceSize indexSize,
+    vk::DeviceSize indexStride,
+    GeometryAllocation& allocation) {
+    if (!page.vertexRanges.Allocate(vertexSize, vertexStride, allocation.vertexOffset)) {
+        return false;
+    }
+    if (indexSize > 0 && !page.indexRanges.Allocate(indexSize, indexStride, allocation.indexOffset)) {
+        page.vertexRanges.Free(allocation.vertexOffset, vertexSize);
+        return false;
+    }
+    allocation.vertexSize = vertexSize;
+    allocation.indexSize = indexSize;
+    allocation.vertexStride = vertexStride;
+    allocation.indexStride = indexStride;
+    return true;
+}
+
+void IdaGeometryArena::Free(GeometryAllocation& allocation) {
+    if (!allocation.IsValid()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    FreeLocked(allocation);
+}
+
+void IdaGeometryArena::FreeLocked(GeometryAllocation& allocation) {
+    auto& page = *pages_[allocation.page];
+    page.vertexRanges.Free(allocation.vertexOffset, allocation.vertexSize);
+    if (allocation.indexSize > 0) {
+        page.indexRanges.Free(allocation.indexOffset, allocation.indexSize);
+    }
+    allocation = GeometryAllocation{};
+}
+
+UploadToken IdaGeometryArena::Write(const GeometryAllocation& allocation, const void* vertices, const void* indices) {
+    IdaBuffer* vertexBuffer;
+    IdaBuffer* indexBuffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        vertexBuffer = pages_[allocation.page]->vertexBuffer.get();
+        indexBuffer = pages_[allocation.page]->indexBuffer.get();
+    }
+    auto token = vertexBuffer->Upload(vertices, allocation.vertexSize, allocation.vertexOffset);
+    if (allocation.indexSize > 0) {
+        token = std::max(token, indexBuffer->Upload(indices, allocation.indexSize, allocation.indexOffset));
+    }
+    return token;
+}
+
+void IdaGeometryArena::Track(GeometryAllocation* allocation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracked_.insert(allocation);
+}
+
+void IdaGeometryArena::Untrack(GeometryAllocation* allocation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracked_.erase(allocation);
+}
+
+vk::DeviceSize IdaGeometryArena::Compact(vk::CommandBuffer cmd, vk::DeviceSize maxBytes, uint32_t& movedCount) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // move from the back of the arena first, those are the ranges keeping late pages alive
+    std::vector<GeometryAllocation*> candidates(tracked_.begin(), tracked_.end());
+    std::sort(candidates.begin(), candidates.end(), [](auto* a, auto* b) {
+        return a->page != b->page ? a->page > b->page : a->vertexOffset > b->vertexOffset;
+    });
+
+    vk::DeviceSize moved = 0;
+    for (auto* handle : candidates) {
+        if (moved >= maxBytes) {
+            break;
+        }
+        auto old = *handle;
+        GeometryAllocation target{};
+        bool found = false;
+        for (uint32_t i = 0; i <= old.page && !found; i++) {
+            if (!pages_[i] || !TryAllocate(*pages_[i], old.vertexSize, old.vertexStride, old.indexSize, old.indexStride, target)) {
+                continue;
+            }
+            target.page = i;
+            // in the same page first fit only helps if both ranges move down
+            bool better = i < old.page ||
+                          (target.vertexOffset <= old.vertexOffset && target.indexOffset <= old.indexOffset &&
+                           (target.vertexOffset < old.vertexOffset || target.indexOffset < old.indexOffset));
+            if (better) {
+                found = true;
+            } else {
+                FreeLocked(target);
+            }
+        }
+        if (!found) {
+            continue;
+        }
+
+        // the old range is still allocated, so source and destination never overlap
+        cmd.copyBuffer(pages_[old.page]->vertexBuffer->GetBuffer(),
+                       pages_[target.page]->vertexBuffer->GetBuffer(),
+                       vk::BufferCopy(old.vertexOffset, target.vertexOffset, old.vertexSize));
+        if (old.indexSize > 0) {
+            cmd.copyBuffer(pages_[old.page]->indexBuffer->GetBuffer(),
+                           pages_[target.page]->indexBuffer->GetBuffer(),
+                           vk::BufferCopy(old.indexOffset, target.indexOffset, old.indexSize));
+        }
+        *handle = target;
+        Context::GetInstance().deletionQueue->Push([this, old]() mutable {
+            Free(old);
+        });
+        moved += old.vertexSize + old.indexSize;
+        movedCount++;
+    }
+    if (moved > 0) {
+        generation_++;
+    }
+    return moved;
+}
+
+uint32_t IdaGeometryArena::ReleaseEmptyPages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t released = 0;
+    for (size_t i = 1; i < pages_.size(); i++) {
+        if (pages_[i] && pages_[i]->vertexRanges.GetAllocationCount() == 0 && pages_[i]->indexRanges.GetAllocationCount() == 0) {
+            pages_[i].reset();
+            released++;
+        }
+    }
+    while (!pages_.empty() && pages_.back() == nullptr) {
+        pages_.pop_back();
+    }
+    return released;
+}
+
+void IdaGeometryArena::Bind(vk::CommandBuffer cmd, uint32_t page, vk::IndexType indexType) const {
+    vk::Buffer buffers[] = {GetVertexBuffer(page)};
+    vk::DeviceSize offsets[] = {0};
+    cmd.bindVertexBuffers(0, 1, buffers, offsets);
+    cmd.bindIndexBuffer(GetIndexBuffer(page), 0, indexType);
+}
+
+void IdaGeometryArena::PrintStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < pages_.size(); i++) {
+        if (!pages_[i]) {
+            continue;
+        }
+        auto& page = *pages_[i];
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO,
+                     "Geometry page {}: {} meshes, vertices {}/{} bytes, indices {}/{} bytes",
+                     i,
+                     page.vertexRanges.GetAllocationCount(),
+                     page.vertexRanges.GetUsedBytes(),
+                     page.vertexRanges.GetSize(),
+                     page.indexRanges.GetUsedBytes(),
+                     page.indexRanges.GetSize());
+    }
+}
+
+} // namespace ida
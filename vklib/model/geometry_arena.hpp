@@ -0,0 +1,97 @@
+#ifndef VULKAN_LIB_GEOMETRY_ARENA_HPP
+#define VULKAN_LIB_GEOMETRY_ARENA_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/buffer.hpp"
+#include "memory/range_allocator.hpp"
+
+namespace ida {
+// Where a mesh lives inside the arena, offsets are in bytes
+struct GeometryAllocation {
+    uint32_t page = UINT32_MAX;
+    vk::DeviceSize vertexOffset = 0;
+    vk::DeviceSize vertexSize = 0;
+    vk::DeviceSize indexOffset = 0;
+    vk::DeviceSize indexSize = 0;
+    vk::DeviceSize vertexStride = 0;
+    vk::DeviceSize indexStride = 0;
+
+    bool IsValid() const { return page != UINT32_MAX; }
+};
+
+/**
+ * Shared device local vertex and index buffers that every IdaModel is sub-allocated from.
+ *
+ * Vertex ranges are aligned to the vertex stride so a mesh can be drawn with drawIndexed(vertexOffset =
+ * offset / stride, firstIndex = offset / indexSize) while the buffers stay bound for the whole frame.
+ * When a page runs out a new one is added, meshes larger than a page get a page of their own.
+ *
+ * Owners that Track() their handle allow Compact() to move their ranges towards the first pages and
+ * rewrite the handle in place, so they must read offsets from it whenever they record a draw.
+ */
+class IdaGeometryArena final {
+  public:
+    static constexpr vk::DeviceSize DEFAULT_VERTEX_PAGE_SIZE = 64ull * 1024 * 1024;
+    static constexpr vk::DeviceSize DEFAULT_INDEX_PAGE_SIZE = 32ull * 1024 * 1024;
+
+    IdaGeometryArena(vk::DeviceSize vertexPageSize = DEFAULT_VERTEX_PAGE_SIZE, vk::DeviceSize indexPageSize = DEFAULT_INDEX_PAGE_SIZE);
+    ~IdaGeometryArena();
+    IdaGeometryArena(const IdaGeometryArena&) = delete;
+    IdaGeometryArena& operator=(const IdaGeometryArena&) = delete;
+
+    GeometryAllocation Allocate(vk::DeviceSize vertexSize, vk::DeviceSize vertexStride, vk::DeviceSize indexSize, vk::DeviceSize indexStride = sizeof(uint32_t));
+    void Free(GeometryAllocation& allocation);
+    // Fills a freshly allocated range, directly if the page is host visible. Returns the upload token.
+    UploadToken Write(const GeometryAllocation& allocation, const void* vertices, const void* indices);
+    void Track(GeometryAllocation* allocation);
+    void Untrack(GeometryAllocation* allocation);
+
+    // Records copies moving tracked ranges into lower pages/offsets, up to maxBytes, into cmd. Patched
+    // handles are valid for commands recorded after the copies, old ranges are freed through the
+    // deletion queue. Returns the number of bytes moved, 0 once nothing can move any more.
+    vk::DeviceSize Compact(vk::CommandBuffer cmd, vk::DeviceSize maxBytes, uint32_t& movedCount);
+    // Destroys pages without live ranges (the first page is kept), returns how many were released
+    uint32_t ReleaseEmptyPages();
+
+    // Binds the vertex buffer to binding 0 and the index buffer of a page, read as indexType
+    void Bind(vk::CommandBuffer cmd, uint32_t page, vk::IndexType indexType = vk::IndexType::eUint32) const;
+    vk::Buffer GetVertexBuffer(uint32_t page) const { return pages_[page]->vertexBuffer->GetBuffer(); }
+    vk::Buffer GetIndexBuffer(uint32_t page) const { return pages_[page]->indexBuffer->GetBuffer(); }
+    // Released pages leave an empty slot so the indices of the others stay stable
+    uint32_t GetPageCount() const { return static_cast<uint32_t>(pages_.size()); }
+    bool IsPageValid(uint32_t page) const { return page < pages_.size() && pages_[page] != nullptr; }
+    // Changes whenever Compact() moves a range, for systems caching offsets on the GPU
+    uint32_t GetGeneration() const { return generation_; }
+
+    void PrintStatistics();
+
+  private:
+    struct Page {
+        std::unique_ptr<IdaBuffer> vertexBuffer;
+        std::unique_ptr<IdaBuffer> indexBuffer;
+        IdaRangeAllocator vertexRanges;
+        IdaRangeAllocator indexRanges;
+
+        Page(vk::DeviceSize vertexSize, vk::DeviceSize indexSize);
+    };
+
+    GeometryAllocation AllocateLocked(vk::DeviceSize vertexSize, vk::DeviceSize vertexStride, vk::DeviceSize indexSize, vk::DeviceSize indexStride);
+    void FreeLocked(GeometryAllocation& allocation);
+    bool TryAllocate(Page& page, vk::DeviceSize vertexSize, vk::DeviceSize vertexStride, vk::DeviceSize indexSize, vk::DeviceSize indexStride, GeometryAllocation& allocation);
+
+    vk::DeviceSize vertexPageSize_;
+    vk::DeviceSize indexPageSize_;
+    std::vector<std::unique_ptr<Page>> pages_;
+    std::unordered_set<GeometryAllocation*> tracked_;
+    uint32_t generation_ = 0;
+    std::mutex mutex_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_GEOMETRY_ARENA_HPP
@@ -0,0 +1,682 @@
+#include "gltf_loader.hpp"
+
+#include "log/log.hpp"
+#include "utils.hpp"
+
+#include "glm/gtc/quaternion.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <string_view>
+#include <utility>
+
+namespace ida {
+namespace {
+constexpr uint32_t GLB_MAGIC = 0x46546c67;      // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942;  // "BIN\0"
+// nesting a glTF document never comes close to, deeper input is malformed or malicious
+constexpr int MAX_JSON_DEPTH = 64;
+
+// ****** JSON ******
+struct JsonValue {
+    enum class Type : uint8_t {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    // a null value when absent, so optional members read like present ones
+    const JsonValue& operator[](std::string_view key) const {
+        static const JsonValue null;
+        for (const auto& [name, value] : object) {
+            if (name == key) {
+                return value;
+            }
+        }
+        return null;
+    }
+    bool IsNull() const { return type == Type::Null; }
+    uint32_t GetUint(uint32_t defaultValue = 0) const {
+        return type == Type::Number && number >= 0.0 && number <= UINT32_MAX ? static_cast<uint32_t>(number) : defaultValue;
+    }
+    // glTF references other objects by index, -1 when absent
+    int32_t GetIndex() const { return type == Type::Number && number >= 0.0 && number <= INT32_MAX ? static_cast<int32_t>(number) : -1; }
+    float GetFloat(float defaultValue = 0.0f) const { return type == Type::Number ? static_cast<float>(number) : defaultValue; }
+};
+
+// Recursive descent parser for RFC 8259 JSON
+class JsonParser {
+  public:
+    JsonParser(const char* data, size_t size, const std::string& name) : p_(data), begin_(data), end_(data + size), name_(name) {}
+
+    JsonValue Parse() {
+        JsonValue value = ParseValue(0);
+        SkipSpace();
+        if (p_ != end_) {
+            Fail("trailing characters");
+        }
+        return value;
+    }
+
+  private:
+    void Fail(const char* what) const { IO::ThrowError("Invalid glTF JSON in {} at offset {}: {}", name_, p_ - begin_, what); }
+
+    void SkipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            p_++;
+        }
+    }
+
+    void Expect(char c) {
+        SkipSpace();
+        if (p_ == end_ || *p_ != c) {
+            Fail("unexpected character");
+        }
+        p_++;
+    }
+
+    // Consumes the comma between two members or elements
+    bool Next() {
+        SkipSpace();
+        if (p_ < end_ && *p_ == ',') {
+            p_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool Match(std::string_view literal) {
+        if (static_cast<size_t>(end_ - p_) < literal.size() || std::string_view(p_, literal.size()) != literal) {
+            return false;
+        }
+        p_ += literal.size();
+        return true;
+    }
+
+    JsonValue ParseValue(int depth) {
+        if (depth > MAX_JSON_DEPTH) {
+            Fail("nested too deeply");
+        }
+        SkipSpace();
+        if (p_ == end_) {
+            Fail("unexpected end");
+        }
+        JsonValue value;
+        switch (*p_) {
+        case '{':
+            value.type = JsonValue::Type::Object;
+            p_++;
+            SkipSpace();
+            if (p_ < end_ && *p_ == '}') {
+                p_++;
+                return value;
+            }
+            do {
+                SkipSpace();
+                std::string key = ParseString();
+                Expect(':');
+                value.object.emplace_back(std::move(key), ParseValue(depth + 1));
+            } while (Next());
+            Expect('}');
+            return value;
+        case '[':
+            value.type = JsonValue::Type::Array;
+            p_++;
+            SkipSpace();
+            if (p_ < end_ && *p_ == ']') {
+                p_++;
+                return value;
+            }
+            do {
+                value.array.push_back(ParseValue(depth + 1));
+            } while (Next());
+            Expect(']');
+            return value;
+        case '"':
+            value.type = JsonValue::Type::String;
+            value.string = ParseString();
+            return value;
+        default:
+            break;
+        }
+        if (Match("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return value;
+        }
+        if (Match("false")) {
+            value.type = JsonValue::Type::Bool;
+            return value;
+        }
+        if (Match("null")) {
+            return value;
+        }
+        value.type = JsonValue::Type::Number;
+        value.number = ParseNumber();
+        return value;
+    }
+
+    std::string ParseString() {
+        if (p_ == end_ || *p_ != '"') {
+            Fail("expected a string");
+        }
+        p_++;
+        std::string out;
+        while (true) {
+            const char* start = p_;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\') {
+                p_++;
+            }
+            out.append(start, p_);
+            if (p_ == end_) {
+                Fail("unterminated string");
+            }
+            if (*p_++ == '"') {
+                return out;
+            }
+            if (p_ == end_) {
+                Fail("unterminated escape");
+            }
+            char escape = *p_++;
+            switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                out.push_back(escape);
+                break;
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'u': {
+                uint32_t code = ParseHex4();
+                if (code >= 0xd800 && code < 0xdc00 && Match("\\u")) {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (ParseHex4() - 0xdc00);
+                }
+                AppendUtf8(out, code);
+                break;
+            }
+            default:
+                Fail("invalid escape");
+            }
+        }
+    }
+
+    uint32_t ParseHex4() {
+        if (end_ - p_ < 4) {
+            Fail("truncated \\u escape");
+        }
+        uint32_t code = 0;
+        for (int i = 0; i < 4; i++, p_++) {
+            char c = *p_;
+            uint32_t digit = c >= '0' && c <= '9'   ? c - '0'
+                             : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                             : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                                    : 16;
+            if (digit == 16) {
+                Fail("invalid \\u escape");
+            }
+            code = code << 4 | digit;
+        }
+        return code;
+    }
+
+    static void AppendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xc0 | code >> 6));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xe0 | code >> 12));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        } else {
+            out.push_back(static_cast<char>(0xf0 | code >> 18));
+            out.push_back(static_cast<char>(0x80 | (code >> 12 & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+        }
+    }
+
+    // Numbers in a glTF document are indices, counts and a few transforms, so plain digit
+    // accumulation is accurate enough and avoids the locale dependence of strtod
+    double ParseNumber() {
+        const char* start = p_;
+        bool negative = p_ < end_ && *p_ == '-';
+        if (negative) {
+            p_++;
+        }
+        double mantissa = 0.0;
+        int exponent = 0;
+        bool digits = false;
+        for (; p_ < end_ && *p_ >= '0' && *p_ <= '9'; p_++, digits = true) {
+            mantissa = mantissa * 10.0 + (*p_ - '0');
+        }
+        if (p_ < end_ && *p_ == '.') {
+            for (p_++; p_ < end_ && *p_ >= '0' && *p_ <= '9'; p_++, digits = true) {
+                mantissa = mantissa * 10.0 + (*p_ - '0');
+                exponent--;
+            }
+        }
+        if (!digits) {
+            p_ = start;
+            Fail("unexpected character");
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            p_++;
+            bool negativeExponent = p_ < end_ && *p_ == '-';
+            if (p_ < end_ && (*p_ == '-' || *p_ == '+')) {
+                p_++;
+            }
+            int value = 0;
+            for (; p_ < end_ && *p_ >= '0' && *p_ <= '9'; p_++) {
+                value = std::min(value * 10 + (*p_ - '0'), 1000);
+            }
+            exponent += negativeExponent ? -value : value;
+        }
+        double number = exponent != 0 ? mantissa * std::pow(10.0, exponent) : mantissa;
+        return negative ? -number : number;
+    }
+
+    const char* p_;
+    const char* begin_;
+    const char* end_;
+    const std::string& name_;
+};
+
+// ****** Buffers ******
+struct ByteRange {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+std::vector<uint8_t> DecodeBase64(std::string_view text, const std::string& path) {
+    auto decode = [&](char c) -> uint32_t {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+' || c == '-') {
+            return 62;
+        }
+        if (c == '/' || c == '_') {
+            return 63;
+        }
+        IO::ThrowError("Invalid base64 buffer in {}", path);
+        return 0;
+    };
+    while (!text.empty() && text.back() == '=') {
+        text.remove_suffix(1);
+    }
+    std::vector<uint8_t> bytes;
+    bytes.reserve(text.size() * 3 / 4);
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (char c : text) {
+        bits = bits << 6 | decode(c);
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+    return bytes;
+}
+
+std::string DecodeUri(const std::string& uri) {
+    std::string out;
+    out.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            out.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(uri[i]);
+        }
+    }
+    return out;
+}
+
+uint32_t GetComponentCount(const std::string& type) {
+    if (type == "SCALAR") {
+        return 1;
+    }
+    if (type == "VEC2") {
+        return 2;
+    }
+    if (type == "VEC3") {
+        return 3;
+    }
+    if (type == "VEC4") {
+        return 4;
+    }
+    // matrices are only used by skins, which are ignored
+    return 0;
+}
+
+uint32_t GetComponentSize(GltfComponentType type) {
+    switch (type) {
+    case GltfComponentType::Byte:
+    case GltfComponentType::UnsignedByte:
+        return 1;
+    case GltfComponentType::Short:
+    case GltfComponentType::UnsignedShort:
+        return 2;
+    case GltfComponentType::UnsignedInt:
+    case GltfComponentType::Float:
+        return 4;
+    }
+    return 0;
+}
+
+glm::mat4 ReadTransform(const JsonValue& node) {
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.array.size() == 16) {
+        glm::mat4 transform;
+        for (int i = 0; i < 16; i++) {
+            transform[i / 4][i % 4] = matrix.array[i].GetFloat();
+        }
+        return transform;
+    }
+    glm::vec3 translation(0.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale(1.0f);
+    const JsonValue& t = node["translation"];
+    if (t.array.size() == 3) {
+        translation = {t.array[0].GetFloat(), t.array[1].GetFloat(), t.array[2].GetFloat()};
+    }
+    // stored as x, y, z, w
+    const JsonValue& r = node["rotation"];
+    if (r.array.size() == 4) {
+        rotation = glm::quat(r.array[3].GetFloat(), r.array[0].GetFloat(), r.array[1].GetFloat(), r.array[2].GetFloat());
+    }
+    const JsonValue& s = node["scale"];
+    if (s.array.size() == 3) {
+        scale = {s.array[0].GetFloat(), s.array[1].GetFloat(), s.array[2].GetFloat()};
+    }
+    glm::mat4 transform = glm::mat4_cast(glm::normalize(rotation));
+    transform[0] *= scale.x;
+    transform[1] *= scale.y;
+    transform[2] *= scale.z;
+    transform[3] = glm::vec4(translation, 1.0f);
+    return transform;
+}
+} // namespace
+
+// ****** GltfAccessor ******
+uint32_t GltfAccessor::GetElementSize() const {
+    return GetComponentSize(componentType) * componentCount;
+}
+
+glm::vec4 GltfAccessor::GetFloat(uint32_t i) const {
+    const uint8_t* element = data + static_cast<size_t>(i) * stride;
+    glm::vec4 value(0.0f);
+    for (uint32_t c = 0; c < componentCount; c++) {
+        switch (componentType) {
+        case GltfComponentType::Float: {
+            float component;
+            std::memcpy(&component, element + c * sizeof(float), sizeof(float));
+            value[c] = component;
+            break;
+        }
+        case GltfComponentType::UnsignedByte:
+            value[c] = normalized ? element[c] / 255.0f : element[c];
+            break;
+        case GltfComponentType::Byte: {
+            auto component = static_cast<int8_t>(element[c]);
+            value[c] = normalized ? std::max(component / 127.0f, -1.0f) : component;
+            break;
+        }
+        case GltfComponentType::UnsignedShort: {
+            uint16_t component;
+            std::memcpy(&component, element + c * sizeof(uint16_t), sizeof(uint16_t));
+            value[c] = normalized ? component / 65535.0f : component;
+            break;
+        }
+        case GltfComponentType::Short: {
+            int16_t component;
+            std::memcpy(&component, element + c * sizeof(int16_t), sizeof(int16_t));
+            value[c] = normalized ? std::max(component / 32767.0f, -1.0f) : component;
+            break;
+        }
+        case GltfComponentType::UnsignedInt: {
+            uint32_t component;
+            std::memcpy(&component, element + c * sizeof(uint32_t), sizeof(uint32_t));
+            value[c] = static_cast<float>(component);
+            break;
+        }
+        }
+    }
+    return value;
+}
+
+uint32_t GltfAccessor::GetIndex(uint32_t i) const {
+    switch (componentType) {
+    case GltfComponentType::UnsignedByte:
+        return Get<uint8_t>(i);
+    case GltfComponentType::UnsignedShort:
+        return Get<uint16_t>(i);
+    default:
+        return Get<uint32_t>(i);
+    }
+}
+
+// ****** IdaGltfLoader ******
+bool IdaGltfLoader::IsGltfPath(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".glb" || extension == ".gltf";
+}
+
+std::shared_ptr<const GltfAsset> IdaGltfLoader::Load(const std::string& path) {
+    auto asset = std::make_shared<GltfAsset>();
+    asset->path = path;
+    asset->file = std::make_unique<IdaMappedFile>(path);
+    const auto* fileData = reinterpret_cast<const uint8_t*>(asset->file->GetData());
+    size_t fileSize = asset->file->GetSize();
+
+    // a .glb is a 12 byte header followed by the JSON chunk and an optional binary chunk
+    const char* json = asset->file->GetData();
+    size_t jsonSize = fileSize;
+    ByteRange binaryChunk;
+    uint32_t magic = 0;
+    if (fileSize >= sizeof(magic)) {
+        std::memcpy(&magic, fileData, sizeof(magic));
+    }
+    if (magic == GLB_MAGIC) {
+        uint32_t header[3];
+        IO::Assert(fileSize >= sizeof(header), "Truncated GLB header: {}", path);
+        std::memcpy(header, fileData, sizeof(header));
+        IO::Assert(header[1] == 2, "Unsupported GLB version {}: {}", header[1], path);
+        size_t length = std::min<size_t>(header[2], fileSize);
+        json = nullptr;
+        for (size_t offset = sizeof(header); offset + 8 <= length;) {
+            uint32_t chunk[2];
+            std::memcpy(chunk, fileData + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+            IO::Assert(chunk[0] <= length - offset, "Truncated GLB chunk: {}", path);
+            if (chunk[1] == GLB_CHUNK_JSON && !json) {
+                json = reinterpret_cast<const char*>(fileData + offset);
+                jsonSize = chunk[0];
+            } else if (chunk[1] == GLB_CHUNK_BIN && !binaryChunk.data) {
+                binaryChunk = {fileData + offset, chunk[0]};
+            }
+            // chunks are padded to 4 bytes, which keeps the binary chunk aligned for every component type
+            offset += (chunk[0] + 3) & ~3u;
+        }
+        IO::Assert(json != nullptr, "GLB without a JSON chunk: {}", path);
+    }
+
+    JsonValue root = JsonParser(json, jsonSize, path).Parse();
+    const std::string& version = root["asset"]["version"].string;
+    IO::Assert(!version.empty() && version[0] == '2', "Unsupported glTF version '{}': {}", version, path);
+    for (const auto& extension : root["extensionsRequired"].array) {
+        IO::ThrowError("glTF extension {} is required but not supported: {}", extension.string, path);
+    }
+
+    asset->contentHash = hashBytes(fileData, fileSize);
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::vector<ByteRange> buffers;
+    for (const auto& buffer : root["buffers"].array) {
+        size_t byteLength = buffer["byteLength"].GetUint();
+        const JsonValue& uri = buffer["uri"];
+        ByteRange range;
+        if (uri.IsNull()) {
+            IO::Assert(buffers.empty() && binaryChunk.data, "Buffer without uri outside a GLB: {}", path);
+            range = binaryChunk;
+        } else if (uri.string.rfind("data:", 0) == 0) {
+            size_t comma = uri.string.find(',');
+            IO::Assert(comma != std::string::npos, "Invalid data uri in {}", path);
+            auto& bytes = asset->embeddedBuffers.emplace_back(DecodeBase64(std::string_view(uri.string).substr(comma + 1), path));
+            range = {bytes.data(), bytes.size()};
+        } else {
+            auto& file = asset->externalBuffers.emplace_back(std::make_unique<IdaMappedFile>((directory / DecodeUri(uri.string)).string()));
+            range = {reinterpret_cast<const uint8_t*>(file->GetData()), file->GetSize()};
+            asset->contentHash = hashBytes(range.data, range.size, asset->contentHash);
+        }
+        IO::Assert(range.size >= byteLength, "Buffer {} is shorter than its byteLength: {}", buffers.size(), path);
+        buffers.push_back({range.data, byteLength});
+    }
+
+    struct BufferView {
+        ByteRange range;
+        uint32_t stride = 0;
+    };
+    std::vector<BufferView> bufferViews;
+    for (const auto& view : root["bufferViews"].array) {
+        uint32_t buffer = view["buffer"].GetUint(UINT32_MAX);
+        IO::Assert(buffer < buffers.size(), "Buffer view references a missing buffer: {}", path);
+        size_t offset = view["byteOffset"].GetUint();
+        size_t length = view["byteLength"].GetUint();
+        IO::Assert(offset + length <= buffers[buffer].size, "Buffer view exceeds its buffer: {}", path);
+        bufferViews.push_back({{buffers[buffer].data + offset, length}, view["byteStride"].GetUint()});
+    }
+
+    // unsupported accessors stay invalid, which is only an error if a primitive uses them
+    std::vector<GltfAccessor> accessors;
+    for (const auto& entry : root["accessors"].array) {
+        GltfAccessor& accessor = accessors.emplace_back();
+        accessor.componentType = static_cast<GltfComponentType>(entry["componentType"].GetUint());
+        accessor.componentCount = GetComponentCount(entry["type"].string);
+        accessor.count = entry["count"].GetUint();
+        accessor.normalized = entry["normalized"].boolean;
+        int32_t view = entry["bufferView"].GetIndex();
+        uint32_t elementSize = accessor.GetElementSize();
+        if (view < 0 || view >= static_cast<int32_t>(bufferViews.size()) || !entry["sparse"].IsNull() || elementSize == 0) {
+            continue;
+        }
+        const BufferView& bufferView = bufferViews[view];
+        size_t offset = entry["byteOffset"].GetUint();
+        accessor.stride = bufferView.stride != 0 ? bufferView.stride : elementSize;
+        size_t end = offset + (accessor.count > 0 ? static_cast<size_t>(accessor.count - 1) * accessor.stride + elementSize : 0);
+        IO::Assert(end <= bufferView.range.size, "Accessor {} exceeds its buffer view: {}", accessors.size() - 1, path);
+        accessor.data = bufferView.range.data + offset;
+    }
+
+    auto getAccessor = [&](const JsonValue& index, bool required) {
+        int32_t i = index.GetIndex();
+        if (i < 0 && !required) {
+            return GltfAccessor{};
+        }
+        IO::Assert(i >= 0 && i < static_cast<int32_t>(accessors.size()) && accessors[i].IsValid(), "Unsupported or missing accessor {}: {}", i, path);
+        return accessors[i];
+    };
+    for (const auto& entry : root["meshes"].array) {
+        GltfMesh& mesh = asset->meshes.emplace_back();
+        mesh.name = entry["name"].string;
+        for (const auto& primitiveJson : entry["primitives"].array) {
+            GltfPrimitive& primitive = mesh.primitives.emplace_back();
+            const JsonValue& attributes = primitiveJson["attributes"];
+            primitive.positions = getAccessor(attributes["POSITION"], true);
+            primitive.normals = getAccessor(attributes["NORMAL"], false);
+            primitive.colors = getAccessor(attributes["COLOR_0"], false);
+            primitive.texcoords = getAccessor(attributes["TEXCOORD_0"], false);
+            primitive.indices = getAccessor(primitiveJson["indices"], false);
+            primitive.mode = primitiveJson["mode"].GetUint(GltfPrimitive::MODE_TRIANGLES);
+            // importers read every attribute up to the position count
+            for (const GltfAccessor* attribute : {&primitive.normals, &primitive.colors, &primitive.texcoords}) {
+                IO::Assert(!attribute->IsValid() || attribute->count == primitive.positions.count,
+                           "Attribute count differs from the position count in mesh '{}': {}", mesh.name, path);
+            }
+            auto indexType = primitive.indices.componentType;
+            bool unsignedIndices = indexType == GltfComponentType::UnsignedByte || indexType == GltfComponentType::UnsignedShort ||
+                                   indexType == GltfComponentType::UnsignedInt;
+            IO::Assert(!primitive.indices.IsValid() || (primitive.indices.componentCount == 1 && unsignedIndices),
+                       "Indices must be unsigned scalars in mesh '{}': {}", mesh.name, path);
+        }
+    }
+
+    const auto& nodes = root["nodes"].array;
+    asset->nodes.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        GltfNode& node = asset->nodes[i];
+        node.name = nodes[i]["name"].string;
+        node.mesh = nodes[i]["mesh"].GetIndex();
+        IO::Assert(node.mesh < static_cast<int32_t>(asset->meshes.size()), "Node {} references a missing mesh: {}", i, path);
+        node.localTransform = ReadTransform(nodes[i]);
+        for (const auto& child : nodes[i]["children"].array) {
+            uint32_t index = child.GetUint(UINT32_MAX);
+            IO::Assert(index < nodes.size() && index != i && asset->nodes[index].parent < 0, "Invalid node hierarchy: {}", path);
+            asset->nodes[index].parent = static_cast<int32_t>(i);
+            node.children.push_back(index);
+        }
+    }
+
+    // the default scene, or every root when the file has no scenes
+    std::vector<uint32_t> roots;
+    const auto& scenes = root["scenes"].array;
+    if (!scenes.empty()) {
+        uint32_t scene = std::min<uint32_t>(root["scene"].GetUint(), static_cast<uint32_t>(scenes.size() - 1));
+        for (const auto& node : scenes[scene]["nodes"].array) {
+            uint32_t index = node.GetUint(UINT32_MAX);
+            IO::Assert(index < nodes.size() && asset->nodes[index].parent < 0, "Scene references an invalid root node: {}", path);
+            roots.push_back(index);
+        }
+    } else {
+        for (uint32_t i = 0; i < asset->nodes.size(); i++) {
+            if (asset->nodes[i].parent < 0) {
+                roots.push_back(i);
+            }
+        }
+    }
+    // a node has at most one parent, so the traversal ends even in malformed files
+    std::vector<uint32_t>& order = asset->sceneNodes;
+    order = roots;
+    for (size_t i = 0; i < order.size(); i++) {
+        GltfNode& node = asset->nodes[order[i]];
+        node.worldTransform = node.parent >= 0 ? asset->nodes[node.parent].worldTransform * node.localTransform : node.localTransform;
+        order.insert(order.end(), node.children.begin(), node.children.end());
+    }
+    return asset;
+}
+} // namespace ida
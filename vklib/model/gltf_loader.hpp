@@ -0,0 +1,119 @@
+#ifndef VULKAN_LIB_GLTF_LOADER_HPP
+#define VULKAN_LIB_GLTF_LOADER_HPP
+
+#include "core/mapped_file.hpp"
+
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ida {
+enum class GltfComponentType : uint32_t {
+    Byte = 5120,
+    UnsignedByte = 5121,
+    Short = 5122,
+    UnsignedShort = 5123,
+    UnsignedInt = 5125,
+    Float = 5126,
+};
+
+// Strided view of an accessor, element i starts at data + i * stride inside the mapped buffer
+struct GltfAccessor {
+    const uint8_t* data = nullptr;
+    uint32_t count = 0;
+    uint32_t stride = 0;
+    GltfComponentType componentType = GltfComponentType::Float;
+    uint32_t componentCount = 0; // 1 for SCALAR up to 4 for VEC4
+    bool normalized = false;
+
+    bool IsValid() const { return data != nullptr; }
+    uint32_t GetElementSize() const;
+    bool Is(GltfComponentType type, uint32_t components) const { return componentType == type && componentCount == components; }
+
+    // The accessor as a plain array of T, nullptr unless the elements are T sized, tightly packed
+    // and aligned for T
+    template <typename T>
+    const T* GetArray() const {
+        if (sizeof(T) != GetElementSize() || stride != sizeof(T) || reinterpret_cast<uintptr_t>(data) % alignof(T) != 0) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(data);
+    }
+    // Element i as T, which must not be larger than the element size, whatever the stride and alignment
+    template <typename T>
+    T Get(uint32_t i) const {
+        T value;
+        std::memcpy(&value, data + static_cast<size_t>(i) * stride, sizeof(T));
+        return value;
+    }
+    // Element i as floats, normalized integers are mapped to [0, 1] or [-1, 1]
+    glm::vec4 GetFloat(uint32_t i) const;
+    // Element i of an index accessor
+    uint32_t GetIndex(uint32_t i) const;
+};
+
+struct GltfPrimitive {
+    static constexpr uint32_t MODE_TRIANGLES = 4;
+
+    // absent attributes are left invalid
+    GltfAccessor positions;
+    GltfAccessor normals;
+    GltfAccessor colors; // COLOR_0
+    GltfAccessor texcoords; // TEXCOORD_0
+    GltfAccessor indices;
+    uint32_t mode = MODE_TRIANGLES;
+};
+
+struct GltfMesh {
+    std::string name;
+    std::vector<GltfPrimitive> primitives;
+};
+
+struct GltfNode {
+    std::string name;
+    int32_t mesh = -1;
+    int32_t parent = -1;
+    std::vector<uint32_t> children;
+    glm::mat4 localTransform{1.0f};
+    // with every parent applied
+    glm::mat4 worldTransform{1.0f};
+};
+
+/**
+ * A loaded glTF file. The accessors point straight into the mapped file (the binary chunk of a
+ * .glb) or into the mapped external buffers, so the asset must outlive every view taken from it.
+ */
+struct GltfAsset {
+    std::string path;
+    std::vector<GltfMesh> meshes;
+    std::vector<GltfNode> nodes;
+    // every node of the default scene, parents before their children
+    std::vector<uint32_t> sceneNodes;
+    // of the file and every buffer it references
+    uint64_t contentHash = 0;
+
+    std::unique_ptr<IdaMappedFile> file;
+    std::vector<std::unique_ptr<IdaMappedFile>> externalBuffers;
+    std::vector<std::vector<uint8_t>> embeddedBuffers; // base64 data: uris
+};
+
+/**
+ * glTF 2.0 reader for .glb and .gltf files.
+ *
+ * Only the JSON document is parsed, it describes the buffers, buffer views and accessors, and is
+ * small next to the geometry. The geometry itself is never read or copied here: buffers are
+ * memory mapped and every accessor becomes a strided view into them, so an importer whose layout
+ * matches the file uploads straight from the mapping. Sparse accessors and compression
+ * extensions are not supported, materials, skins, animations and cameras are ignored.
+ */
+class IdaGltfLoader final {
+  public:
+    static bool IsGltfPath(const std::string& path);
+    static std::shared_ptr<const GltfAsset> Load(const std::string& path);
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_GLTF_LOADER_HPP
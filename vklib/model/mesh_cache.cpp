@@ -0,0 +1,174 @@
+#include "mesh_cache.hpp"
+
+#include "log/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace ida {
+namespace {
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+std::string IdaMeshCache::GetCachePath(const std::string& sourcePath, uint64_t optionsHash) {
+    return fmt::format("{}.{:016x}.idamesh", sourcePath, optionsHash);
+}
+
+IdaMeshCache::IdaMeshCache(const std::string& path) : file_(path) {
+    if (file_.GetSize() >= sizeof(MeshCacheHeader)) {
+        std::memcpy(&header_, file_.GetData(), sizeof(MeshCacheHeader));
+    } else {
+        header_.magic = 0;
+    }
+}
+
+std::unique_ptr<IdaMeshCache> IdaMeshCache::Open(const std::string& path, uint64_t sourceHash, uint64_t optionsHash) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return nullptr;
+    }
+    auto cache = std::make_unique<IdaMeshCache>(path);
+    if (!cache->IsValid(sourceHash, optionsHash)) {
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Mesh cache is stale: {}", path);
+        return nullptr;
+    }
+    return cache;
+}
+
+bool IdaMeshCache::Write(
+    const std::string& path,
+    uint64_t sourceHash,
+    uint64_t optionsHash,
+    const std::vector<IdaModel::Vertex>& vertices,
+    const std::vector<uint32_t>& indices,
+    const std::vector<IdaModel::Lod>& lods) {
+    MeshCacheHeader header = CreateHeader();
+    header.sourceHash = sourceHash;
+    header.optionsHash = optionsHash;
+    IO::Assert(lods.size() <= IdaModel::MAX_LODS, "Too many levels of detail for the mesh cache");
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    std::copy(lods.begin(), lods.end(), header.lods);
+
+    if (!vertices.empty()) {
+        glm::vec3 boundsMin = vertices[0].position;
+        glm::vec3 boundsMax = vertices[0].position;
+        for (const auto& vertex : vertices) {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+        std::memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+        std::memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+    }
+
+    uint64_t vertexBytes = vertices.size() * sizeof(IdaModel::Vertex);
+    uint64_t indexBytes = indices.size() * sizeof(uint32_t);
+    header.vertexCount = vertices.size();
+    header.vertexOffset = AlignUp(sizeof(MeshCacheHeader), BLOB_ALIGNMENT);
+    header.indexCount = indices.size();
+    header.indexOffset = AlignUp(header.vertexOffset + vertexBytes, BLOB_ALIGNMENT);
+    header.fileSize = header.indexOffset + indexBytes;
+
+    // unique per thread, background imports of the same source may write it concurrently
+    std::string tempPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Failed to create mesh cache: {}", path);
+            return false;
+        }
+        std::vector<char> padding(BLOB_ALIGNMENT, 0);
+        auto padTo = [&](uint64_t offset) {
+            uint64_t position = static_cast<uint64_t>(out.tellp());
+            out.write(padding.data(), static_cast<std::streamsize>(offset - position));
+        };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(header.vertexOffset);
+        out.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertexBytes));
+        padTo(header.indexOffset);
+        out.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indexBytes));
+        if (!out.good()) {
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Failed to write mesh cache: {}", path);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Failed to replace mesh cache: {}", path);
+        return false;
+    }
+    return true;
+}
+
+IdaModel::MeshView IdaMeshCache::GetView() const {
+    const char* data = file_.GetData();
+    IdaModel::MeshView view{};
+    view.vertices = reinterpret_cast<const IdaModel::Vertex*>(data + header_.vertexOffset);
+    view.vertexCount = static_cast<uint32_t>(header_.vertexCount);
+    view.indices = reinterpret_cast<const uint32_t*>(data + header_.indexOffset);
+    view.indexCount = static_cast<uint32_t>(header_.indexCount);
+    view.lods = header_.lods;
+    view.lodCount = header_.lodCount;
+    return view;
+}
+
+bool IdaMeshCache::IsValid(uint64_t sourceHash, uint64_t optionsHash) const {
+    const MeshCacheHeader expected = CreateHeader();
+    if (header_.magic != MeshCacheHeader::MAGIC || header_.version != MeshCacheHeader::VERSION ||
+        header_.fileSize != file_.GetSize()) {
+        return false;
+    }
+    if (header_.sourceHash != sourceHash || header_.optionsHash != optionsHash) {
+        return false;
+    }
+    // written by a build with a different vertex layout
+    if (header_.vertexStride != expected.vertexStride || header_.indexStride != expected.indexStride ||
+        header_.attributeCount != expected.attributeCount ||
+        std::memcmp(header_.attributes, expected.attributes, sizeof(expected.attributes)) != 0) {
+        return false;
+    }
+
+    if (header_.lodCount > IdaModel::MAX_LODS) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header_.lodCount; i++) {
+        const IdaModel::Lod& lod = header_.lods[i];
+        if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > header_.indexCount) {
+            return false;
+        }
+    }
+
+    uint64_t vertexEnd = header_.vertexOffset + header_.vertexCount * header_.vertexStride;
+    uint64_t indexEnd = header_.indexOffset + header_.indexCount * header_.indexStride;
+    return header_.vertexOffset % BLOB_ALIGNMENT == 0 && header_.indexOffset % BLOB_ALIGNMENT == 0 &&
+           header_.vertexOffset >= sizeof(MeshCacheHeader) && vertexEnd <= header_.indexOffset &&
+           indexEnd <= header_.fileSize && header_.vertexCount <= UINT32_MAX && header_.indexCount <= UINT32_MAX;
+}
+
+MeshCacheHeader IdaMeshCache::CreateHeader() {
+    MeshCacheHeader header{};
+    header.vertexStride = sizeof(IdaModel::Vertex);
+    header.indexStride = sizeof(uint32_t);
+
+    auto attributes = IdaModel::Vertex::GetAttributeDescriptions();
+    IO::Assert(attributes.size() <= MeshCacheHeader::MAX_ATTRIBUTES, "Too many vertex attributes for the mesh cache");
+    header.attributeCount = static_cast<uint32_t>(attributes.size());
+    for (size_t i = 0; i < attributes.size(); i++) {
+        header.attributes[i].location = attributes[i].location;
+        header.attributes[i].format = static_cast<uint32_t>(attributes[i].format);
+        header.attributes[i].offset = attributes[i].offset;
+    }
+    return header;
+}
+} // namespace ida
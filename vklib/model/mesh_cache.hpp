@@ -0,0 +1,98 @@
+#ifndef VULKAN_LIB_MESH_CACHE_HPP
+#define VULKAN_LIB_MESH_CACHE_HPP
+
+#include "core/mapped_file.hpp"
+#include "model/model.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ida {
+struct MeshCacheAttribute {
+    uint32_t location = 0;
+    uint32_t format = 0; // VkFormat
+    uint32_t offset = 0;
+};
+
+/**
+ * Header at the start of a .idamesh file. The vertex and index blobs follow at BLOB_ALIGNMENT
+ * aligned offsets, in exactly the layout the geometry arena expects, so a warm load only maps the
+ * file and hands the blobs to the upload.
+ */
+struct MeshCacheHeader {
+    static constexpr uint32_t MAGIC = 0x4853454d; // "MESH"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t MAX_ATTRIBUTES = 8;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint64_t fileSize = 0;
+
+    // what the cache was built from, a mismatch on either means it is stale
+    uint64_t sourceHash = 0;
+    uint64_t optionsHash = 0;
+
+    uint32_t vertexStride = 0;
+    uint32_t attributeCount = 0;
+    MeshCacheAttribute attributes[MAX_ATTRIBUTES]{};
+    uint32_t indexStride = 0;
+    uint32_t reserved = 0;
+
+    float boundsMin[3]{};
+    float boundsMax[3]{};
+
+    uint64_t vertexCount = 0;
+    uint64_t vertexOffset = 0;
+    uint64_t indexCount = 0;
+    uint64_t indexOffset = 0;
+
+    // ranges of the index blob, in indices
+    uint32_t lodCount = 0;
+    IdaModel::Lod lods[IdaModel::MAX_LODS]{};
+};
+
+/**
+ * Memory mapped binary mesh written next to an imported source file.
+ *
+ * ImportModel() keys the cache by a hash of the source contents and of the import options, and
+ * rebuilds it whenever either changes or the vertex layout of this build differs from the one stored.
+ */
+class IdaMeshCache final {
+  public:
+    // page aligned, so the blobs could also be imported as host memory straight from the mapping
+    static constexpr uint64_t BLOB_ALIGNMENT = 4096;
+
+    explicit IdaMeshCache(const std::string& path);
+    IdaMeshCache(const IdaMeshCache&) = delete;
+    IdaMeshCache& operator=(const IdaMeshCache&) = delete;
+
+    // Maps the cache if it exists, is intact and matches the hashes and the current vertex layout
+    static std::unique_ptr<IdaMeshCache> Open(const std::string& path, uint64_t sourceHash, uint64_t optionsHash);
+    // Writes through a temporary file so a crash never leaves a truncated cache behind. Returns
+    // false, after logging a warning, if the cache could not be written.
+    static bool Write(
+        const std::string& path,
+        uint64_t sourceHash,
+        uint64_t optionsHash,
+        const std::vector<IdaModel::Vertex>& vertices,
+        const std::vector<uint32_t>& indices,
+        const std::vector<IdaModel::Lod>& lods);
+    // One file per source and set of import options, so imports of the same source with different
+    // options do not keep overwriting each other's cache
+    static std::string GetCachePath(const std::string& sourcePath, uint64_t optionsHash);
+
+    const MeshCacheHeader& GetHeader() const { return header_; }
+    IdaModel::MeshView GetView() const;
+
+  private:
+    bool IsValid(uint64_t sourceHash, uint64_t optionsHash) const;
+    static MeshCacheHeader CreateHeader();
+
+    IdaMappedFile file_;
+    MeshCacheHeader header_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_MESH_CACHE_HPP
@@ -0,0 +1,295 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace ida {
+namespace {
+// Triangles around every vertex, in compressed rows
+struct VertexAdjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    VertexAdjacency(const std::vector<uint32_t>& indices, uint32_t vertexCount) : offsets(vertexCount + 1, 0) {
+        for (uint32_t index : indices) {
+            offsets[index + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        triangles.resize(indices.size());
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+};
+
+// Tipsify's next fanning vertex: the candidate still referenced by live triangles that stays in the
+// cache the longest after its remaining triangles are emitted, else one from the dead end stack, else
+// the next live vertex in input order
+int64_t NextVertex(
+    const std::vector<uint32_t>& candidates,
+    const std::vector<uint32_t>& live,
+    const std::vector<uint32_t>& cacheTime,
+    uint32_t time,
+    uint32_t cacheSize,
+    std::vector<uint32_t>& deadEnd,
+    uint32_t& cursor) {
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+    for (uint32_t vertex : candidates) {
+        if (live[vertex] == 0) {
+            continue;
+        }
+        int64_t priority = 0;
+        // stays in the cache while its remaining triangles are emitted
+        if (time - cacheTime[vertex] + 2 * live[vertex] <= cacheSize) {
+            priority = time - cacheTime[vertex];
+        }
+        if (priority > bestPriority) {
+            best = vertex;
+            bestPriority = priority;
+        }
+    }
+    if (best >= 0) {
+        return best;
+    }
+
+    while (!deadEnd.empty()) {
+        uint32_t vertex = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[vertex] > 0) {
+            return vertex;
+        }
+    }
+    while (cursor < live.size()) {
+        if (live[cursor] > 0) {
+            return cursor;
+        }
+        cursor++;
+    }
+    return -1;
+}
+
+// Triangle offsets where a FIFO cache would miss all three corners, reordering whole clusters
+// between them costs (almost) no extra cache misses
+std::vector<uint32_t> FindClusters(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    std::vector<bool> cached(vertexCount, false);
+    uint32_t misses = 0;
+    for (size_t triangle = 0; triangle < indices.size() / 3; triangle++) {
+        uint32_t triangleMisses = 0;
+        for (size_t corner = 0; corner < 3; corner++) {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            if (!cached[vertex] || misses - insertedAt[vertex] >= cacheSize) {
+                cached[vertex] = true;
+                insertedAt[vertex] = misses++;
+                triangleMisses++;
+            }
+        }
+        if (triangle == 0 || triangleMisses == 3) {
+            clusters.push_back(static_cast<uint32_t>(triangle));
+        }
+    }
+    return clusters;
+}
+} // namespace
+
+MeshOptimizationStats IdaMeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t cacheSize) {
+    MeshOptimizationStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    stats.before = AnalyzeVertexCache(indices, vertexCount, cacheSize);
+
+    stats.degenerateTriangles = RemoveDegenerateTriangles(vertices, indices);
+    OptimizeVertexCache(indices, vertexCount, cacheSize);
+    stats.clusters = OptimizeOverdraw(vertices, indices, cacheSize);
+    stats.unusedVertices = OptimizeVertexFetch(vertices, indices);
+
+    stats.after = AnalyzeVertexCache(indices, static_cast<uint32_t>(vertices.size()), cacheSize);
+    return stats;
+}
+
+uint32_t IdaMeshOptimizer::RemoveDegenerateTriangles(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    size_t write = 0;
+    for (size_t read = 0; read + 2 < indices.size(); read += 3) {
+        uint32_t a = indices[read];
+        uint32_t b = indices[read + 1];
+        uint32_t c = indices[read + 2];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        const glm::vec3& pa = vertices[a].position;
+        const glm::vec3& pb = vertices[b].position;
+        const glm::vec3& pc = vertices[c].position;
+        if (pa == pb || pb == pc || pa == pc) {
+            continue;
+        }
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+    }
+    uint32_t removed = static_cast<uint32_t>((indices.size() - write) / 3);
+    indices.resize(write);
+    return removed;
+}
+
+void IdaMeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+    VertexAdjacency adjacency(indices, vertexCount);
+
+    std::vector<uint32_t> live(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+        live[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+    }
+    // time stamps of when each vertex entered the cache, the start time keeps everything out of it
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    uint32_t cursor = 0;
+    int64_t fanning = indices[0];
+    while (fanning >= 0) {
+        candidates.clear();
+        uint32_t begin = adjacency.offsets[fanning];
+        uint32_t end = adjacency.offsets[fanning + 1];
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+        fanning = NextVertex(candidates, live, cacheTime, time, cacheSize, deadEnd, cursor);
+    }
+    indices = std::move(output);
+}
+
+uint32_t IdaMeshOptimizer::OptimizeOverdraw(
+    const std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices,
+    uint32_t cacheSize,
+    float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return 0;
+    }
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    std::vector<uint32_t> clusters = FindClusters(indices, vertexCount, cacheSize);
+    if (clusters.size() < 2) {
+        return static_cast<uint32_t>(clusters.size());
+    }
+
+    // area weighted centroid of the mesh and of every cluster, and the cluster's summed normal
+    struct Cluster {
+        uint32_t begin;
+        uint32_t end;
+        glm::vec3 centroid{0.0f};
+        glm::vec3 normal{0.0f};
+        float area = 0.0f;
+        float sortKey = 0.0f;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    glm::vec3 meshCentroid{0.0f};
+    float meshArea = 0.0f;
+    for (size_t i = 0; i < clusters.size(); i++) {
+        Cluster& cluster = sorted[i];
+        cluster.begin = clusters[i];
+        cluster.end = i + 1 < clusters.size() ? clusters[i + 1] : static_cast<uint32_t>(triangleCount);
+        for (uint32_t triangle = cluster.begin; triangle < cluster.end; triangle++) {
+            const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+            cluster.normal += normal;
+            cluster.area += area;
+        }
+        meshCentroid += cluster.centroid;
+        meshArea += cluster.area;
+        if (cluster.area > 0.0f) {
+            cluster.centroid /= cluster.area;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+    for (auto& cluster : sorted) {
+        float length = glm::length(cluster.normal);
+        glm::vec3 normal = length > 0.0f ? cluster.normal / length : glm::vec3(0.0f);
+        cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, normal);
+    }
+    // outward facing clusters first, they occlude the rest of the mesh
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    for (const auto& cluster : sorted) {
+        reordered.insert(reordered.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertexCount, cacheSize);
+    VertexCacheStats after = AnalyzeVertexCache(reordered, vertexCount, cacheSize);
+    if (after.acmr > before.acmr * threshold) {
+        return 0;
+    }
+    indices = std::move(reordered);
+    return static_cast<uint32_t>(sorted.size());
+}
+
+uint32_t IdaMeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    uint32_t removed = static_cast<uint32_t>(vertices.size() - reordered.size());
+    vertices = std::move(reordered);
+    return removed;
+}
+
+VertexCacheStats IdaMeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    std::vector<bool> cached(vertexCount, false);
+    uint32_t usedVertices = 0;
+    for (uint32_t vertex : indices) {
+        if (!cached[vertex]) {
+            usedVertices++;
+        }
+        if (!cached[vertex] || stats.misses - insertedAt[vertex] >= cacheSize) {
+            cached[vertex] = true;
+            insertedAt[vertex] = stats.misses++;
+        }
+    }
+    size_t triangleCount = indices.size() / 3;
+    stats.acmr = triangleCount > 0 ? static_cast<float>(stats.misses) / static_cast<float>(triangleCount) : 0.0f;
+    stats.atvr = usedVertices > 0 ? static_cast<float>(stats.misses) / static_cast<float>(usedVertices) : 0.0f;
+    return stats;
+}
+} // namespace ida
@@ -0,0 +1,61 @@
+#ifndef VULKAN_LIB_MESH_OPTIMIZER_HPP
+#define VULKAN_LIB_MESH_OPTIMIZER_HPP
+
+#include "model/model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ida {
+struct VertexCacheStats {
+    uint32_t misses = 0;
+    float acmr = 0.0f; // transformed vertices per triangle, 0.5 is the ideal for a regular grid, 3 the worst
+    float atvr = 0.0f; // transformed vertices per vertex, 1 is the ideal
+};
+
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    uint32_t degenerateTriangles = 0;
+    uint32_t unusedVertices = 0;
+    uint32_t clusters = 0;
+};
+
+/**
+ * Reorders indexed triangle lists for the GPU.
+ *
+ * - OptimizeVertexCache: Tipsify (Sander et al. 2007), linear time, tuned for a FIFO cache
+ * - OptimizeOverdraw: cuts the result where the cache starts cold anyway and draws the outward
+ *   facing clusters first, kept only while the ACMR stays within the threshold
+ * - OptimizeVertexFetch: renumbers vertices in first use order and drops unreferenced ones
+ */
+class IdaMeshOptimizer final {
+  public:
+    using Vertex = IdaModel::Vertex;
+
+    // bumped whenever the output changes, so cached meshes are optimized again
+    static constexpr uint64_t VERSION = 1;
+    static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+    static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+    // Runs every stage below in order
+    static MeshOptimizationStats Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Removes triangles with repeated indices or coincident corners, returns how many were removed
+    static uint32_t RemoveDegenerateTriangles(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+    static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+    // Returns the number of clusters the triangles were sorted in
+    static uint32_t OptimizeOverdraw(
+        const std::vector<Vertex>& vertices,
+        std::vector<uint32_t>& indices,
+        uint32_t cacheSize = DEFAULT_CACHE_SIZE,
+        float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+    // Returns the number of unused vertices that were removed
+    static uint32_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Simulates a FIFO post transform cache
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_MESH_OPTIMIZER_HPP
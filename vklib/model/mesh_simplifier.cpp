@@ -0,0 +1,364 @@
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+namespace ida {
+namespace {
+// weight of the planes holding borders in place, relative to a face of the same size
+constexpr double BORDER_WEIGHT = 10.0;
+// collapses turning a face further than ~75 degrees are rejected as folds
+constexpr double MIN_FLIP_COSINE = 0.25;
+
+// Sum of squared distances to a set of weighted planes, the upper triangle of the symmetric 4x4
+// matrix (n, d) * (n, d)^T
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+    double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+    double a22 = 0.0, a23 = 0.0;
+    double a33 = 0.0;
+    double weight = 0.0;
+
+    void AddPlane(const glm::dvec3& n, double d, double w) {
+        a00 += w * n.x * n.x;
+        a01 += w * n.x * n.y;
+        a02 += w * n.x * n.z;
+        a03 += w * n.x * d;
+        a11 += w * n.y * n.y;
+        a12 += w * n.y * n.z;
+        a13 += w * n.y * d;
+        a22 += w * n.z * n.z;
+        a23 += w * n.z * d;
+        a33 += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a03 += other.a03;
+        a11 += other.a11;
+        a12 += other.a12;
+        a13 += other.a13;
+        a22 += other.a22;
+        a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Weighted squared distance of p to the planes
+    double Evaluate(const glm::dvec3& p) const {
+        double value = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x +
+                       a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y +
+                       a22 * p.z * p.z + 2.0 * a23 * p.z + a33;
+        return std::max(value, 0.0);
+    }
+};
+
+// Root mean squared distance of p to the planes of both quadrics
+float CollapseError(const Quadric& a, const Quadric& b, const glm::dvec3& p) {
+    double weight = a.weight + b.weight;
+    if (weight <= 0.0) {
+        return 0.0f;
+    }
+    return static_cast<float>(std::sqrt((a.Evaluate(p) + b.Evaluate(p)) / weight));
+}
+
+enum class PositionKind : uint8_t {
+    Interior,
+    Border, // on an edge with a single face, only collapses along such edges
+    Locked, // on a non-manifold edge, never moves
+};
+
+struct Edge {
+    uint32_t a;
+    uint32_t b;
+    bool operator<(const Edge& other) const { return a != other.a ? a < other.a : b < other.b; }
+    bool operator==(const Edge& other) const { return a == other.a && b == other.b; }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    float error;
+};
+
+// Triangles around every position, in compressed rows
+struct PositionAdjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    PositionAdjacency(const std::vector<uint32_t>& corners, uint32_t positionCount) : offsets(positionCount + 1, 0) {
+        for (uint32_t position : corners) {
+            offsets[position + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        triangles.resize(corners.size());
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < corners.size(); i++) {
+            triangles[cursor[corners[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+};
+
+float AttributeDistance(const IdaModel::Vertex& a, const IdaModel::Vertex& b) {
+    glm::vec3 normal = a.normal - b.normal;
+    glm::vec3 color = a.color - b.color;
+    glm::vec2 uv = a.uv - b.uv;
+    return glm::dot(normal, normal) + glm::dot(color, color) + glm::dot(uv, uv);
+}
+} // namespace
+
+std::vector<uint32_t> IdaMeshSimplifier::Simplify(
+    const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices,
+    uint32_t targetIndexCount,
+    float maxError,
+    float& error) {
+    error = 0.0f;
+    std::vector<uint32_t> result(indices);
+    if (result.size() <= targetIndexCount || vertices.empty()) {
+        return result;
+    }
+
+    // vertices sharing a position are collapsed as one, grouped by sorting
+    auto vertexCount = static_cast<uint32_t>(vertices.size());
+    std::vector<uint32_t> groupMembers(vertexCount);
+    std::iota(groupMembers.begin(), groupMembers.end(), 0);
+    auto positionLess = [&](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = vertices[a].position;
+        const glm::vec3& pb = vertices[b].position;
+        return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+    };
+    std::sort(groupMembers.begin(), groupMembers.end(), positionLess);
+    std::vector<uint32_t> positionOf(vertexCount);
+    std::vector<uint32_t> groupOffsets;
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        if (i == 0 || vertices[groupMembers[i]].position != vertices[groupMembers[i - 1]].position) {
+            groupOffsets.push_back(i);
+        }
+        positionOf[groupMembers[i]] = static_cast<uint32_t>(groupOffsets.size() - 1);
+    }
+    auto positionCount = static_cast<uint32_t>(groupOffsets.size());
+    groupOffsets.push_back(vertexCount);
+    std::vector<glm::dvec3> positions(positionCount);
+    for (uint32_t position = 0; position < positionCount; position++) {
+        positions[position] = glm::dvec3(vertices[groupMembers[groupOffsets[position]]].position);
+    }
+
+    // corners in position ids, kept in sync with result
+    std::vector<uint32_t> corners(result.size());
+    for (size_t i = 0; i < result.size(); i++) {
+        corners[i] = positionOf[result[i]];
+    }
+
+    std::vector<Edge> edges;
+    auto collectEdges = [&]() {
+        edges.clear();
+        for (size_t i = 0; i < corners.size(); i += 3) {
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t a = corners[i + corner];
+                uint32_t b = corners[i + (corner + 1) % 3];
+                if (a != b) {
+                    edges.push_back({std::min(a, b), std::max(a, b)});
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+    };
+
+    // face planes weighted by area, and planes perpendicular to the faces along the borders
+    std::vector<Quadric> quadrics(positionCount);
+    for (size_t i = 0; i < corners.size(); i += 3) {
+        const glm::dvec3& p0 = positions[corners[i]];
+        glm::dvec3 normal = glm::cross(positions[corners[i + 1]] - p0, positions[corners[i + 2]] - p0);
+        double area = glm::length(normal);
+        if (area <= 0.0) {
+            continue;
+        }
+        normal /= area;
+        for (size_t corner = 0; corner < 3; corner++) {
+            quadrics[corners[i + corner]].AddPlane(normal, -glm::dot(normal, p0), area * 0.5);
+        }
+    }
+    std::vector<PositionKind> kinds(positionCount, PositionKind::Interior);
+    collectEdges();
+    for (size_t i = 0; i < edges.size();) {
+        size_t end = i;
+        while (end < edges.size() && edges[end] == edges[i]) {
+            end++;
+        }
+        size_t faces = end - i;
+        Edge edge = edges[i];
+        i = end;
+        if (faces == 2) {
+            continue;
+        }
+        for (uint32_t position : {edge.a, edge.b}) {
+            if (faces > 2) {
+                kinds[position] = PositionKind::Locked;
+            } else if (kinds[position] == PositionKind::Interior) {
+                kinds[position] = PositionKind::Border;
+            }
+        }
+    }
+    for (size_t i = 0; i < corners.size(); i += 3) {
+        const glm::dvec3& p0 = positions[corners[i]];
+        glm::dvec3 faceNormal = glm::cross(positions[corners[i + 1]] - p0, positions[corners[i + 2]] - p0);
+        for (size_t corner = 0; corner < 3; corner++) {
+            uint32_t a = corners[i + corner];
+            uint32_t b = corners[i + (corner + 1) % 3];
+            Edge edge{std::min(a, b), std::max(a, b)};
+            auto range = std::equal_range(edges.begin(), edges.end(), edge);
+            if (range.second - range.first != 1) {
+                continue;
+            }
+            glm::dvec3 direction = positions[b] - positions[a];
+            glm::dvec3 normal = glm::cross(direction, faceNormal);
+            double length = glm::length(normal);
+            if (length <= 0.0) {
+                continue;
+            }
+            normal /= length;
+            double weight = glm::dot(direction, direction) * BORDER_WEIGHT;
+            quadrics[a].AddPlane(normal, -glm::dot(normal, positions[a]), weight);
+            quadrics[b].AddPlane(normal, -glm::dot(normal, positions[a]), weight);
+        }
+    }
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(positionCount);
+    std::vector<bool> touched(positionCount);
+    auto triangleCount = static_cast<uint32_t>(corners.size() / 3);
+    uint32_t targetTriangleCount = targetIndexCount / 3;
+
+    // Every pass collapses independent edges in order of error, then rebuilds the mesh
+    while (triangleCount > targetTriangleCount) {
+        PositionAdjacency adjacency(corners, positionCount);
+        collectEdges();
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (const Edge& edge : edges) {
+            bool border = kinds[edge.a] == PositionKind::Border && kinds[edge.b] == PositionKind::Border;
+            if (border) {
+                // both ends on a border does not make the edge one of it
+                uint32_t faces = 0;
+                for (uint32_t i = adjacency.offsets[edge.a]; i < adjacency.offsets[edge.a + 1]; i++) {
+                    uint32_t triangle = adjacency.triangles[i];
+                    faces += corners[triangle * 3] == edge.b || corners[triangle * 3 + 1] == edge.b || corners[triangle * 3 + 2] == edge.b;
+                }
+                border = faces == 1;
+            }
+            Collapse best{0, 0, FLT_MAX};
+            for (auto [from, to] : {std::pair{edge.a, edge.b}, std::pair{edge.b, edge.a}}) {
+                if (kinds[from] == PositionKind::Locked || (kinds[from] == PositionKind::Border && !border)) {
+                    continue;
+                }
+                float collapseError = CollapseError(quadrics[from], quadrics[to], positions[to]);
+                if (collapseError < best.error) {
+                    best = {from, to, collapseError};
+                }
+            }
+            if (best.error <= maxError) {
+                collapses.push_back(best);
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+        // an interior collapse removes two triangles, the pass stops a little past the cheapest
+        // collapses that would reach the target so locked neighbours do not pull in expensive ones
+        size_t goal = (triangleCount - targetTriangleCount) / 2;
+        float errorLimit = goal < collapses.size() ? collapses[goal].error * 1.5f : FLT_MAX;
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        uint32_t collapsed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > errorLimit || triangleCount <= targetTriangleCount) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+            // the faces staying around from must not fold over
+            bool flips = false;
+            uint32_t removed = 0;
+            for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1] && !flips; i++) {
+                const uint32_t* triangle = &corners[adjacency.triangles[i] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    removed++;
+                    continue;
+                }
+                glm::dvec3 p[3];
+                glm::dvec3 moved[3];
+                for (size_t corner = 0; corner < 3; corner++) {
+                    p[corner] = positions[triangle[corner]];
+                    moved[corner] = triangle[corner] == collapse.from ? positions[collapse.to] : p[corner];
+                }
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) < MIN_FLIP_COSINE * glm::length(before) * glm::length(after) ||
+                        glm::dot(after, after) <= 0.0;
+            }
+            if (flips) {
+                continue;
+            }
+
+            // faces around from are rebuilt at the end of the pass, nothing touching them may move
+            for (uint32_t i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1]; i++) {
+                const uint32_t* triangle = &corners[adjacency.triangles[i] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            error = std::max(error, collapse.error);
+            triangleCount -= std::min(removed, triangleCount);
+            collapsed++;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        // moved corners take the vertex at the target closest to their own attributes
+        size_t write = 0;
+        for (size_t i = 0; i < corners.size(); i += 3) {
+            uint32_t triangle[3];
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t position = corners[i + corner];
+                triangle[corner] = remap[position];
+                if (triangle[corner] == position) {
+                    continue;
+                }
+                const Vertex& original = vertices[result[i + corner]];
+                uint32_t best = groupMembers[groupOffsets[triangle[corner]]];
+                float bestDistance = FLT_MAX;
+                for (uint32_t member = groupOffsets[triangle[corner]]; member < groupOffsets[triangle[corner] + 1]; member++) {
+                    float distance = AttributeDistance(original, vertices[groupMembers[member]]);
+                    if (distance < bestDistance) {
+                        best = groupMembers[member];
+                        bestDistance = distance;
+                    }
+                }
+                result[i + corner] = best;
+            }
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+                continue;
+            }
+            for (size_t corner = 0; corner < 3; corner++) {
+                corners[write] = triangle[corner];
+                result[write++] = result[i + corner];
+            }
+        }
+        corners.resize(write);
+        result.resize(write);
+        triangleCount = static_cast<uint32_t>(write / 3);
+    }
+    return result;
+}
+} // namespace ida
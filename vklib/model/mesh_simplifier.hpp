@@ -0,0 +1,38 @@
+#ifndef VULKAN_LIB_MESH_SIMPLIFIER_HPP
+#define VULKAN_LIB_MESH_SIMPLIFIER_HPP
+
+#include "model/model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ida {
+/**
+ * Reduces indexed triangle lists with quadric error metric edge collapses (Garland and Heckbert 1997).
+ *
+ * Collapses move a position onto one of its neighbours instead of a new optimal point, so the
+ * result keeps referencing the original vertices and every level of detail can share one vertex
+ * buffer. Vertices sharing a position (uv or normal seams) collapse together, each corner picks
+ * the closest matching vertex at the target. Borders are held in place by extra quadrics and only
+ * collapse along themselves, non-manifold positions never move.
+ */
+class IdaMeshSimplifier final {
+  public:
+    using Vertex = IdaModel::Vertex;
+
+    // bumped whenever the output changes, so cached levels of detail are simplified again
+    static constexpr uint64_t VERSION = 1;
+
+    // Collapses edges until at most targetIndexCount indices are left or every remaining collapse
+    // would deviate more than maxError (model units) from the input. error receives the largest
+    // deviation of the collapses made.
+    static std::vector<uint32_t> Simplify(
+        const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices,
+        uint32_t targetIndexCount,
+        float maxError,
+        float& error);
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_MESH_SIMPLIFIER_HPP
@@ -0,0 +1,128 @@
+#include "meshlet_builder.hpp"
+
+#include "log/log.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace ida {
+namespace {
+constexpr uint32_t NO_LOCAL_INDEX = UINT32_MAX;
+// cones wider than ~84 degrees (half angle) are left unculled, they almost never face away
+constexpr float MIN_CONE_DOT = 0.1f;
+
+void ComputeBounds(Meshlet& meshlet, const MeshletData& data, const IdaModel::Vertex* vertices) {
+    glm::vec3 min{FLT_MAX}, max{-FLT_MAX};
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        const glm::vec3& p = vertices[data.vertices[meshlet.vertexOffset + i]].position;
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    meshlet.center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        const glm::vec3& p = vertices[data.vertices[meshlet.vertexOffset + i]].position;
+        radius = std::max(radius, glm::length(p - meshlet.center));
+    }
+    meshlet.radius = radius;
+}
+
+void ComputeCone(Meshlet& meshlet, const IdaModel::Vertex* vertices, const uint32_t* indices) {
+    glm::vec3 normals[IdaMeshletBuilder::MAX_TRIANGLES];
+    uint32_t normalCount = 0;
+    glm::vec3 sum{0.0f};
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const uint32_t* tri = indices + meshlet.firstIndex + t * 3;
+        glm::vec3 n = glm::cross(
+            vertices[tri[1]].position - vertices[tri[0]].position,
+            vertices[tri[2]].position - vertices[tri[0]].position);
+        float length = glm::length(n);
+        if (length <= 0.0f || normalCount == IdaMeshletBuilder::MAX_TRIANGLES) {
+            continue;
+        }
+        normals[normalCount++] = n / length;
+        sum += n / length;
+    }
+
+    float sumLength = glm::length(sum);
+    if (normalCount == 0 || sumLength <= 0.0f) {
+        return; // cutoff stays 1
+    }
+    glm::vec3 axis = sum / sumLength;
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < normalCount; i++) {
+        minDot = std::min(minDot, glm::dot(axis, normals[i]));
+    }
+    meshlet.coneAxis = axis;
+    // the cone of normals spans acos(minDot) around the axis, its complement bounds the directions
+    // every triangle faces away from
+    meshlet.coneCutoff = minDot <= MIN_CONE_DOT ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+} // namespace
+
+MeshletData IdaMeshletBuilder::Build(
+    const Vertex* vertices,
+    uint32_t vertexCount,
+    const uint32_t* indices,
+    uint32_t indexCount,
+    uint32_t maxVertices,
+    uint32_t maxTriangles) {
+    IO::Assert(maxVertices >= 3 && maxVertices <= 256, "Meshlets must hold between 3 and 256 vertices, got {}", maxVertices);
+    IO::Assert(maxTriangles >= 1 && maxTriangles <= MAX_TRIANGLES, "Meshlets must hold between 1 and {} triangles, got {}", MAX_TRIANGLES, maxTriangles);
+
+    MeshletData data;
+    uint32_t triangleCount = indexCount / 3;
+    data.meshlets.reserve(triangleCount / maxTriangles + 1);
+    data.triangles.reserve(triangleCount);
+    data.vertices.reserve(vertexCount + vertexCount / 2);
+
+    std::vector<uint32_t> localIndex(vertexCount, NO_LOCAL_INDEX);
+    Meshlet current{};
+    auto flush = [&]() {
+        if (current.triangleCount == 0) {
+            return;
+        }
+        for (uint32_t i = 0; i < current.vertexCount; i++) {
+            localIndex[data.vertices[current.vertexOffset + i]] = NO_LOCAL_INDEX;
+        }
+        ComputeBounds(current, data, vertices);
+        ComputeCone(current, vertices, indices);
+        data.meshlets.push_back(current);
+
+        Meshlet next{};
+        next.firstIndex = current.firstIndex + current.triangleCount * 3;
+        next.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+        next.triangleOffset = static_cast<uint32_t>(data.triangles.size());
+        current = next;
+    };
+
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = indices + t * 3;
+        uint32_t newVertices = 0;
+        for (uint32_t c = 0; c < 3; c++) {
+            IO::Assert(tri[c] < vertexCount, "Index {} out of range for {} vertices", tri[c], vertexCount);
+            bool repeated = (c > 0 && tri[c] == tri[0]) || (c > 1 && tri[c] == tri[1]);
+            newVertices += localIndex[tri[c]] == NO_LOCAL_INDEX && !repeated ? 1 : 0;
+        }
+        if (current.vertexCount + newVertices > maxVertices || current.triangleCount == maxTriangles) {
+            flush();
+        }
+
+        uint32_t packed = 0;
+        for (uint32_t c = 0; c < 3; c++) {
+            uint32_t& local = localIndex[tri[c]];
+            if (local == NO_LOCAL_INDEX) {
+                local = current.vertexCount++;
+                data.vertices.push_back(tri[c]);
+            }
+            packed |= local << (c * 8);
+        }
+        data.triangles.push_back(packed);
+        current.triangleCount++;
+    }
+    flush();
+
+    return data;
+}
+} // namespace ida
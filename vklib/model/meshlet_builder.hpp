@@ -0,0 +1,36 @@
+#ifndef VULKAN_LIB_MESHLET_BUILDER_HPP
+#define VULKAN_LIB_MESHLET_BUILDER_HPP
+
+#include "model/model.hpp"
+
+#include <cstdint>
+
+namespace ida {
+/**
+ * Splits an indexed triangle list into meshlets for cluster culling and mesh shaders.
+ *
+ * Triangles are taken in index buffer order and a meshlet is closed once the next triangle would
+ * exceed either limit. After IdaMeshOptimizer the order already keeps neighbouring triangles
+ * together, and every meshlet stays a contiguous range of the index buffer, so the vertex shader
+ * path can draw it with a plain indexed draw. Each meshlet gets a bounding sphere (center of its
+ * bounds, farthest vertex) and a normal cone (Barczak 2015) for backface culling a whole cluster.
+ */
+class IdaMeshletBuilder final {
+  public:
+    using Vertex = IdaModel::Vertex;
+
+    // NVIDIA's recommendation, 124 keeps the 8-bit local indices of a meshlet in 372 bytes
+    static constexpr uint32_t MAX_VERTICES = 64;
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+
+    static MeshletData Build(
+        const Vertex* vertices,
+        uint32_t vertexCount,
+        const uint32_t* indices,
+        uint32_t indexCount,
+        uint32_t maxVertices = MAX_VERTICES,
+        uint32_t maxTriangles = MAX_TRIANGLES);
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_MESHLET_BUILDER_HPP
@@ -1,50 +1,20 @@
 #include "model.hpp"
+#include "core/context.hpp"
+#include "model/gltf_loader.hpp"
+#include "model/mesh_cache.hpp"
+#include "model/mesh_optimizer.hpp"
+#include "model/mesh_simplifier.hpp"
+#include "model/meshlet_builder.hpp"
+#include "model/obj_loader.hpp"
+#include "model/vertex_welder.hpp"
 #include "utils.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 #include "log/log.hpp"
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <memory>
-#include <unordered_map>
-namespace std {
-/**
- * @brief Hash function for glm::vec3
- */
-template <>
-struct hash<glm::vec3> {
-    size_t operator()(const glm::vec3& v) const {
-        size_t seed = 0;
-        ida::hashCombine(seed, v.x, v.y, v.z);
-        return seed;
-    }
-};
-/**
- * @brief Hash function for glm::vec2
- */
-template <>
-struct hash<glm::vec2> {
-    size_t operator()(const glm::vec2& v) const {
-        size_t seed = 0;
-        ida::hashCombine(seed, v.x, v.y);
-        return seed;
-    }
-};
-/**
- * @brief Hash function for Vertex
- */
-template <>
-struct hash<ida::IdaModel::Vertex> {
-    size_t operator()(ida::IdaModel::Vertex const& vertex) const {
-        size_t seed = 0;
-        ida::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-        return seed;
-    }
-};
-} // namespace std
 
 namespace ida {
 std::vector<vk::VertexInputBindingDescription> IdaModel::Vertex::GetBindingDescriptions() {
@@ -64,148 +34,555 @@ std::vector<vk::VertexInputAttributeDescription> IdaModel::Vertex::GetAttributeD
     return attributeDescriptions;
 }
 
-void IdaModel::Builder::LoadModel(const std::string& path) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+std::vector<vk::VertexInputBindingDescription> IdaModel::PackedVertex::GetBindingDescriptions() {
+    std::vector<vk::VertexInputBindingDescription> bindingDescriptions(1);
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].stride = sizeof(PackedVertex);
+    bindingDescriptions[0].inputRate = vk::VertexInputRate::eVertex;
+    return bindingDescriptions;
+}
+
+std::vector<vk::VertexInputAttributeDescription> IdaModel::PackedVertex::GetAttributeDescriptions() {
+    // same locations as Vertex, the normalized formats are expanded to floats by the vertex fetch
+    std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+    attributeDescriptions.push_back({0, 0, vk::Format::eR16G16B16A16Snorm, static_cast<uint32_t>(offsetof(PackedVertex, position))});
+    attributeDescriptions.push_back({1, 0, vk::Format::eR8G8B8A8Unorm, static_cast<uint32_t>(offsetof(PackedVertex, color))});
+    attributeDescriptions.push_back({2, 0, vk::Format::eR16G16Snorm, static_cast<uint32_t>(offsetof(PackedVertex, normal))});
+    attributeDescriptions.push_back({3, 0, vk::Format::eR16G16Unorm, static_cast<uint32_t>(offsetof(PackedVertex, uv))});
+    return attributeDescriptions;
+}
+
+namespace {
+int16_t PackSnorm(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t PackUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
-        IO::ThrowError("Failed to load model: {}", path);
+uint8_t PackUnorm8(float value) {
+    return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+// Octahedral mapping (Cigolle et al. 2014): projects the unit sphere onto an octahedron and folds
+// the lower half over the upper one, the inverse lives in simple_shader_packed_instanced.vert
+glm::vec2 EncodeOctahedral(const glm::vec3& normal) {
+    float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum <= 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec2 p = glm::vec2(normal.x, normal.y) / sum;
+    if (normal.z < 0.0f) {
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
     }
+    return p;
+}
+
+// Extent of every axis, flat axes are widened so the transform stays invertible
+glm::vec3 SafeExtent(const glm::vec3& extent) {
+    return glm::vec3(extent.x > 0.0f ? extent.x : 1.0f, extent.y > 0.0f ? extent.y : 1.0f, extent.z > 0.0f ? extent.z : 1.0f);
+}
 
-    vertices.clear();
+void BuildFromObj(IdaModel::Builder& builder, const ObjMesh& mesh, const WeldOptions& weld) {
+    auto& vertices = builder.vertices;
+    auto& indices = builder.indices;
     indices.clear();
+    indices.reserve(mesh.indices.size());
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    std::unordered_map<glm::vec3, uint32_t> s;
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-            if (index.vertex_index >= 0) {
-                vertex.position = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2],
-                };
-
-                vertex.color = {
-                    attrib.colors[3 * index.vertex_index + 0],
-                    attrib.colors[3 * index.vertex_index + 1],
-                    attrib.colors[3 * index.vertex_index + 2],
-                };
-            }
-            if (index.normal_index >= 0) {
-                vertex.normal = {
-                    attrib.normals[3 * index.normal_index + 0],
-                    attrib.normals[3 * index.normal_index + 1],
-                    attrib.normals[3 * index.normal_index + 2],
-                };
-            }
-            if (index.texcoord_index >= 0) {
-                vertex.uv = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    attrib.texcoords[2 * index.texcoord_index + 1],
-                };
-            }
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            indices.push_back(uniqueVertices[vertex]);
+    // most corners share their position with others, so the position count is a good guess
+    IdaVertexWelder welder(mesh.GetPositionCount(), weld);
+    for (const auto& index : mesh.indices) {
+        IdaModel::Vertex vertex{};
+        if (index.vertex >= 0) {
+            vertex.position = {
+                mesh.positions[3 * index.vertex + 0],
+                mesh.positions[3 * index.vertex + 1],
+                mesh.positions[3 * index.vertex + 2],
+            };
+
+            vertex.color = {
+                mesh.colors[3 * index.vertex + 0],
+                mesh.colors[3 * index.vertex + 1],
+                mesh.colors[3 * index.vertex + 2],
+            };
+        }
+        if (index.normal >= 0) {
+            vertex.normal = {
+                mesh.normals[3 * index.normal + 0],
+                mesh.normals[3 * index.normal + 1],
+                mesh.normals[3 * index.normal + 2],
+            };
+        }
+        if (index.texcoord >= 0) {
+            vertex.uv = {
+                mesh.texcoords[2 * index.texcoord + 0],
+                mesh.texcoords[2 * index.texcoord + 1],
+            };
+        }
+        indices.push_back(welder.Insert(vertex));
+    }
+    vertices = std::move(welder.GetVertices());
+}
+
+glm::vec3 ReadVec3(const GltfAccessor& accessor, uint32_t i) {
+    bool direct = accessor.componentType == GltfComponentType::Float && accessor.componentCount >= 3;
+    return direct ? accessor.Get<glm::vec3>(i) : glm::vec3(accessor.GetFloat(i));
+}
+
+// Vertices of a primitive whose attributes are interleaved exactly like IdaModel::Vertex, which
+// can then be uploaded without a copy, nullptr otherwise
+const IdaModel::Vertex* FindVertexArray(const GltfPrimitive& primitive) {
+    using Vertex = IdaModel::Vertex;
+    const uint8_t* base = primitive.positions.data;
+    auto matches = [&](const GltfAccessor& accessor, uint32_t components, size_t offset) {
+        return accessor.IsValid() && accessor.Is(GltfComponentType::Float, components) && accessor.count == primitive.positions.count &&
+               accessor.stride == sizeof(Vertex) && accessor.data == base + offset;
+    };
+    if (!matches(primitive.positions, 3, offsetof(Vertex, position)) || !matches(primitive.colors, 3, offsetof(Vertex, color)) ||
+        !matches(primitive.normals, 3, offsetof(Vertex, normal)) || !matches(primitive.texcoords, 2, offsetof(Vertex, uv)) ||
+        reinterpret_cast<uintptr_t>(base) % alignof(Vertex) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const Vertex*>(base);
+}
+
+// Converts the vertices of a primitive to the Vertex layout, moving them by transform
+void AppendGltfVertices(std::vector<IdaModel::Vertex>& vertices, const GltfPrimitive& primitive, const glm::mat4& transform) {
+    bool identity = transform == glm::mat4(1.0f);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    size_t first = vertices.size();
+    vertices.resize(first + primitive.positions.count);
+    for (uint32_t i = 0; i < primitive.positions.count; i++) {
+        IdaModel::Vertex& vertex = vertices[first + i];
+        vertex.position = ReadVec3(primitive.positions, i);
+        // white like OBJ vertices without a color
+        vertex.color = primitive.colors.IsValid() ? ReadVec3(primitive.colors, i) : glm::vec3(1.0f);
+        if (primitive.normals.IsValid()) {
+            vertex.normal = ReadVec3(primitive.normals, i);
+        }
+        if (primitive.texcoords.IsValid()) {
+            vertex.uv = glm::vec2(primitive.texcoords.GetFloat(i));
+        }
+        if (!identity) {
+            vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+            glm::vec3 normal = normalMatrix * vertex.normal;
+            float length = glm::length(normal);
+            vertex.normal = length > 0.0f ? normal / length : normal;
+        }
+    }
+}
+
+// Appends the triangles of a primitive, numbering its vertices from firstVertex. Primitives without
+// indices are drawn in vertex order.
+void AppendGltfIndices(std::vector<uint32_t>& indices, const GltfPrimitive& primitive, uint32_t firstVertex, const std::string& path) {
+    uint32_t count = primitive.indices.IsValid() ? primitive.indices.count : primitive.positions.count;
+    count -= count % 3;
+    size_t first = indices.size();
+    indices.resize(first + count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = primitive.indices.IsValid() ? primitive.indices.GetIndex(i) : i;
+        IO::Assert(index < primitive.positions.count, "Index {} out of range in {}", index, path);
+        indices[first + i] = firstVertex + index;
+    }
+}
+
+// Meshlets of level 0, with first indices relative to the whole index buffer
+MeshletData BuildMeshlets(const IdaModel::MeshView& mesh, const std::string& path) {
+    IO::Assert(mesh.indexCount > 0, "Meshlets need an indexed model: {}", path);
+    IdaModel::Lod lod = mesh.lodCount > 0 ? mesh.lods[0] : IdaModel::Lod{0, mesh.indexCount, 0.0f};
+    MeshletData meshlets = IdaMeshletBuilder::Build(mesh.vertices, mesh.vertexCount, mesh.indices + lod.firstIndex, lod.indexCount);
+    for (Meshlet& meshlet : meshlets.meshlets) {
+        meshlet.firstIndex += lod.firstIndex;
+    }
+    return meshlets;
+}
+} // namespace
+
+void IdaModel::Builder::LoadModel(const std::string& path) {
+    LoadModel(path, WeldOptions{});
+}
+
+void IdaModel::Builder::LoadModel(const std::string& path, const WeldOptions& weld) {
+    BuildFromObj(*this, IdaObjLoader::Load(path), weld);
+}
+
+MeshOptimizationStats IdaModel::Builder::Optimize() {
+    IO::Assert(lods.empty(), "Optimize() would mix the levels of detail, it must run before GenerateLods()");
+    return IdaMeshOptimizer::Optimize(vertices, indices);
+}
+
+void IdaModel::Builder::GenerateLods(const LodOptions& options) {
+    lods.clear();
+    IO::Assert(options.levelCount <= MAX_LODS, "LOD level count must be at most {}", MAX_LODS);
+    if (indices.empty() || options.levelCount <= 1) {
+        return;
+    }
+    lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+
+    glm::vec3 boundsMin = vertices[0].position;
+    glm::vec3 boundsMax = vertices[0].position;
+    for (const auto& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    float maxError = options.maxError * glm::length(boundsMax - boundsMin) * 0.5f;
+
+    // every level is simplified from the previous one, so the deviations add up along the chain
+    std::vector<uint32_t> previous(indices);
+    while (lods.size() < options.levelCount) {
+        auto target = static_cast<uint32_t>(static_cast<float>(previous.size() / 3) * options.reduction) * 3;
+        float error = 0.0f;
+        auto simplified = IdaMeshSimplifier::Simplify(vertices, previous, target, maxError - lods.back().error, error);
+        // stopped by the error limit, another level would barely save anything
+        if (simplified.empty() || simplified.size() > previous.size() * 9 / 10) {
+            break;
         }
+        IdaMeshOptimizer::OptimizeVertexCache(simplified, static_cast<uint32_t>(vertices.size()));
+        lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), lods.back().error + error});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
     }
 }
 
-IdaModel::IdaModel(const IdaModel::Builder& builder) {
-    CreateVertexBuffer(builder.vertices);
-    CreateIndexBuffer(builder.indices);
+IdaModel::IdaModel(const IdaModel::Builder& builder, VertexFormat vertexFormat) : vertexFormat_(vertexFormat) {
+    CreateGeometry(
+        builder.vertices.data(),
+        static_cast<uint32_t>(builder.vertices.size()),
+        builder.indices.data(),
+        static_cast<uint32_t>(builder.indices.size()),
+        builder.lods.data(),
+        static_cast<uint32_t>(builder.lods.size()));
+}
+
+IdaModel::IdaModel(const IdaModel::MeshView& mesh, VertexFormat vertexFormat) : vertexFormat_(vertexFormat) {
+    CreateGeometry(mesh.vertices, mesh.vertexCount, mesh.indices, mesh.indexCount, mesh.lods, mesh.lodCount);
 }
 
 IdaModel::~IdaModel() {
     IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Model destroyed");
-    vertexBuffer_.reset();
-    indexBuffer_.reset();
+    auto& ctx = Context::GetInstance();
+    ctx.geometryArena->Untrack(&geometry_);
+    // frames in flight may still draw from the range, so it is only reused once they are done
+    ctx.deletionQueue->Push([geometry = geometry_]() mutable {
+        Context::GetInstance().geometryArena->Free(geometry);
+    });
 }
 
-std::unique_ptr<IdaModel> IdaModel::ImportModel(const std::string& path) {
-    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Importing model: {}", path);
-    Builder builder{};
-    builder.LoadModel(path);
-    return std::make_unique<IdaModel>(builder);
+IdaModel::ImportedMesh::ImportedMesh() = default;
+IdaModel::ImportedMesh::~ImportedMesh() = default;
+
+IdaModel::MeshView IdaModel::ImportedMesh::GetView() const {
+    if (cache) {
+        return cache->GetView();
+    }
+    if (gltf) {
+        return gltfView;
+    }
+    return {
+        builder.vertices.data(),
+        static_cast<uint32_t>(builder.vertices.size()),
+        builder.indices.data(),
+        static_cast<uint32_t>(builder.indices.size()),
+        builder.lods.data(),
+        static_cast<uint32_t>(builder.lods.size()),
+    };
 }
 
-void IdaModel::Bind(vk::CommandBuffer cmd) {
-    vk::Buffer buffers[] = {vertexBuffer_->GetBuffer()};
-    vk::DeviceSize offsets[] = {0};
-    cmd.bindVertexBuffers(0, 1, buffers, offsets);
-    if (hasIndexBuffer_) {
-        cmd.bindIndexBuffer(indexBuffer_->GetBuffer(), 0, vk::IndexType::eUint32);
+vk::DeviceSize IdaModel::ImportedMesh::GetUploadSize() const {
+    MeshView view = GetView();
+    vk::DeviceSize vertexStride = vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    return vertexStride * view.vertexCount + sizeof(uint32_t) * view.indexCount;
+}
+
+std::unique_ptr<IdaModel> IdaModel::ImportModel(const std::string& path, const ImportOptions& options) {
+    return CreateModel(*ParseModel(path, options));
+}
+
+std::unique_ptr<IdaModel::ImportedMesh> IdaModel::ParseModel(const std::string& path, const ImportOptions& options, uint32_t threadCount) {
+    const WeldOptions& weld = options.weld;
+    IO::Assert(
+        !options.buildMeshlets || options.vertexFormat == VertexFormat::Float,
+        "Meshlets are only built for float vertices: {}",
+        path);
+    if (IdaGltfLoader::IsGltfPath(path)) {
+        return ParseGltfScene(path, options);
+    }
+    auto mesh = std::make_unique<ImportedMesh>();
+    mesh->path = path;
+    mesh->vertexFormat = options.vertexFormat;
+
+    IdaMappedFile source(path);
+    uint64_t sourceHash = hashBytes(source.GetData(), source.GetSize());
+    mesh->sourceHash = sourceHash;
+    // caches written by an older optimizer or simplifier are rebuilt as well, the cache always holds
+    // float vertices so the vertex format is left out and applied on upload
+    uint64_t optionsHash = hashBytes(&weld, sizeof(WeldOptions), IdaMeshOptimizer::VERSION);
+    uint32_t optimize = options.optimize ? 1 : 0;
+    optionsHash = hashBytes(&optimize, sizeof(optimize), optionsHash);
+    uint64_t simplifierVersion = IdaMeshSimplifier::VERSION;
+    optionsHash = hashBytes(&simplifierVersion, sizeof(simplifierVersion), optionsHash);
+    optionsHash = hashBytes(&options.lod, sizeof(LodOptions), optionsHash);
+    std::string cachePath = IdaMeshCache::GetCachePath(path, optionsHash);
+
+    // uploads go straight out of the mapping, the cache can be unmapped once the copies are recorded
+    mesh->cache = IdaMeshCache::Open(cachePath, sourceHash, optionsHash);
+    if (mesh->cache) {
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Loading model from cache: {}", cachePath);
+    } else {
+        IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Importing model: {}", path);
+        Builder& builder = mesh->builder;
+        BuildFromObj(builder, IdaObjLoader::Parse(source.GetData(), source.GetSize(), threadCount, path), weld);
+        if (options.optimize) {
+            // paid once per source thanks to the cache
+            auto stats = builder.Optimize();
+            IO::PrintLog(
+                LOG_LEVEL::LOG_LEVEL_INFO,
+                "Optimized {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, removed {} degenerate triangles and {} unused vertices",
+                path,
+                stats.before.acmr,
+                stats.after.acmr,
+                stats.before.atvr,
+                stats.after.atvr,
+                stats.degenerateTriangles,
+                stats.unusedVertices);
+        }
+        builder.GenerateLods(options.lod);
+        IdaMeshCache::Write(cachePath, sourceHash, optionsHash, builder.vertices, builder.indices, builder.lods);
+    }
+    if (options.buildMeshlets) {
+        // cheap next to parsing, so meshlets are rebuilt on every import instead of being cached
+        mesh->meshlets = BuildMeshlets(mesh->GetView(), path);
+    }
+    return mesh;
+}
+
+std::unique_ptr<IdaModel::ImportedMesh> IdaModel::ParseGltfPrimitive(
+    std::shared_ptr<const GltfAsset> asset,
+    uint32_t mesh,
+    uint32_t primitive,
+    const ImportOptions& options) {
+    IO::Assert(mesh < asset->meshes.size() && primitive < asset->meshes[mesh].primitives.size(), "No primitive {} in mesh {}: {}", primitive, mesh, asset->path);
+    const GltfPrimitive& source = asset->meshes[mesh].primitives[primitive];
+    IO::Assert(source.mode == GltfPrimitive::MODE_TRIANGLES, "Only triangle list primitives are supported: {}", asset->path);
+    IO::Assert(!options.buildMeshlets || options.vertexFormat == VertexFormat::Float, "Meshlets are only built for float vertices: {}", asset->path);
+
+    auto imported = std::make_unique<ImportedMesh>();
+    imported->path = asset->path;
+    imported->vertexFormat = options.vertexFormat;
+    // the primitives of one file must not alias each other in the asset registry
+    uint32_t location[2] = {mesh, primitive};
+    imported->sourceHash = hashBytes(location, sizeof(location), asset->contentHash);
+
+    Builder& builder = imported->builder;
+    MeshView& view = imported->gltfView;
+    view.vertexCount = source.positions.count;
+    view.vertices = FindVertexArray(source);
+    if (!view.vertices) {
+        AppendGltfVertices(builder.vertices, source, glm::mat4(1.0f));
+        view.vertices = builder.vertices.data();
+    }
+    const uint32_t* indices = source.indices.componentType == GltfComponentType::UnsignedInt ? source.indices.GetArray<uint32_t>() : nullptr;
+    if (indices) {
+        // read in place, but still checked since the GPU would fetch out of range vertices
+        for (uint32_t i = 0; i < source.indices.count; i++) {
+            IO::Assert(indices[i] < view.vertexCount, "Index {} out of range in {}", indices[i], asset->path);
+        }
+        view.indices = indices;
+        view.indexCount = source.indices.count - source.indices.count % 3;
+    } else {
+        AppendGltfIndices(builder.indices, source, 0, asset->path);
+        view.indices = builder.indices.data();
+        view.indexCount = static_cast<uint32_t>(builder.indices.size());
+    }
+    imported->gltf = std::move(asset);
+    if (options.buildMeshlets) {
+        imported->meshlets = BuildMeshlets(view, imported->path);
+    }
+    return imported;
+}
+
+std::unique_ptr<IdaModel::ImportedMesh> IdaModel::ParseGltfScene(const std::string& path, const ImportOptions& options) {
+    std::shared_ptr<const GltfAsset> asset = IdaGltfLoader::Load(path);
+    std::vector<std::pair<const GltfNode*, uint32_t>> instances;
+    for (uint32_t index : asset->sceneNodes) {
+        const GltfNode& node = asset->nodes[index];
+        if (node.mesh < 0) {
+            continue;
+        }
+        const auto& primitives = asset->meshes[node.mesh].primitives;
+        for (uint32_t i = 0; i < primitives.size(); i++) {
+            if (primitives[i].mode == GltfPrimitive::MODE_TRIANGLES) {
+                instances.emplace_back(&node, i);
+            } else {
+                IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Skipping non triangle primitive {} of mesh {}: {}", i, node.mesh, path);
+            }
+        }
+    }
+    IO::Assert(!instances.empty(), "No triangles in the default scene of {}", path);
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Importing glTF: {} ({} primitives)", path, instances.size());
+
+    // a single untransformed primitive is the one layout that can be uploaded in place
+    const GltfNode& first = *instances[0].first;
+    if (instances.size() == 1 && first.worldTransform == glm::mat4(1.0f)) {
+        auto mesh = ParseGltfPrimitive(asset, first.mesh, instances[0].second, options);
+        mesh->sourceHash = asset->contentHash;
+        return mesh;
+    }
+
+    IO::Assert(!options.buildMeshlets || options.vertexFormat == VertexFormat::Float, "Meshlets are only built for float vertices: {}", path);
+    auto mesh = std::make_unique<ImportedMesh>();
+    mesh->path = path;
+    mesh->sourceHash = asset->contentHash;
+    mesh->vertexFormat = options.vertexFormat;
+    Builder& builder = mesh->builder;
+    for (const auto& [node, primitive] : instances) {
+        const GltfPrimitive& source = asset->meshes[node->mesh].primitives[primitive];
+        auto firstVertex = static_cast<uint32_t>(builder.vertices.size());
+        AppendGltfVertices(builder.vertices, source, node->worldTransform);
+        AppendGltfIndices(builder.indices, source, firstVertex, path);
     }
+    if (options.buildMeshlets) {
+        mesh->meshlets = BuildMeshlets(mesh->GetView(), path);
+    }
+    return mesh;
+}
+
+std::unique_ptr<IdaModel> IdaModel::CreateModel(ImportedMesh& mesh) {
+    auto model = std::make_unique<IdaModel>(mesh.GetView(), mesh.vertexFormat);
+    model->meshlets_ = std::move(mesh.meshlets);
+    model->sourceHash_ = mesh.sourceHash;
+    return model;
+}
+
+bool IdaModel::IsResident() const {
+    return Context::GetInstance().uploadBatcher->IsAvailable(uploadToken_);
+}
+
+void IdaModel::Bind(vk::CommandBuffer cmd) {
+    Context::GetInstance().geometryArena->Bind(cmd, geometry_.page, indexType_);
 }
 
-void IdaModel::Draw(vk::CommandBuffer cmd) {
+void IdaModel::Draw(vk::CommandBuffer cmd, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance) {
     if (hasIndexBuffer_) {
-        cmd.drawIndexed(indexCount_, 1, 0, 0, 0);
+        const Lod& range = lods_[std::min(lod, GetLodCount() - 1)];
+        cmd.drawIndexed(range.indexCount, instanceCount, GetFirstIndex() + range.firstIndex, GetVertexOffset(), firstInstance);
     } else {
-        cmd.draw(vertexCount_, 1, 0, 0);
+        cmd.draw(vertexCount_, instanceCount, static_cast<uint32_t>(GetVertexOffset()), firstInstance);
     }
 }
 
-void IdaModel::CreateVertexBuffer(const std::vector<Vertex>& vertices) {
-    vertexCount_ = static_cast<uint32_t>(vertices.size());
+void IdaModel::CreateGeometry(
+    const Vertex* vertices,
+    uint32_t vertexCount,
+    const uint32_t* indices,
+    uint32_t indexCount,
+    const Lod* lods,
+    uint32_t lodCount) {
+    vertexCount_ = vertexCount;
     IO::Assert(vertexCount_ >= 3, "Vertex count must be greater than 3");
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertexCount_;
-    uint32_t vertexSize = sizeof(vertices[0]);
+    indexCount_ = indexCount;
+    hasIndexBuffer_ = indexCount_ > 0;
+    if (hasIndexBuffer_) {
+        if (lodCount > 0) {
+            lods_.assign(lods, lods + lodCount);
+        } else {
+            lods_.push_back({0, indexCount_, 0.0f});
+        }
+    }
+    ComputeBounds(vertices, vertexCount_);
 
-    IdaBuffer stagingBuffer{
-        BufferType::StagingBuffer,
-        vertexSize,
-        vertexCount_,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent};
+    std::vector<PackedVertex> packedVertices;
+    const void* vertexData = vertices;
+    vk::DeviceSize vertexStride = sizeof(Vertex);
+    if (vertexFormat_ == VertexFormat::Packed) {
+        packedVertices = PackVertices(vertices, vertexCount_);
+        vertexData = packedVertices.data();
+        vertexStride = sizeof(PackedVertex);
+    }
 
-    stagingBuffer.Map();
-    stagingBuffer.WriteToBuffer((void*)vertices.data());
+    // 16-bit indices halve the index buffer whenever every vertex can be addressed with them
+    std::vector<uint16_t> shortIndices;
+    const void* indexData = indices;
+    vk::DeviceSize indexStride = sizeof(uint32_t);
+    if (hasIndexBuffer_ && vertexCount_ <= UINT16_MAX) {
+        shortIndices.assign(indices, indices + indexCount_);
+        indexData = shortIndices.data();
+        indexStride = sizeof(uint16_t);
+        indexType_ = vk::IndexType::eUint16;
+    }
 
-    vertexBuffer_ = std::make_unique<IdaBuffer>(
-        BufferType::VertexBuffer,
-        vertexSize,
-        vertexCount_,
-        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    vk::DeviceSize vertexBytes = vertexStride * vertexCount_;
+    vk::DeviceSize indexBytes = indexStride * indexCount_;
+    auto& arena = *Context::GetInstance().geometryArena;
+    geometry_ = arena.Allocate(vertexBytes, vertexStride, indexBytes, indexStride);
 
-    IdaBuffer::Utils::CopyBuffer(stagingBuffer.GetBuffer(), vertexBuffer_->GetBuffer(), bufferSize);
+    uploadToken_ = arena.Write(geometry_, vertexData, indexData);
+    // only once the uploads are recorded, the defragmenter waits for them before moving anything
+    arena.Track(&geometry_);
 }
 
-void IdaModel::CreateIndexBuffer(const std::vector<uint32_t>& indices) {
-    indexCount_ = static_cast<uint32_t>(indices.size());
-    hasIndexBuffer_ = indexCount_ > 0;
-    if (!hasIndexBuffer_) {
-        return;
+void IdaModel::ComputeBounds(const Vertex* vertices, uint32_t vertexCount) {
+    boundsMin_ = vertices[0].position;
+    boundsMax_ = vertices[0].position;
+    for (uint32_t i = 1; i < vertexCount; i++) {
+        boundsMin_ = glm::min(boundsMin_, vertices[i].position);
+        boundsMax_ = glm::max(boundsMax_, vertices[i].position);
+    }
+    glm::vec3 center = GetBoundsCenter();
+    float radiusSquared = 0.0f;
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        glm::vec3 offset = vertices[i].position - center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
     }
+    boundsRadius_ = std::sqrt(radiusSquared);
+}
 
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indexCount_;
-    uint32_t indexSize = sizeof(indices[0]);
+std::vector<IdaModel::PackedVertex> IdaModel::PackVertices(const Vertex* vertices, uint32_t vertexCount) {
+    glm::vec2 uvMin = vertices[0].uv;
+    glm::vec2 uvMax = vertices[0].uv;
+    for (uint32_t i = 1; i < vertexCount; i++) {
+        uvMin = glm::min(uvMin, vertices[i].uv);
+        uvMax = glm::max(uvMax, vertices[i].uv);
+    }
 
-    IdaBuffer stagingBuffer{
-        BufferType::StagingBuffer,
-        indexSize,
-        indexCount_,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent};
+    // snorm positions span the bounds, so the precision follows the size of the model
+    glm::vec3 center = GetBoundsCenter();
+    glm::vec3 extent = SafeExtent((boundsMax_ - boundsMin_) * 0.5f);
+    dequantizeMatrix_ = glm::mat4(1.0f);
+    dequantizeMatrix_[0][0] = extent.x;
+    dequantizeMatrix_[1][1] = extent.y;
+    dequantizeMatrix_[2][2] = extent.z;
+    dequantizeMatrix_[3] = glm::vec4(center, 1.0f);
 
-    stagingBuffer.Map();
-    stagingBuffer.WriteToBuffer((void*)indices.data());
+    glm::vec2 uvRange = uvMax - uvMin;
+    uvRange = glm::vec2(uvRange.x > 0.0f ? uvRange.x : 1.0f, uvRange.y > 0.0f ? uvRange.y : 1.0f);
+    uvTransform_ = glm::vec4(uvMin, uvRange);
 
-    indexBuffer_ = std::make_unique<IdaBuffer>(
-        BufferType::IndexBuffer,
-        indexSize,
-        indexCount_,
-        vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    std::vector<PackedVertex> packed(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+        glm::vec3 position = (vertex.position - center) / extent;
+        out.position[0] = PackSnorm(position.x);
+        out.position[1] = PackSnorm(position.y);
+        out.position[2] = PackSnorm(position.z);
+        out.position[3] = 0;
 
-    IdaBuffer::Utils::CopyBuffer(stagingBuffer.GetBuffer(), indexBuffer_->GetBuffer(), bufferSize);
+        out.color[0] = PackUnorm8(vertex.color.r);
+        out.color[1] = PackUnorm8(vertex.color.g);
+        out.color[2] = PackUnorm8(vertex.color.b);
+        out.color[3] = UINT8_MAX;
+
+        glm::vec2 normal = EncodeOctahedral(vertex.normal);
+        out.normal[0] = PackSnorm(normal.x);
+        out.normal[1] = PackSnorm(normal.y);
+
+        glm::vec2 uv = (vertex.uv - uvMin) / uvRange;
+        out.uv[0] = PackUnorm16(uv.x);
+        out.uv[1] = PackUnorm16(uv.y);
+    }
+    return packed;
 }
 
 std::unique_ptr<IdaModel> IdaModel::CustomModel(const std::vector<Vertex>& vertices) {
@@ -2,17 +2,77 @@
 #define VULKAN_LIB_MODEL_HPP
 
 #include "buffer/buffer.hpp"
+#include "model/geometry_arena.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include "glm/glm.hpp"
 #include "vulkan/vulkan.hpp"
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace ida {
+struct MeshOptimizationStats;
+struct GltfAsset;
+class IdaMeshCache;
+
+struct WeldOptions {
+    // vertices whose position and normal components differ by at most these amounts are merged,
+    // 0 only merges vertices that compare equal
+    float positionEpsilon = 0.0f;
+    float normalEpsilon = 0.0f;
+
+    bool IsExact() const { return positionEpsilon <= 0.0f && normalEpsilon <= 0.0f; }
+};
+
+struct LodOptions {
+    // levels including the full resolution one, generation stops early once a level can no longer
+    // be reduced within maxError. 0 or 1 skips simplification and draws the mesh as a single level.
+    uint32_t levelCount = 4;
+    // triangle count of every level relative to the previous one
+    float reduction = 0.5f;
+    // largest deviation a level may accumulate, relative to the bounding sphere radius
+    float maxError = 0.05f;
+};
+
+// Cluster of up to IdaMeshletBuilder::MAX_VERTICES vertices and MAX_TRIANGLES triangles, in the
+// std430 layout cluster_cull.comp and cluster_shader.mesh read it with
+struct Meshlet {
+    glm::vec3 center{};
+    float radius = 0.0f;
+    // every triangle faces away from a viewer with dot(center - viewer, coneAxis) >=
+    // coneCutoff * |center - viewer| + radius, a cutoff of 1 never culls
+    glm::vec3 coneAxis{};
+    float coneCutoff = 1.0f;
+    // triangles in the level 0 range of the model's index buffer
+    uint32_t firstIndex = 0;
+    uint32_t triangleCount = 0;
+    // into MeshletData::vertices and MeshletData::triangles
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleOffset = 0;
+    uint32_t padding[3]{};
+};
+
+struct MeshletData {
+    std::vector<Meshlet> meshlets;
+    // model vertex of every meshlet local vertex
+    std::vector<uint32_t> vertices;
+    // three 8-bit local vertices per triangle
+    std::vector<uint32_t> triangles;
+};
+
+// Layout a model's vertices are stored in on the GPU
+enum class VertexFormat : uint32_t {
+    Float,  // IdaModel::Vertex, 44 bytes
+    Packed, // IdaModel::PackedVertex, 20 bytes
+};
+
 class IdaModel {
   public:
+    static constexpr uint32_t MAX_LODS = 8;
+
     struct Vertex {
         glm::vec3 position{};
         glm::vec3 color{};
@@ -26,34 +86,186 @@ class IdaModel {
             return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
         }
     };
+    /**
+     * Quantized vertex: positions are snorm16 inside the model's bounds (expanded by
+     * GetDequantizeMatrix()), normals are octahedral snorm16, uvs are unorm16 inside the model's
+     * uv bounds (expanded with GetUvTransform()) and colors are rgba8.
+     */
+    struct PackedVertex {
+        int16_t position[4]{}; // w is unused, 3 component 16-bit formats are rarely supported
+        uint8_t color[4]{};
+        int16_t normal[2]{};
+        uint16_t uv[2]{};
+
+        static std::vector<vk::VertexInputBindingDescription> GetBindingDescriptions();
+        static std::vector<vk::VertexInputAttributeDescription> GetAttributeDescriptions();
+    };
+    // Range of the index buffer drawing one level of detail, level 0 is the full mesh
+    struct Lod {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        float error = 0.0f; // largest deviation from the full mesh, in model units
+    };
+    struct ImportOptions {
+        // OBJ only, glTF geometry is already indexed and is taken as authored
+        WeldOptions weld{};
+        // OBJ only, runs Builder::Optimize() before the levels of detail are generated
+        bool optimize = false;
+        LodOptions lod{};
+        VertexFormat vertexFormat = VertexFormat::Float;
+        // splits the full resolution level into meshlets for ClusterRenderSystem, float vertices only
+        bool buildMeshlets = false;
+    };
     struct Builder {
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
+        // empty draws all indices as a single level
+        std::vector<Lod> lods;
 
         void LoadModel(const std::string& path);
+        // Also merges vertices within the tolerances, see IdaVertexWelder
+        void LoadModel(const std::string& path, const WeldOptions& weld);
+        // Reorders the triangles for the post transform cache and overdraw, renumbers vertices in
+        // fetch order and drops degenerate triangles and unused vertices, see IdaMeshOptimizer
+        MeshOptimizationStats Optimize();
+        // Appends simplified copies of the indices for every coarser level, see IdaMeshSimplifier.
+        // Optimize(), which reorders the whole index buffer, has to run before it if at all.
+        void GenerateLods(const LodOptions& options = {});
+    };
+    // Geometry owned by someone else, e.g. the blobs of a mapped mesh cache
+    struct MeshView {
+        const Vertex* vertices = nullptr;
+        uint32_t vertexCount = 0;
+        const uint32_t* indices = nullptr;
+        uint32_t indexCount = 0;
+        const Lod* lods = nullptr;
+        uint32_t lodCount = 0;
     };
+    // CPU half of ImportModel(), everything done before the GPU is touched
+    struct ImportedMesh {
+        std::string path;
+        uint64_t sourceHash = 0;
+        VertexFormat vertexFormat = VertexFormat::Float;
+        Builder builder;
+        // set instead of builder on a cache hit, the view points into the mapping
+        std::unique_ptr<IdaMeshCache> cache;
+        // set instead of the cache for glTF primitives, gltfView points into the mapped asset, or
+        // into builder for the attributes that had to be converted
+        std::shared_ptr<const GltfAsset> gltf;
+        MeshView gltfView;
+        MeshletData meshlets;
 
-    IdaModel(const Builder& builder);
+        ImportedMesh();
+        ~ImportedMesh();
+        MeshView GetView() const;
+        // bytes CreateModel() uploads
+        vk::DeviceSize GetUploadSize() const;
+    };
+
+    IdaModel(const Builder& builder, VertexFormat vertexFormat = VertexFormat::Float);
+    IdaModel(const MeshView& mesh, VertexFormat vertexFormat = VertexFormat::Float);
     ~IdaModel();
     IdaModel(const IdaModel&) = delete;
     IdaModel& operator=(const IdaModel&) = delete;
 
-    static std::unique_ptr<IdaModel> ImportModel(const std::string& path);
+    // Loads from the binary mesh cache next to path when it is up to date, otherwise parses path
+    // and (re)writes the cache
+    static std::unique_ptr<IdaModel> ImportModel(const std::string& path, const ImportOptions& options = {});
+    // Reads, optimizes and caches path without any GPU work, so it can run on worker threads.
+    // threadCount is handed to IdaObjLoader, 0 uses every hardware thread. .gltf and .glb files
+    // become a single model of every primitive in their default scene, see ParseGltfPrimitive().
+    static std::unique_ptr<ImportedMesh> ParseModel(const std::string& path, const ImportOptions& options = {}, uint32_t threadCount = 0);
+    // One triangle primitive of a glTF asset. Vertices interleaved in the Vertex layout and 32-bit
+    // indices are uploaded straight from the mapped buffers, other layouts are converted once.
+    static std::unique_ptr<ImportedMesh> ParseGltfPrimitive(
+        std::shared_ptr<const GltfAsset> asset,
+        uint32_t mesh,
+        uint32_t primitive,
+        const ImportOptions& options = {});
+    // Allocates the geometry and records its uploads, on the thread recording the frames
+    static std::unique_ptr<IdaModel> CreateModel(ImportedMesh& mesh);
     static std::unique_ptr<IdaModel> CustomModel(const std::vector<Vertex>& vertices);
 
+    // Binds the arena page this model lives in with its index type, render systems drawing many
+    // models should only bind again when GetArenaPage() or GetIndexType() change and call Draw()
     void Bind(vk::CommandBuffer cmd);
-    void Draw(vk::CommandBuffer cmd);
+    // Instances read their data from gl_InstanceIndex, which starts at firstInstance
+    void Draw(vk::CommandBuffer cmd, uint32_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+    uint32_t GetArenaPage() const { return geometry_.page; }
+    // in elements, as consumed by vkCmdDrawIndexed, read from the arena handle every time since
+    // the defragmenter may move the model
+    int32_t GetVertexOffset() const { return static_cast<int32_t>(geometry_.vertexOffset / geometry_.vertexStride); }
+    uint32_t GetFirstIndex() const { return static_cast<uint32_t>(geometry_.indexOffset / geometry_.indexStride); }
+    uint32_t GetVertexCount() const { return vertexCount_; }
+    uint32_t GetIndexCount() const { return indexCount_; }
+    // at least one level for indexed models, none otherwise
+    const std::vector<Lod>& GetLods() const { return lods_; }
+    uint32_t GetLodCount() const { return static_cast<uint32_t>(lods_.size()); }
+    uint32_t GetTriangleCount(uint32_t lod = 0) const { return hasIndexBuffer_ ? lods_[lod].indexCount / 3 : vertexCount_ / 3; }
+    // 16-bit for meshes with fewer than 65536 vertices
+    vk::IndexType GetIndexType() const { return indexType_; }
+
+    VertexFormat GetVertexFormat() const { return vertexFormat_; }
+    // Maps packed positions to model space, identity for float vertices
+    const glm::mat4& GetDequantizeMatrix() const { return dequantizeMatrix_; }
+    // uv = offset.xy + packed.uv * scale.zw, (0, 0, 1, 1) for float vertices
+    const glm::vec4& GetUvTransform() const { return uvTransform_; }
+
+    // drawn by ClusterRenderSystem when not empty
+    bool HasMeshlets() const { return !meshlets_.meshlets.empty(); }
+    const MeshletData& GetMeshlets() const { return meshlets_; }
+
+    // model space bounds of every vertex
+    const glm::vec3& GetBoundsMin() const { return boundsMin_; }
+    const glm::vec3& GetBoundsMax() const { return boundsMax_; }
+    glm::vec3 GetBoundsCenter() const { return (boundsMin_ + boundsMax_) * 0.5f; }
+    // radius of the sphere around GetBoundsCenter() enclosing every vertex
+    float GetBoundsRadius() const { return boundsRadius_; }
+
+    // hash of the file contents the model was imported from, 0 for models built in code
+    uint64_t GetSourceHash() const { return sourceHash_; }
+    // bytes the model occupies in the geometry arena
+    vk::DeviceSize GetMemorySize() const { return geometry_.vertexSize + geometry_.indexSize; }
+
+    UploadToken GetUploadToken() const { return uploadToken_; }
+    // Uploaded and owned by the graphics queue, i.e. safe to draw in the current frame
+    bool IsResident() const;
 
   private:
-    void CreateVertexBuffer(const std::vector<Vertex>& vertices);
-    void CreateIndexBuffer(const std::vector<uint32_t>& indices);
+    // Every triangle primitive of the default scene merged into one mesh at its node's transform
+    static std::unique_ptr<ImportedMesh> ParseGltfScene(const std::string& path, const ImportOptions& options);
+    void CreateGeometry(
+        const Vertex* vertices,
+        uint32_t vertexCount,
+        const uint32_t* indices,
+        uint32_t indexCount,
+        const Lod* lods,
+        uint32_t lodCount);
+    void ComputeBounds(const Vertex* vertices, uint32_t vertexCount);
+    std::vector<PackedVertex> PackVertices(const Vertex* vertices, uint32_t vertexCount);
 
-    std::unique_ptr<IdaBuffer> vertexBuffer_;
-    std::unique_ptr<IdaBuffer> indexBuffer_;
+    GeometryAllocation geometry_;
     bool hasIndexBuffer_{false};
+    vk::IndexType indexType_{vk::IndexType::eUint32};
+
+    VertexFormat vertexFormat_{VertexFormat::Float};
+    glm::mat4 dequantizeMatrix_{1.0f};
+    glm::vec4 uvTransform_{0.0f, 0.0f, 1.0f, 1.0f};
 
     uint32_t vertexCount_{0};
     uint32_t indexCount_{0};
+    std::vector<Lod> lods_;
+
+    MeshletData meshlets_;
+    uint64_t sourceHash_{0};
+
+    glm::vec3 boundsMin_{0.0f};
+    glm::vec3 boundsMax_{0.0f};
+    float boundsRadius_{0.0f};
+
+    // last upload batch this model's buffers were written by
+    UploadToken uploadToken_{0};
 };
 } // namespace ida
 
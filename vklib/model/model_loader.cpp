@@ -0,0 +1,118 @@
+#include "model_loader.hpp"
+
+#include "log/log.hpp"
+
+#include <algorithm>
+
+namespace ida {
+IdaModelLoader::IdaModelLoader(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    workers_.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers_.emplace_back(&IdaModelLoader::WorkerLoop, this);
+    }
+    IO::PrintLog(LOG_LEVEL::LOG_LEVEL_INFO, "Model loader started with {} threads", threadCount);
+}
+
+IdaModelLoader::~IdaModelLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+IdaModelLoader::Future IdaModelLoader::ImportAsync(const std::string& path, const IdaModel::ImportOptions& options, Callback onResident) {
+    auto request = std::make_unique<Request>();
+    request->path = path;
+    request->options = options;
+    request->onResident = std::move(onResident);
+    Future future = request->promise.get_future().share();
+    pendingCount_++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back(std::move(request));
+    }
+    condition_.notify_one();
+    return future;
+}
+
+void IdaModelLoader::WorkerLoop() {
+    while (true) {
+        std::unique_ptr<Request> request;
+        bool alone;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !queued_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            request = std::move(queued_.front());
+            queued_.pop_front();
+            alone = queued_.empty();
+        }
+
+        try {
+            // a single import may split its parse over every core, several already fill them
+            request->mesh = IdaModel::ParseModel(request->path, request->options, alone ? 0 : 1);
+        } catch (...) {
+            request->error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        parsed_.push_back(std::move(request));
+    }
+}
+
+void IdaModelLoader::Update() {
+    std::vector<std::unique_ptr<Request>> parsed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // at least one mesh per call, however large
+        vk::DeviceSize uploaded = 0;
+        while (!parsed_.empty() && (parsed.empty() || uploaded < uploadBudget_)) {
+            auto& request = parsed_.front();
+            uploaded += request->mesh ? request->mesh->GetUploadSize() : 0;
+            parsed.push_back(std::move(request));
+            parsed_.pop_front();
+        }
+    }
+
+    for (auto& request : parsed) {
+        if (!request->error) {
+            try {
+                request->model = IdaModel::CreateModel(*request->mesh);
+            } catch (...) {
+                request->error = std::current_exception();
+            }
+        }
+        // the model owns its copy of the geometry, the cache mapping or builder can go
+        request->mesh.reset();
+        if (request->error) {
+            IO::PrintLog(LOG_LEVEL::LOG_LEVEL_WARNING, "Failed to import model: {}", request->path);
+            request->promise.set_exception(request->error);
+            pendingCount_--;
+            continue;
+        }
+        uploading_.push_back(std::move(request));
+    }
+
+    auto resident = std::stable_partition(uploading_.begin(), uploading_.end(), [](const auto& request) {
+        return !request->model->IsResident();
+    });
+    for (auto it = resident; it != uploading_.end(); ++it) {
+        auto& request = *it;
+        request->promise.set_value(request->model);
+        if (request->onResident) {
+            request->onResident(request->model);
+        }
+        pendingCount_--;
+    }
+    uploading_.erase(resident, uploading_.end());
+}
+} // namespace ida
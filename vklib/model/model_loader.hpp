@@ -0,0 +1,87 @@
+#ifndef VULKAN_LIB_MODEL_LOADER_HPP
+#define VULKAN_LIB_MODEL_LOADER_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "model/model.hpp"
+
+namespace ida {
+/**
+ * Imports models in the background.
+ *
+ * Worker threads run IdaModel::ParseModel() (reading, parsing, welding, optimizing, simplifying
+ * and writing the mesh cache). Update(), called once per frame by the thread recording the
+ * frames, turns the parsed meshes into IdaModels, which only records their copies into the
+ * upload batcher, so neither the workers nor the frame ever wait on the GPU. A request completes
+ * once its model is resident: the future becomes ready and the callback runs inside Update(), so
+ * game objects keep drawing nothing, or a placeholder model, until then.
+ */
+class IdaModelLoader final {
+  public:
+    using Callback = std::function<void(std::shared_ptr<IdaModel>)>;
+    using Future = std::shared_future<std::shared_ptr<IdaModel>>;
+
+    // meshes created per Update(), so a burst of finished imports can't stall a frame
+    static constexpr vk::DeviceSize DEFAULT_UPLOAD_BUDGET = 64ull * 1024 * 1024;
+
+    // threadCount 0 leaves one hardware thread to the frame and uses the others
+    explicit IdaModelLoader(uint32_t threadCount = 0);
+    // Stops the workers, queued requests are dropped with a broken promise
+    ~IdaModelLoader();
+    IdaModelLoader(const IdaModelLoader&) = delete;
+    IdaModelLoader& operator=(const IdaModelLoader&) = delete;
+
+    // Can be called from any thread. Import errors are rethrown by the future, the callback only
+    // runs for models that loaded.
+    Future ImportAsync(const std::string& path, const IdaModel::ImportOptions& options = {}, Callback onResident = nullptr);
+
+    // Creates the meshes parsed since the last call, within the upload budget, and completes the
+    // requests whose model became resident
+    void Update();
+
+    void SetUploadBudget(vk::DeviceSize bytes) { uploadBudget_ = bytes; }
+    // queued, parsing or uploading
+    size_t GetPendingCount() const { return pendingCount_.load(); }
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+  private:
+    struct Request {
+        std::string path;
+        IdaModel::ImportOptions options;
+        std::promise<std::shared_ptr<IdaModel>> promise;
+        Callback onResident;
+        std::unique_ptr<IdaModel::ImportedMesh> mesh;
+        std::exception_ptr error;
+        std::shared_ptr<IdaModel> model;
+    };
+
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    // waiting for a worker, and parsed waiting for Update()
+    std::deque<std::unique_ptr<Request>> queued_;
+    std::deque<std::unique_ptr<Request>> parsed_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_ = false;
+
+    // owned by the thread calling Update()
+    std::vector<std::unique_ptr<Request>> uploading_;
+    vk::DeviceSize uploadBudget_ = DEFAULT_UPLOAD_BUDGET;
+    std::atomic<size_t> pendingCount_{0};
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_MODEL_LOADER_HPP
@@ -0,0 +1,651 @@
+#include "obj_loader.hpp"
+
+#include "core/mapped_file.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace ida {
+namespace {
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    std::vector<float> positions;
+    std::vector<float> colors;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+
+    // corners of every face in file order, faceSizes holds how many belong to each face
+    std::vector<ObjIndex> corners;
+    std::vector<uint32_t> faceSizes;
+    // corner * 3 + attribute of every relative index, relative to the start of the chunk until
+    // the attribute counts of the preceding chunks are known
+    std::vector<size_t> relativeIndices;
+    std::vector<ObjIndex> triangles;
+
+    size_t lineCount = 0;
+    size_t errorLine = 0;
+    std::string error;
+};
+
+struct ChunkBase {
+    size_t position = 0;
+    size_t normal = 0;
+    size_t texcoord = 0;
+    size_t index = 0;
+};
+
+enum Attribute : size_t {
+    ATTRIBUTE_VERTEX = 0,
+    ATTRIBUTE_NORMAL = 1,
+    ATTRIBUTE_TEXCOORD = 2,
+};
+
+int32_t& GetAttribute(ObjIndex& index, size_t attribute) {
+    switch (attribute) {
+    case ATTRIBUTE_VERTEX:
+        return index.vertex;
+    case ATTRIBUTE_NORMAL:
+        return index.normal;
+    default:
+        return index.texcoord;
+    }
+}
+
+// Runs func(i) for every i in [0, count), the calling thread takes the first index
+template <typename Func>
+void ParallelFor(size_t count, const Func& func) {
+    if (count == 1) {
+        func(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    for (size_t i = 1; i < count; i++) {
+        workers.emplace_back([&func, i]() { func(i); });
+    }
+    func(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// ****** Tokens ******
+// Lines never contain '\r' or '\n', so tokens only end at spaces, tabs or the end of the line
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool IsDigit(char c) { return static_cast<unsigned int>(c - '0') < 10u; }
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline const char* FindTokenEnd(const char* p, const char* end) {
+    while (p < end && !IsSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline const char* FindIndexEnd(const char* p, const char* end) {
+    while (p < end && !IsSpace(*p) && *p != '/') {
+        p++;
+    }
+    return p;
+}
+
+// Same arithmetic as tinyobj's tryParseDouble, which decides the exact float every coordinate
+// rounds to. It is only faster than strtod because it skips locale handling and correct rounding.
+bool TryParseDouble(const char* s, const char* sEnd, double* result) {
+    if (s >= sEnd) {
+        return false;
+    }
+
+    double mantissa = 0.0;
+    int exponent = 0;
+    char sign = '+';
+    char expSign = '+';
+    const char* curr = s;
+    int read = 0;
+    bool endNotReached = false;
+    bool leadingDecimalDots = false;
+
+    auto assemble = [&]() {
+        *result = (sign == '+' ? 1 : -1) *
+                  (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+        return true;
+    };
+
+    if (*curr == '+' || *curr == '-') {
+        sign = *curr;
+        curr++;
+        if (curr != sEnd && *curr == '.') {
+            leadingDecimalDots = true;
+        }
+    } else if (IsDigit(*curr)) {
+    } else if (*curr == '.') {
+        leadingDecimalDots = true;
+    } else {
+        return false;
+    }
+
+    endNotReached = curr != sEnd;
+    if (!leadingDecimalDots) {
+        while (endNotReached && IsDigit(*curr)) {
+            mantissa *= 10;
+            mantissa += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            endNotReached = curr != sEnd;
+        }
+        if (read == 0) {
+            return false;
+        }
+    }
+
+    if (!endNotReached) {
+        return assemble();
+    }
+
+    if (*curr == '.') {
+        static constexpr double POW_LUT[] = {1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001};
+        static constexpr int LUT_ENTRIES = sizeof(POW_LUT) / sizeof(POW_LUT[0]);
+
+        curr++;
+        read = 1;
+        endNotReached = curr != sEnd;
+        while (endNotReached && IsDigit(*curr)) {
+            mantissa += static_cast<int>(*curr - 0x30) * (read < LUT_ENTRIES ? POW_LUT[read] : std::pow(10.0, -read));
+            read++;
+            curr++;
+            endNotReached = curr != sEnd;
+        }
+    } else if (*curr != 'e' && *curr != 'E') {
+        return assemble();
+    }
+
+    if (!endNotReached) {
+        return assemble();
+    }
+
+    if (*curr == 'e' || *curr == 'E') {
+        curr++;
+        endNotReached = curr != sEnd;
+        if (endNotReached && (*curr == '+' || *curr == '-')) {
+            expSign = *curr;
+            curr++;
+        } else if (!endNotReached || !IsDigit(*curr)) {
+            // empty exponent
+            return false;
+        }
+
+        read = 0;
+        endNotReached = curr != sEnd;
+        while (endNotReached && IsDigit(*curr)) {
+            if (exponent > std::numeric_limits<int>::max() / 10) {
+                return false;
+            }
+            exponent *= 10;
+            exponent += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            endNotReached = curr != sEnd;
+        }
+        exponent *= (expSign == '+' ? 1 : -1);
+        if (read == 0) {
+            return false;
+        }
+    }
+
+    return assemble();
+}
+
+float ParseFloat(const char*& token, const char* end, double defaultValue = 0.0) {
+    token = SkipSpaces(token, end);
+    const char* tokenEnd = FindTokenEnd(token, end);
+    double value = defaultValue;
+    TryParseDouble(token, tokenEnd, &value);
+    token = tokenEnd;
+    return static_cast<float>(value);
+}
+
+bool TryParseFloat(const char*& token, const char* end, float& out) {
+    token = SkipSpaces(token, end);
+    const char* tokenEnd = FindTokenEnd(token, end);
+    double value;
+    bool parsed = TryParseDouble(token, tokenEnd, &value);
+    if (parsed) {
+        out = static_cast<float>(value);
+    }
+    token = tokenEnd;
+    return parsed;
+}
+
+// atoi, without relying on the text being null terminated
+int ParseInt(const char* p, const char* end) {
+    p = SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+    int64_t value = 0;
+    while (p < end && IsDigit(*p)) {
+        value = std::min<int64_t>(value * 10 + (*p - '0'), std::numeric_limits<int32_t>::max());
+        p++;
+    }
+    return static_cast<int>(negative ? -value : value);
+}
+
+// ****** Lines ******
+
+bool ParseIndex(Chunk& chunk, const char*& token, const char* end, size_t count, size_t attribute, ObjIndex& corner) {
+    int index = ParseInt(token, end);
+    token = FindIndexEnd(token, end);
+    if (index > 0) {
+        GetAttribute(corner, attribute) = index - 1;
+        return true;
+    }
+    if (index == 0) {
+        // zero is not allowed by the spec
+        return false;
+    }
+    // relative to the last attribute read so far
+    GetAttribute(corner, attribute) = static_cast<int32_t>(count) + index;
+    chunk.relativeIndices.push_back(chunk.corners.size() * 3 + attribute);
+    return true;
+}
+
+// v, v//vn, v/vt or v/vt/vn
+bool ParseCorner(Chunk& chunk, const char*& token, const char* end, ObjIndex& corner) {
+    if (!ParseIndex(chunk, token, end, chunk.positions.size() / 3, ATTRIBUTE_VERTEX, corner)) {
+        return false;
+    }
+    if (token == end || *token != '/') {
+        return true;
+    }
+    token++;
+
+    if (token < end && *token == '/') {
+        token++;
+        return ParseIndex(chunk, token, end, chunk.normals.size() / 3, ATTRIBUTE_NORMAL, corner);
+    }
+
+    if (!ParseIndex(chunk, token, end, chunk.texcoords.size() / 2, ATTRIBUTE_TEXCOORD, corner)) {
+        return false;
+    }
+    if (token == end || *token != '/') {
+        return true;
+    }
+    token++;
+    return ParseIndex(chunk, token, end, chunk.normals.size() / 3, ATTRIBUTE_NORMAL, corner);
+}
+
+bool ParseLine(Chunk& chunk, const char* begin, const char* end) {
+    const char* token = SkipSpaces(begin, end);
+    if (token == end || token[0] == '#') {
+        return true;
+    }
+    size_t length = end - token;
+
+    if (length >= 2 && token[0] == 'v' && IsSpace(token[1])) {
+        token += 2;
+        chunk.positions.push_back(ParseFloat(token, end));
+        chunk.positions.push_back(ParseFloat(token, end));
+        chunk.positions.push_back(ParseFloat(token, end));
+
+        float r, g, b;
+        bool hasColor = TryParseFloat(token, end, r) && TryParseFloat(token, end, g) && TryParseFloat(token, end, b);
+        if (!hasColor) {
+            r = g = b = 1.0f;
+        }
+        chunk.colors.push_back(r);
+        chunk.colors.push_back(g);
+        chunk.colors.push_back(b);
+        return true;
+    }
+
+    if (length >= 3 && token[0] == 'v' && token[1] == 'n' && IsSpace(token[2])) {
+        token += 3;
+        chunk.normals.push_back(ParseFloat(token, end));
+        chunk.normals.push_back(ParseFloat(token, end));
+        chunk.normals.push_back(ParseFloat(token, end));
+        return true;
+    }
+
+    if (length >= 3 && token[0] == 'v' && token[1] == 't' && IsSpace(token[2])) {
+        token += 3;
+        chunk.texcoords.push_back(ParseFloat(token, end));
+        chunk.texcoords.push_back(ParseFloat(token, end));
+        return true;
+    }
+
+    if (length >= 2 && token[0] == 'f' && IsSpace(token[1])) {
+        token = SkipSpaces(token + 2, end);
+        uint32_t cornerCount = 0;
+        while (token < end) {
+            ObjIndex corner{};
+            if (!ParseCorner(chunk, token, end, corner)) {
+                chunk.error = "zero value for face index";
+                return false;
+            }
+            chunk.corners.push_back(corner);
+            cornerCount++;
+            token = SkipSpaces(token, end);
+        }
+        chunk.faceSizes.push_back(cornerCount);
+        return true;
+    }
+
+    // groups, objects, materials, smoothing groups, lines and points don't affect the geometry
+    return true;
+}
+
+void ParseChunk(Chunk& chunk) {
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        // a lone '\r' ends a line as well, "\r\n" just yields an empty line
+        const char* lineEnd = p;
+        while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r') {
+            lineEnd++;
+        }
+        if (!ParseLine(chunk, p, lineEnd)) {
+            chunk.errorLine = chunk.lineCount + 1;
+            return;
+        }
+        if (lineEnd < chunk.end && *lineEnd == '\n') {
+            chunk.lineCount++;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Moves relative indices to absolute ones and checks that every index is in range
+bool ResolveIndices(Chunk& chunk, const ChunkBase& base, const ObjMesh& mesh) {
+    const size_t bases[3] = {base.position, base.normal, base.texcoord};
+    for (size_t relative : chunk.relativeIndices) {
+        int32_t& index = GetAttribute(chunk.corners[relative / 3], relative % 3);
+        index += static_cast<int32_t>(bases[relative % 3]);
+        if (index < 0) {
+            chunk.error = "relative face index points before the first attribute";
+            return false;
+        }
+    }
+
+    const int64_t positionCount = static_cast<int64_t>(mesh.positions.size() / 3);
+    const int64_t normalCount = static_cast<int64_t>(mesh.normals.size() / 3);
+    const int64_t texcoordCount = static_cast<int64_t>(mesh.texcoords.size() / 2);
+    for (const auto& corner : chunk.corners) {
+        if (corner.vertex >= positionCount || corner.normal >= normalCount || corner.texcoord >= texcoordCount) {
+            chunk.error = "face index out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ****** Triangulation ******
+// Mirrors tinyobj: quads are split along their shorter diagonal, larger polygons are ear clipped
+// in the plane of their dominant axes
+
+// from: https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
+bool IsPointInTriangle(const float* vertx, const float* verty, float testx, float testy) {
+    bool inside = false;
+    for (int i = 0, j = 2; i < 3; j = i++) {
+        if (((verty[i] > testy) != (verty[j] > testy)) &&
+            (testx < (vertx[j] - vertx[i]) * (testy - verty[i]) / (verty[j] - verty[i]) + vertx[i])) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+void TriangulateQuad(const ObjIndex* face, const std::vector<float>& v, std::vector<ObjIndex>& out) {
+    const float* p0 = &v[face[0].vertex * 3];
+    const float* p1 = &v[face[1].vertex * 3];
+    const float* p2 = &v[face[2].vertex * 3];
+    const float* p3 = &v[face[3].vertex * 3];
+
+    float e02x = p2[0] - p0[0];
+    float e02y = p2[1] - p0[1];
+    float e02z = p2[2] - p0[2];
+    float e13x = p3[0] - p1[0];
+    float e13y = p3[1] - p1[1];
+    float e13z = p3[2] - p1[2];
+    float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+    float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+    if (sqr02 < sqr13) {
+        out.insert(out.end(), {face[0], face[1], face[2], face[0], face[2], face[3]});
+    } else {
+        out.insert(out.end(), {face[0], face[1], face[3], face[1], face[2], face[3]});
+    }
+}
+
+void TriangulatePolygon(
+    const ObjIndex* face,
+    size_t count,
+    const std::vector<float>& v,
+    std::vector<ObjIndex>& remaining,
+    std::vector<ObjIndex>& out) {
+    // find the two axes to work in
+    size_t axes[2] = {1, 2};
+    for (size_t k = 0; k < count; k++) {
+        const float* p0 = &v[face[k % count].vertex * 3];
+        const float* p1 = &v[face[(k + 1) % count].vertex * 3];
+        const float* p2 = &v[face[(k + 2) % count].vertex * 3];
+        float e0x = p1[0] - p0[0];
+        float e0y = p1[1] - p0[1];
+        float e0z = p1[2] - p0[2];
+        float e1x = p2[0] - p1[0];
+        float e1y = p2[1] - p1[1];
+        float e1z = p2[2] - p1[2];
+        float cx = std::fabs(e0y * e1z - e0z * e1y);
+        float cy = std::fabs(e0z * e1x - e0x * e1z);
+        float cz = std::fabs(e0x * e1y - e0y * e1x);
+        const float epsilon = std::numeric_limits<float>::epsilon();
+        if (cx > epsilon || cy > epsilon || cz > epsilon) {
+            // found a corner
+            if (!(cx > cy && cx > cz)) {
+                axes[0] = 0;
+                if (cz > cx && cz > cy) {
+                    axes[1] = 1;
+                }
+            }
+            break;
+        }
+    }
+
+    float area = 0;
+    for (size_t k = 0; k < count; k++) {
+        const float* p0 = &v[face[k % count].vertex * 3];
+        const float* p1 = &v[face[(k + 1) % count].vertex * 3];
+        area += (p0[axes[0]] * p1[axes[1]] - p0[axes[1]] * p1[axes[0]]) * 0.5f;
+    }
+
+    remaining.assign(face, face + count);
+    size_t guess = 0;
+    // how many iterations can we do without removing a vertex
+    size_t remainingIterations = count;
+    size_t previousRemaining = count;
+    while (remaining.size() > 3 && remainingIterations > 0) {
+        size_t polys = remaining.size();
+        if (guess >= polys) {
+            guess -= polys;
+        }
+        if (previousRemaining != polys) {
+            previousRemaining = polys;
+            remainingIterations = polys;
+        } else {
+            remainingIterations--;
+        }
+
+        ObjIndex ind[3];
+        float vx[3];
+        float vy[3];
+        for (size_t k = 0; k < 3; k++) {
+            ind[k] = remaining[(guess + k) % polys];
+            vx[k] = v[ind[k].vertex * 3 + axes[0]];
+            vy[k] = v[ind[k].vertex * 3 + axes[1]];
+        }
+        float e0x = vx[1] - vx[0];
+        float e0y = vy[1] - vy[0];
+        float e1x = vx[2] - vx[1];
+        float e1y = vy[2] - vy[1];
+        float cross = e0x * e1y - e0y * e1x;
+        // an internal angle
+        if (cross * area < 0.0f) {
+            guess++;
+            continue;
+        }
+
+        // no other vertex may lie inside the ear
+        bool overlap = false;
+        for (size_t other = 3; other < polys; other++) {
+            const float* p = &v[remaining[(guess + other) % polys].vertex * 3];
+            if (IsPointInTriangle(vx, vy, p[axes[0]], p[axes[1]])) {
+                overlap = true;
+                break;
+            }
+        }
+        if (overlap) {
+            guess++;
+            continue;
+        }
+
+        out.insert(out.end(), {ind[0], ind[1], ind[2]});
+        remaining.erase(remaining.begin() + static_cast<ptrdiff_t>((guess + 1) % polys));
+    }
+
+    if (remaining.size() == 3) {
+        out.insert(out.end(), remaining.begin(), remaining.end());
+    }
+}
+
+void TriangulateChunk(Chunk& chunk, const std::vector<float>& positions) {
+    std::vector<ObjIndex> remaining;
+    chunk.triangles.reserve(chunk.corners.size());
+    const ObjIndex* face = chunk.corners.data();
+    for (uint32_t count : chunk.faceSizes) {
+        if (count == 3) {
+            chunk.triangles.insert(chunk.triangles.end(), face, face + 3);
+        } else if (count == 4) {
+            TriangulateQuad(face, positions, chunk.triangles);
+        } else if (count > 4) {
+            TriangulatePolygon(face, count, positions, remaining, chunk.triangles);
+        }
+        // faces with less than three corners are skipped
+        face += count;
+    }
+    chunk.corners = {};
+    chunk.faceSizes = {};
+}
+
+template <typename T>
+void MoveInto(std::vector<T>& source, std::vector<T>& destination, size_t offset) {
+    std::copy(source.begin(), source.end(), destination.begin() + static_cast<ptrdiff_t>(offset));
+    source = {};
+}
+
+void ThrowChunkError(const std::vector<Chunk>& chunks, const std::string& name) {
+    size_t line = 0;
+    for (const auto& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            if (chunk.errorLine != 0) {
+                IO::ThrowError("Failed to parse {} at line {}: {}", name, line + chunk.errorLine, chunk.error);
+            }
+            IO::ThrowError("Failed to parse {}: {}", name, chunk.error);
+        }
+        line += chunk.lineCount;
+    }
+}
+
+bool HasError(const std::vector<Chunk>& chunks) {
+    return std::any_of(chunks.begin(), chunks.end(), [](const Chunk& chunk) { return !chunk.error.empty(); });
+}
+} // namespace
+
+ObjMesh IdaObjLoader::Load(const std::string& path, uint32_t threadCount) {
+    IdaMappedFile file(path);
+    return Parse(file.GetData(), file.GetSize(), threadCount, path);
+}
+
+ObjMesh IdaObjLoader::Parse(const char* data, size_t size, uint32_t threadCount, const std::string& name) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunkCount = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, threadCount);
+
+    // split into chunks that start right after a line break
+    std::vector<Chunk> chunks(chunkCount);
+    const char* end = data + size;
+    const char* begin = data;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* split = end;
+        if (i + 1 < chunkCount) {
+            split = std::max(begin, data + size / chunkCount * (i + 1));
+            split = std::find(split, end, '\n');
+            if (split != end) {
+                split++;
+            }
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = split;
+        begin = split;
+    }
+
+    ParallelFor(chunkCount, [&](size_t i) { ParseChunk(chunks[i]); });
+    if (HasError(chunks)) {
+        ThrowChunkError(chunks, name);
+    }
+
+    // attribute offsets of every chunk
+    ObjMesh mesh;
+    std::vector<ChunkBase> bases(chunkCount);
+    ChunkBase total;
+    for (size_t i = 0; i < chunkCount; i++) {
+        bases[i] = total;
+        total.position += chunks[i].positions.size() / 3;
+        total.normal += chunks[i].normals.size() / 3;
+        total.texcoord += chunks[i].texcoords.size() / 2;
+    }
+    mesh.positions.resize(total.position * 3);
+    mesh.colors.resize(total.position * 3);
+    mesh.normals.resize(total.normal * 3);
+    mesh.texcoords.resize(total.texcoord * 2);
+
+    ParallelFor(chunkCount, [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        MoveInto(chunk.positions, mesh.positions, bases[i].position * 3);
+        MoveInto(chunk.colors, mesh.colors, bases[i].position * 3);
+        MoveInto(chunk.normals, mesh.normals, bases[i].normal * 3);
+        MoveInto(chunk.texcoords, mesh.texcoords, bases[i].texcoord * 2);
+    });
+
+    // splitting polygons needs the positions of every chunk, faces may reference any earlier vertex
+    ParallelFor(chunkCount, [&](size_t i) {
+        if (ResolveIndices(chunks[i], bases[i], mesh)) {
+            TriangulateChunk(chunks[i], mesh.positions);
+        }
+    });
+    if (HasError(chunks)) {
+        ThrowChunkError(chunks, name);
+    }
+
+    for (size_t i = 0; i < chunkCount; i++) {
+        bases[i].index = total.index;
+        total.index += chunks[i].triangles.size();
+    }
+    mesh.indices.resize(total.index);
+    ParallelFor(chunkCount, [&](size_t i) { MoveInto(chunks[i].triangles, mesh.indices, bases[i].index); });
+
+    return mesh;
+}
+} // namespace ida
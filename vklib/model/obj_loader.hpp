@@ -0,0 +1,48 @@
+#ifndef VULKAN_LIB_OBJ_LOADER_HPP
+#define VULKAN_LIB_OBJ_LOADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ida {
+// Zero based attribute indices of one triangle corner, -1 when the face does not reference the attribute
+struct ObjIndex {
+    int32_t vertex = -1;
+    int32_t normal = -1;
+    int32_t texcoord = -1;
+};
+
+struct ObjMesh {
+    std::vector<float> positions; // xyz
+    std::vector<float> colors;    // rgb per position, white when the `v` line has no color
+    std::vector<float> normals;   // xyz
+    std::vector<float> texcoords; // uv
+    std::vector<ObjIndex> indices; // three per triangle, in file order
+
+    size_t GetPositionCount() const { return positions.size() / 3; }
+    size_t GetTriangleCount() const { return indices.size() / 3; }
+};
+
+/**
+ * Wavefront OBJ parser for v/vn/vt/f geometry.
+ *
+ * The file is memory mapped and split into line aligned chunks that are parsed on worker threads.
+ * The chunks are merged in file order, relative (negative) face indices are resolved against the
+ * attribute counts of all preceding chunks, and polygons are triangulated the same way tinyobj does,
+ * so the result is identical to tinyobj::LoadObj for the same file. Materials, groups, lines and
+ * points are ignored.
+ */
+class IdaObjLoader final {
+  public:
+    // chunks smaller than this are not worth a thread
+    static constexpr size_t MIN_CHUNK_SIZE = 1024 * 1024;
+
+    // threadCount 0 uses every hardware thread
+    static ObjMesh Load(const std::string& path, uint32_t threadCount = 0);
+    static ObjMesh Parse(const char* data, size_t size, uint32_t threadCount = 0, const std::string& name = "<memory>");
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_OBJ_LOADER_HPP
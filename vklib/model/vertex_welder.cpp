@@ -0,0 +1,180 @@
+#include "vertex_welder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace ida {
+namespace {
+static_assert(sizeof(IdaModel::Vertex) == 11 * sizeof(float), "Vertex is hashed as 11 tightly packed floats");
+
+inline uint64_t MixHash(uint64_t hash, uint64_t value) {
+    hash ^= value;
+    hash *= 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+// murmur3 finalizer, spreads the bits before the hash is cut to the table size
+inline uint32_t FinalizeHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return static_cast<uint32_t>(hash);
+}
+
+// Bits of a float with -0 folded onto +0, the two compare equal and have to hash alike
+inline uint32_t CanonicalBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits << 1) == 0 ? 0 : bits;
+}
+
+inline uint64_t PackBits(float low, float high) {
+    return static_cast<uint64_t>(CanonicalBits(low)) | (static_cast<uint64_t>(CanonicalBits(high)) << 32);
+}
+
+inline bool IsWithin(const float* a, const float* b, uint32_t count, float epsilon) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (!(std::fabs(a[i] - b[i]) <= epsilon)) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+IdaVertexWelder::IdaVertexWelder(size_t expectedVertexCount, const WeldOptions& options)
+    : options_(options), cellSize_(2.0f * options.positionEpsilon) {
+    // keep the load factor below 3/4 without growing
+    size_t capacity = std::bit_ceil(std::max<size_t>(16, expectedVertexCount * 4 / 3 + 1));
+    slots_.assign(capacity, Slot{0, EMPTY_SLOT});
+    mask_ = capacity - 1;
+    vertices_.reserve(expectedVertexCount);
+}
+
+uint32_t IdaVertexWelder::Insert(const Vertex& vertex) {
+    if ((vertices_.size() + 1) * 4 > slots_.size() * 3) {
+        Grow();
+    }
+    return options_.IsExact() ? InsertExact(vertex) : InsertWelded(vertex);
+}
+
+uint32_t IdaVertexWelder::InsertExact(const Vertex& vertex) {
+    const float* f = &vertex.position.x;
+    uint64_t hash = 0;
+    hash = MixHash(hash, PackBits(f[0], f[1]));
+    hash = MixHash(hash, PackBits(f[2], f[3]));
+    hash = MixHash(hash, PackBits(f[4], f[5]));
+    hash = MixHash(hash, PackBits(f[6], f[7]));
+    hash = MixHash(hash, PackBits(f[8], f[9]));
+    hash = MixHash(hash, CanonicalBits(f[10]));
+    uint32_t finalHash = FinalizeHash(hash);
+
+    size_t slot = Find(finalHash, [&vertex](const Vertex& other) { return other == vertex; });
+    if (slots_[slot].index != EMPTY_SLOT) {
+        return slots_[slot].index;
+    }
+    return Append(slot, finalHash, vertex);
+}
+
+uint32_t IdaVertexWelder::InsertWelded(const Vertex& vertex) {
+    // the cell of the position, and towards which neighbour on every axis a match could lie
+    int64_t cell[3];
+    int64_t direction[3] = {0, 0, 0};
+    uint32_t cornerCount = 1;
+    if (cellSize_ > 0.0f) {
+        for (int axis = 0; axis < 3; axis++) {
+            double scaled = static_cast<double>(vertex.position[axis]) / cellSize_;
+            if (!std::isfinite(scaled) || std::fabs(scaled) > 1e18) {
+                // can't be placed on the grid, never welded
+                size_t slot = Find(0, [](const Vertex&) { return false; });
+                return Append(slot, 0, vertex);
+            }
+            double base = std::floor(scaled);
+            cell[axis] = static_cast<int64_t>(base);
+            direction[axis] = scaled - base < 0.5 ? -1 : 1;
+        }
+        cornerCount = 8;
+    } else {
+        // only normals are welded, positions still have to match exactly
+        for (int axis = 0; axis < 3; axis++) {
+            cell[axis] = CanonicalBits(vertex.position[axis]);
+        }
+    }
+
+    uint32_t ownHash = HashCell(vertex, cell);
+    auto match = [this, &vertex](const Vertex& other) { return IsWithinTolerance(vertex, other); };
+    size_t ownSlot = Find(ownHash, match);
+    if (slots_[ownSlot].index != EMPTY_SLOT) {
+        return slots_[ownSlot].index;
+    }
+    for (uint32_t corner = 1; corner < cornerCount; corner++) {
+        const int64_t neighbour[3] = {
+            cell[0] + ((corner & 1) ? direction[0] : 0),
+            cell[1] + ((corner & 2) ? direction[1] : 0),
+            cell[2] + ((corner & 4) ? direction[2] : 0),
+        };
+        size_t slot = Find(HashCell(vertex, neighbour), match);
+        if (slots_[slot].index != EMPTY_SLOT) {
+            return slots_[slot].index;
+        }
+    }
+    return Append(ownSlot, ownHash, vertex);
+}
+
+template <typename Match>
+size_t IdaVertexWelder::Find(uint32_t hash, const Match& match) const {
+    size_t slot = hash & mask_;
+    while (slots_[slot].index != EMPTY_SLOT) {
+        if (slots_[slot].hash == hash && match(vertices_[slots_[slot].index])) {
+            return slot;
+        }
+        slot = (slot + 1) & mask_;
+    }
+    return slot;
+}
+
+uint32_t IdaVertexWelder::Append(size_t slot, uint32_t hash, const Vertex& vertex) {
+    uint32_t index = static_cast<uint32_t>(vertices_.size());
+    slots_[slot] = {hash, index};
+    vertices_.push_back(vertex);
+    return index;
+}
+
+void IdaVertexWelder::Grow() {
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(old.size() * 2, Slot{0, EMPTY_SLOT});
+    mask_ = slots_.size() - 1;
+    for (const auto& entry : old) {
+        if (entry.index == EMPTY_SLOT) {
+            continue;
+        }
+        size_t slot = entry.hash & mask_;
+        while (slots_[slot].index != EMPTY_SLOT) {
+            slot = (slot + 1) & mask_;
+        }
+        slots_[slot] = entry;
+    }
+}
+
+uint32_t IdaVertexWelder::HashCell(const Vertex& vertex, const int64_t cell[3]) const {
+    // normals are left out, they are only compared with the tolerance
+    uint64_t hash = 0;
+    hash = MixHash(hash, static_cast<uint64_t>(cell[0]));
+    hash = MixHash(hash, static_cast<uint64_t>(cell[1]));
+    hash = MixHash(hash, static_cast<uint64_t>(cell[2]));
+    hash = MixHash(hash, PackBits(vertex.color.r, vertex.color.g));
+    hash = MixHash(hash, PackBits(vertex.color.b, vertex.uv.x));
+    hash = MixHash(hash, CanonicalBits(vertex.uv.y));
+    return FinalizeHash(hash);
+}
+
+bool IdaVertexWelder::IsWithinTolerance(const Vertex& a, const Vertex& b) const {
+    return a.color == b.color && a.uv == b.uv &&
+           IsWithin(&a.position.x, &b.position.x, 3, options_.positionEpsilon) &&
+           IsWithin(&a.normal.x, &b.normal.x, 3, options_.normalEpsilon);
+}
+} // namespace ida
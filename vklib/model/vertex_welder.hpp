@@ -0,0 +1,58 @@
+#ifndef VULKAN_LIB_VERTEX_WELDER_HPP
+#define VULKAN_LIB_VERTEX_WELDER_HPP
+
+#include "model/model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ida {
+/**
+ * Deduplicates vertices with a flat, open addressing (linear probing) hash table.
+ *
+ * Slots only hold a 32-bit hash and the vertex index, so the table stays compact and is sized
+ * once from the expected vertex count. In exact mode the whole 44-byte vertex is hashed in one
+ * pass, with -0 and +0 hashed alike since they compare equal. In epsilon mode positions are
+ * hashed by a grid cell twice the epsilon wide, so a match can only lie in the 8 cells around a
+ * position, and candidates are compared with the tolerances. The first vertex inserted is kept
+ * as the welded value.
+ */
+class IdaVertexWelder final {
+  public:
+    using Vertex = IdaModel::Vertex;
+
+    explicit IdaVertexWelder(size_t expectedVertexCount, const WeldOptions& options = {});
+
+    // Index of the vertex, appended to the vertices if it does not match any previous one
+    uint32_t Insert(const Vertex& vertex);
+
+    const std::vector<Vertex>& GetVertices() const { return vertices_; }
+    std::vector<Vertex>& GetVertices() { return vertices_; }
+
+  private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t index; // EMPTY_SLOT if unused
+    };
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    uint32_t InsertExact(const Vertex& vertex);
+    uint32_t InsertWelded(const Vertex& vertex);
+    // Slot of a vertex with this hash matching the predicate, or the empty slot ending the probe
+    template <typename Match>
+    size_t Find(uint32_t hash, const Match& match) const;
+    uint32_t Append(size_t slot, uint32_t hash, const Vertex& vertex);
+    void Grow();
+
+    uint32_t HashCell(const Vertex& vertex, const int64_t cell[3]) const;
+    bool IsWithinTolerance(const Vertex& a, const Vertex& b) const;
+
+    WeldOptions options_;
+    float cellSize_ = 0.0f;
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    std::vector<Vertex> vertices_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_VERTEX_WELDER_HPP
@@ -0,0 +1,177 @@
+#include "frustum_culler.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IDA_CULL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC emits the AVX intrinsics as they are, whatever /arch says
+#define IDA_TARGET_AVX
+#else
+#define IDA_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace ida {
+namespace {
+#ifdef IDA_CULL_X86
+bool SupportsAvx() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    // AVX and OSXSAVE, then the OS must save the ymm registers on context switches
+    bool cpu = (info[2] & (1 << 28)) && (info[2] & (1 << 27));
+    return cpu && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+} // namespace
+
+IdaFrustumCuller::IdaFrustumCuller() : path_(GetBestPath()) {}
+
+IdaFrustumCuller::Path IdaFrustumCuller::GetBestPath() {
+#ifdef IDA_CULL_X86
+    static const Path best = SupportsAvx() ? Path::Avx : Path::Sse;
+    return best;
+#else
+    return Path::Scalar;
+#endif
+}
+
+void IdaFrustumCuller::SetPath(Path path) {
+    path_ = std::min(path, GetBestPath());
+}
+
+void IdaFrustumCuller::Clear() {
+    count_ = 0;
+    visibleCount_ = 0;
+    centerX_.clear();
+    centerY_.clear();
+    centerZ_.clear();
+    extentX_.clear();
+    extentY_.clear();
+    extentZ_.clear();
+    radius_.clear();
+}
+
+uint32_t IdaFrustumCuller::Add(const glm::mat4& transform, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float radius) {
+    glm::vec3 center = glm::vec3(transform * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    // the box around the transformed box (Arvo), its half extents are |M| * e
+    glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+    glm::mat3 axes = glm::mat3(transform);
+    glm::vec3 worldExtent = glm::abs(axes[0]) * extent.x + glm::abs(axes[1]) * extent.y + glm::abs(axes[2]) * extent.z;
+    float scale = std::max({glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2])});
+
+    centerX_.push_back(center.x);
+    centerY_.push_back(center.y);
+    centerZ_.push_back(center.z);
+    extentX_.push_back(worldExtent.x);
+    extentY_.push_back(worldExtent.y);
+    extentZ_.push_back(worldExtent.z);
+    radius_.push_back(radius * scale);
+    return count_++;
+}
+
+void IdaFrustumCuller::Cull(const std::array<glm::vec4, 6>& planes) {
+    size_t padded = (count_ + LANES - 1) / LANES * LANES;
+    for (auto* values : {&centerX_, &centerY_, &centerZ_, &extentX_, &extentY_, &extentZ_, &radius_}) {
+        values->resize(padded, 0.0f);
+    }
+    visible_.assign(padded, 0);
+
+    switch (path_) {
+    case Path::Avx:
+        CullAvx(planes);
+        break;
+    case Path::Sse:
+        CullSse(planes);
+        break;
+    case Path::Scalar:
+        CullScalar(planes);
+        break;
+    }
+    visibleCount_ = static_cast<uint32_t>(std::count(visible_.begin(), visible_.begin() + count_, 1));
+}
+
+// An object is outside once its center lies further behind a plane than the projected box, or the
+// sphere, reaches: dot(n, c) + d < -min(dot(|n|, e), r)
+void IdaFrustumCuller::CullScalar(const std::array<glm::vec4, 6>& planes) {
+    for (uint32_t i = 0; i < count_; i++) {
+        bool visible = true;
+        for (const glm::vec4& plane : planes) {
+            float distance = plane.x * centerX_[i] + plane.y * centerY_[i] + plane.z * centerZ_[i] + plane.w;
+            float reach = std::abs(plane.x) * extentX_[i] + std::abs(plane.y) * extentY_[i] + std::abs(plane.z) * extentZ_[i];
+            visible = visible && distance + std::min(reach, radius_[i]) >= 0.0f;
+        }
+        visible_[i] = visible ? 1 : 0;
+    }
+}
+
+#ifdef IDA_CULL_X86
+void IdaFrustumCuller::CullSse(const std::array<glm::vec4, 6>& planes) {
+    for (uint32_t i = 0; i < count_; i += 4) {
+        __m128 cx = _mm_loadu_ps(&centerX_[i]);
+        __m128 cy = _mm_loadu_ps(&centerY_[i]);
+        __m128 cz = _mm_loadu_ps(&centerZ_[i]);
+        __m128 ex = _mm_loadu_ps(&extentX_[i]);
+        __m128 ey = _mm_loadu_ps(&extentY_[i]);
+        __m128 ez = _mm_loadu_ps(&extentZ_[i]);
+        __m128 radius = _mm_loadu_ps(&radius_[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4& plane : planes) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+            __m128 reach = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+                _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+            __m128 test = _mm_cmpge_ps(_mm_add_ps(distance, _mm_min_ps(reach, radius)), _mm_setzero_ps());
+            inside = _mm_and_ps(inside, test);
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            visible_[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+}
+
+IDA_TARGET_AVX void IdaFrustumCuller::CullAvx(const std::array<glm::vec4, 6>& planes) {
+    for (uint32_t i = 0; i < count_; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&centerX_[i]);
+        __m256 cy = _mm256_loadu_ps(&centerY_[i]);
+        __m256 cz = _mm256_loadu_ps(&centerZ_[i]);
+        __m256 ex = _mm256_loadu_ps(&extentX_[i]);
+        __m256 ey = _mm256_loadu_ps(&extentY_[i]);
+        __m256 ez = _mm256_loadu_ps(&extentZ_[i]);
+        __m256 radius = _mm256_loadu_ps(&radius_[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& plane : planes) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+            __m256 reach = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex), _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), ez));
+            __m256 test = _mm256_cmp_ps(_mm256_add_ps(distance, _mm256_min_ps(reach, radius)), _mm256_setzero_ps(), _CMP_GE_OQ);
+            inside = _mm256_and_ps(inside, test);
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (uint32_t lane = 0; lane < 8; lane++) {
+            visible_[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+}
+#else
+void IdaFrustumCuller::CullSse(const std::array<glm::vec4, 6>& planes) {
+    CullScalar(planes);
+}
+
+void IdaFrustumCuller::CullAvx(const std::array<glm::vec4, 6>& planes) {
+    CullScalar(planes);
+}
+#endif
+} // namespace ida
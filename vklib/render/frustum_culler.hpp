@@ -0,0 +1,67 @@
+#ifndef VULKAN_LIB_FRUSTUM_CULLER_HPP
+#define VULKAN_LIB_FRUSTUM_CULLER_HPP
+
+#include "glm/glm.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ida {
+/**
+ * Tests batches of bounding volumes against the six planes of a view frustum.
+ *
+ * Objects are added with their model space bounds and transform, and stored as world space boxes
+ * and spheres in structure of arrays form, so Cull() tests 8 objects per iteration with AVX, 4 with
+ * SSE or one at a time in the scalar fallback, picked once from what the CPU supports. Per plane the
+ * tighter of the box and the sphere decides, both are conservative, so nothing visible is culled.
+ */
+class IdaFrustumCuller final {
+  public:
+    enum class Path {
+        Scalar,
+        Sse,
+        Avx,
+    };
+
+    IdaFrustumCuller();
+
+    void Clear();
+    // Returns the index to query with IsVisible() after Cull()
+    uint32_t Add(const glm::mat4& transform, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float radius);
+    // planes as returned by IdaCamera::GetFrustumPlanes(), pointing inwards and normalized
+    void Cull(const std::array<glm::vec4, 6>& planes);
+
+    bool IsVisible(uint32_t index) const { return visible_[index] != 0; }
+    uint32_t GetCount() const { return count_; }
+    uint32_t GetVisibleCount() const { return visibleCount_; }
+    uint32_t GetCulledCount() const { return count_ - visibleCount_; }
+
+    Path GetPath() const { return path_; }
+    // Falls back to the best supported path, e.g. to compare the paths' results
+    void SetPath(Path path);
+    static Path GetBestPath();
+
+  private:
+    void CullScalar(const std::array<glm::vec4, 6>& planes);
+    void CullSse(const std::array<glm::vec4, 6>& planes);
+    void CullAvx(const std::array<glm::vec4, 6>& planes);
+
+    static constexpr uint32_t LANES = 8;
+
+    Path path_ = Path::Scalar;
+    uint32_t count_ = 0;
+    uint32_t visibleCount_ = 0;
+    // padded to a multiple of LANES on Cull(), so the SIMD loops never need a tail
+    std::vector<float> centerX_;
+    std::vector<float> centerY_;
+    std::vector<float> centerZ_;
+    std::vector<float> extentX_;
+    std::vector<float> extentY_;
+    std::vector<float> extentZ_;
+    std::vector<float> radius_;
+    std::vector<uint8_t> visible_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_FRUSTUM_CULLER_HPP
@@ -16,10 +16,12 @@ IdaPipeline::IdaPipeline(const std::vector<char>& vertCode, const std::vector<ch
 }
 
 IdaPipeline::~IdaPipeline() {
-    auto& device = Context::GetInstance().device;
-    device.destroyShaderModule(vertShaderModule_);
-    device.destroyShaderModule(fragShaderModule_);
-    device.destroyPipeline(pipeline_);
+    Context::GetInstance().deletionQueue->Push([vert = vertShaderModule_, frag = fragShaderModule_, pipeline = pipeline_]() {
+        auto& device = Context::GetInstance().device;
+        device.destroyShaderModule(vert);
+        device.destroyShaderModule(frag);
+        device.destroyPipeline(pipeline);
+    });
 }
 
 void IdaPipeline::Bind(vk::CommandBuffer commandBuffer) {
@@ -108,7 +110,7 @@ void IdaPipeline::CreateGraphicsPipeline(const std::vector<char>& vertCode, cons
     CreateShaderModule(fragCode, &fragShaderModule_);
 
     vk::PipelineShaderStageCreateInfo shaderStages[2];
-    shaderStages[0].stage = vk::ShaderStageFlagBits::eVertex;
+    shaderStages[0].stage = configInfo.firstStage;
     shaderStages[0].module = vertShaderModule_;
     shaderStages[0].pName = "main";
     shaderStages[0].flags = vk::PipelineShaderStageCreateFlags();
@@ -133,8 +135,10 @@ void IdaPipeline::CreateGraphicsPipeline(const std::vector<char>& vertCode, cons
     vk::GraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+    // mesh shaders assemble their own primitives
+    bool meshShading = configInfo.firstStage == vk::ShaderStageFlagBits::eMeshEXT;
+    pipelineInfo.pVertexInputState = meshShading ? nullptr : &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = meshShading ? nullptr : &configInfo.inputAssemblyInfo;
     pipelineInfo.pViewportState = &configInfo.viewportInfo;
     pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
     pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
@@ -164,4 +168,45 @@ void IdaPipeline::CreateShaderModule(const std::vector<char>& code, vk::ShaderMo
     device.createShaderModule(&createInfo, nullptr, shaderModule);
 }
 
+// ******************************* IdaComputePipeline *******************************
+IdaComputePipeline::IdaComputePipeline(const std::string& compPath, vk::PipelineLayout pipelineLayout) {
+    CreateComputePipeline(ReadWholeFile(compPath), pipelineLayout);
+}
+
+IdaComputePipeline::IdaComputePipeline(const std::vector<char>& compCode, vk::PipelineLayout pipelineLayout) {
+    CreateComputePipeline(compCode, pipelineLayout);
+}
+
+IdaComputePipeline::~IdaComputePipeline() {
+    Context::GetInstance().deletionQueue->Push([comp = compShaderModule_, pipeline = pipeline_]() {
+        auto& device = Context::GetInstance().device;
+        device.destroyShaderModule(comp);
+        device.destroyPipeline(pipeline);
+    });
+}
+
+void IdaComputePipeline::Bind(vk::CommandBuffer commandBuffer) {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_);
+}
+
+void IdaComputePipeline::CreateComputePipeline(const std::vector<char>& compCode, vk::PipelineLayout pipelineLayout) {
+    auto& device = Context::GetInstance().device;
+    auto moduleInfo = vk::ShaderModuleCreateInfo()
+                          .setCodeSize(compCode.size())
+                          .setPCode(reinterpret_cast<const uint32_t*>(compCode.data()));
+    compShaderModule_ = device.createShaderModule(moduleInfo);
+
+    auto pipelineInfo = vk::ComputePipelineCreateInfo()
+                            .setStage(vk::PipelineShaderStageCreateInfo()
+                                          .setStage(vk::ShaderStageFlagBits::eCompute)
+                                          .setModule(compShaderModule_)
+                                          .setPName("main"))
+                            .setLayout(pipelineLayout);
+    auto result = device.createComputePipeline(VK_NULL_HANDLE, pipelineInfo);
+    if (result.result != vk::Result::eSuccess) {
+        IO::ThrowError("Failed to create compute pipeline!");
+    }
+    pipeline_ = result.value;
+}
+
 } // namespace ida
@@ -24,6 +24,8 @@ struct PipelineConfigInfo {
     vk::PipelineLayout pipelineLayout = nullptr;
     vk::RenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    // stage of the first shader, eMeshEXT pipelines have no vertex input or input assembly state
+    vk::ShaderStageFlagBits firstStage = vk::ShaderStageFlagBits::eVertex;
 };
 
 class IdaPipeline {
@@ -52,5 +54,23 @@ class IdaPipeline {
     vk::ShaderModule fragShaderModule_;
 };
 
+class IdaComputePipeline {
+  public:
+    IdaComputePipeline(const std::string& compPath, vk::PipelineLayout pipelineLayout);
+    IdaComputePipeline(const std::vector<char>& compCode, vk::PipelineLayout pipelineLayout);
+
+    ~IdaComputePipeline();
+    IdaComputePipeline(const IdaComputePipeline&) = delete;
+    IdaComputePipeline& operator=(const IdaComputePipeline&) = delete;
+
+    void Bind(vk::CommandBuffer commandBuffer);
+
+  private:
+    void CreateComputePipeline(const std::vector<char>& compCode, vk::PipelineLayout pipelineLayout);
+
+    vk::Pipeline pipeline_;
+    vk::ShaderModule compShaderModule_;
+};
+
 } // namespace ida
 #endif // VULKAN_LIB_PIPELINE_HPP
@@ -0,0 +1,127 @@
+#include "render_queue.hpp"
+#include "model/model.hpp"
+#include "render/pipeline.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace ida {
+namespace {
+// 11-bit digits sort 64-bit keys in 6 passes, with histograms that still fit the L1 cache
+constexpr uint32_t RADIX_BITS = 11;
+constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+constexpr uint32_t RADIX_MASK = RADIX_SIZE - 1;
+constexpr uint32_t RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+constexpr uint64_t Mask(uint32_t bits) {
+    return (uint64_t{1} << bits) - 1;
+}
+
+// Non-negative floats order like their bit patterns, the top DEPTH_BITS keep the exponent and
+// the leading mantissa bits, i.e. a constant relative precision at every distance
+uint64_t QuantizeDepth(float depth) {
+    depth = std::max(depth, 0.0f);
+    return std::bit_cast<uint32_t>(depth) >> (31 - IdaRenderQueue::DEPTH_BITS);
+}
+} // namespace
+
+IdaRenderQueue::IdaRenderQueue() {
+    sortOrders_.fill(SortOrder::FrontToBack);
+    sortOrders_[static_cast<uint32_t>(DrawPass::Transparent)] = SortOrder::BackToFront;
+}
+
+uint64_t IdaRenderQueue::MakeKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) const {
+    uint64_t state = (uint64_t{pipeline} & Mask(PIPELINE_BITS)) << (MATERIAL_BITS + MESH_BITS) |
+                     (uint64_t{material} & Mask(MATERIAL_BITS)) << MESH_BITS |
+                     (uint64_t{mesh} & Mask(MESH_BITS));
+    uint64_t depthBits = QuantizeDepth(depth);
+    uint64_t key = (static_cast<uint64_t>(pass) & Mask(PASS_BITS)) << (64 - PASS_BITS);
+    if (GetSortOrder(pass) == SortOrder::BackToFront) {
+        constexpr uint32_t stateBits = PIPELINE_BITS + MATERIAL_BITS + MESH_BITS;
+        return key | (Mask(DEPTH_BITS) - depthBits) << stateBits | state;
+    }
+    return key | state << DEPTH_BITS | depthBits;
+}
+
+void IdaRenderQueue::Clear() {
+    packets_.clear();
+}
+
+void IdaRenderQueue::Sort() {
+    auto count = packets_.size();
+    if (count < 2) {
+        return;
+    }
+    entries_.resize(count);
+    scratch_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        entries_[i] = {packets_[i].key, i};
+    }
+
+    // one histogram sweep for every digit, then a scatter per digit that is not the same in every key
+    histograms_.assign(RADIX_PASSES * RADIX_SIZE, 0);
+    for (const SortEntry& entry : entries_) {
+        for (uint32_t digit = 0; digit < RADIX_PASSES; digit++) {
+            histograms_[digit * RADIX_SIZE + ((entry.key >> (digit * RADIX_BITS)) & RADIX_MASK)]++;
+        }
+    }
+    for (uint32_t digit = 0; digit < RADIX_PASSES; digit++) {
+        uint32_t* histogram = &histograms_[digit * RADIX_SIZE];
+        uint32_t shift = digit * RADIX_BITS;
+        if (histogram[(entries_[0].key >> shift) & RADIX_MASK] == count) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_SIZE; bucket++) {
+            uint32_t size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+        for (const SortEntry& entry : entries_) {
+            scratch_[histogram[(entry.key >> shift) & RADIX_MASK]++] = entry;
+        }
+        entries_.swap(scratch_);
+    }
+
+    sorted_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        sorted_[i] = packets_[entries_[i].packet];
+    }
+    packets_.swap(sorted_);
+}
+
+void IdaRenderQueue::Replay(vk::CommandBuffer cmd) {
+    drawCount_ = 0;
+    pipelineBindCount_ = 0;
+    geometryBindCount_ = 0;
+    IdaPipeline* boundPipeline = nullptr;
+    uint32_t boundPage = UINT32_MAX;
+    vk::IndexType boundIndexType = vk::IndexType::eUint32;
+    for (size_t first = 0, last = 0; first < packets_.size(); first = last) {
+        const RenderPacket& packet = packets_[first];
+        for (last = first + 1; last < packets_.size(); last++) {
+            const RenderPacket& next = packets_[last];
+            if (next.pipeline != packet.pipeline || next.model != packet.model || next.lod != packet.lod) {
+                break;
+            }
+        }
+        if (packet.pipeline == nullptr || packet.model == nullptr) {
+            continue;
+        }
+        if (packet.pipeline != boundPipeline) {
+            boundPipeline = packet.pipeline;
+            boundPipeline->Bind(cmd);
+            pipelineBindCount_++;
+        }
+        // every model shares the arena buffers, so they are only rebound when the page or index type changes
+        if (packet.model->GetArenaPage() != boundPage || packet.model->GetIndexType() != boundIndexType) {
+            boundPage = packet.model->GetArenaPage();
+            boundIndexType = packet.model->GetIndexType();
+            packet.model->Bind(cmd);
+            geometryBindCount_++;
+        }
+        packet.model->Draw(cmd, packet.lod, static_cast<uint32_t>(last - first), static_cast<uint32_t>(first));
+        drawCount_++;
+    }
+}
+} // namespace ida
@@ -0,0 +1,98 @@
+#ifndef VULKAN_LIB_RENDER_QUEUE_HPP
+#define VULKAN_LIB_RENDER_QUEUE_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ida {
+class IdaModel;
+class IdaPipeline;
+
+enum class DrawPass : uint32_t {
+    Opaque = 0,
+    Transparent = 1,
+};
+
+enum class SortOrder {
+    // state first (pipeline, material, mesh), nearest first among equal state
+    FrontToBack,
+    // farthest first, state only breaks ties, as blending needs
+    BackToFront,
+};
+
+struct RenderPacket {
+    uint64_t key = 0;
+    // may be left empty by systems that only use the queue for ordering and record their own draws
+    IdaPipeline* pipeline = nullptr;
+    IdaModel* model = nullptr;
+    uint32_t lod = 0;
+    // the submitting system's index of what is drawn, e.g. to write its instance data in sorted order
+    uint32_t object = 0;
+};
+
+/**
+ * Draw packets ordered by a 64-bit key.
+ *
+ * MakeKey() packs the pass into the top bits, then pipeline, material and mesh ids and the view
+ * depth in the order the pass's SortOrder asks for, so Sort(), an LSD radix sort over the keys,
+ * yields the final order in at most 6 linear passes; digits shared by every key are skipped.
+ * Replay() walks the sorted packets and only binds a pipeline or an arena page when it differs from
+ * the previous packet, and draws runs of packets with the same pipeline, model and level of detail
+ * as one instanced draw whose instances are the packets' sorted positions.
+ */
+class IdaRenderQueue final {
+  public:
+    static constexpr uint32_t PASS_BITS = 2;
+    static constexpr uint32_t PIPELINE_BITS = 8;
+    static constexpr uint32_t MATERIAL_BITS = 10;
+    static constexpr uint32_t MESH_BITS = 24;
+    static constexpr uint32_t DEPTH_BITS = 20;
+    static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+    IdaRenderQueue();
+
+    void SetSortOrder(DrawPass pass, SortOrder order) { sortOrders_[static_cast<uint32_t>(pass)] = order; }
+    SortOrder GetSortOrder(DrawPass pass) const { return sortOrders_[static_cast<uint32_t>(pass)]; }
+
+    // ids are masked to their field width, depth is the view distance and clamped at 0
+    uint64_t MakeKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) const;
+
+    void Clear();
+    void Submit(const RenderPacket& packet) { packets_.push_back(packet); }
+    // Stable, packets with equal keys keep their submission order
+    void Sort();
+    // Records the sorted packets, the caller binds the descriptor sets shared by their pipelines and
+    // the instance data of packet i at instance i
+    void Replay(vk::CommandBuffer cmd);
+
+    const std::vector<RenderPacket>& GetPackets() const { return packets_; }
+    bool Empty() const { return packets_.empty(); }
+    // draw calls, pipeline and arena page binds of the last Replay()
+    uint32_t GetDrawCount() const { return drawCount_; }
+    uint32_t GetPipelineBindCount() const { return pipelineBindCount_; }
+    uint32_t GetGeometryBindCount() const { return geometryBindCount_; }
+
+  private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    std::array<SortOrder, 1u << PASS_BITS> sortOrders_;
+    std::vector<RenderPacket> packets_;
+    // ping pong buffers of the radix sort, kept to avoid allocating every frame
+    std::vector<SortEntry> entries_;
+    std::vector<SortEntry> scratch_;
+    std::vector<RenderPacket> sorted_;
+    std::vector<uint32_t> histograms_;
+
+    uint32_t drawCount_ = 0;
+    uint32_t pipelineBindCount_ = 0;
+    uint32_t geometryBindCount_ = 0;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_RENDER_QUEUE_HPP
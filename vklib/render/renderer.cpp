@@ -5,6 +5,7 @@ namespace ida {
 IdaRenderer::IdaRenderer(ida::IdaWindow& window) : window_{window} {
     RecreateSwapChain();
     CreateCommandBuffers();
+    frameAllocator_ = std::make_unique<IdaFrameAllocator>(IdaSwapChain::MAX_FRAMES_IN_FLIGHT);
 }
 IdaRenderer::~IdaRenderer() {
     FreeCommandBuffers();
@@ -58,11 +59,19 @@ vk::CommandBuffer IdaRenderer::BeginFrame() {
         IO::ThrowError("Failed to acquire swap chain image");
     }
     isFrameStarted = true;
+    // the swap chain has waited for this frame's fence, so its transient memory is free again
+    frameAllocator_->BeginFrame(currentFrameIndex);
 
     auto& ctx = Context::GetInstance();
     auto cmdBuffer = commandBuffers_[currentFrameIndex];
     auto beginInfo = vk::CommandBufferBeginInfo();
     cmdBuffer.begin(beginInfo);
+    // take ownership of buffers and images the transfer queue has finished writing
+    uploadWaitValue_ = ctx.uploadBatcher->AcquireForOwner(cmdBuffer);
+    // after the acquire, so resources it just took ownership of are stamped with this frame
+    ctx.deletionQueue->BeginFrame();
+    // compaction copies go first, so everything recorded afterwards sees the patched handles
+    ctx.defragmenter->Step(cmdBuffer);
     return cmdBuffer;
 }
 
@@ -71,8 +80,15 @@ void IdaRenderer::EndFrame() {
     auto& ctx = Context::GetInstance();
     auto cmdBuffer = commandBuffers_[currentFrameIndex];
     cmdBuffer.end();
+    frameAllocator_->Flush();
 
-    auto result = swapChain_->SubmitCommandBuffers(&cmdBuffer, &currentImageIndex);
+    // kick off uploads recorded during this frame so they overlap with it
+    ctx.uploadBatcher->Flush();
+
+    auto result = swapChain_->SubmitCommandBuffers(&cmdBuffer,
+                                                   &currentImageIndex,
+                                                   ctx.uploadBatcher->GetTimelineSemaphore(),
+                                                   uploadWaitValue_);
     if (result == vk::Result::eErrorOutOfDateKHR ||
         result == vk::Result::eSuboptimalKHR ||
         window_.IsResizeNow()) {
@@ -6,6 +6,7 @@
 #include "glm/glm.hpp"
 
 #include "buffer/buffer.hpp"
+#include "buffer/frame_allocator.hpp"
 #include "core/window.hpp"
 #include "swapchain/swapchain.hpp"
 
@@ -19,6 +20,7 @@ class IdaRenderer final {
 
     vk::RenderPass GetRenderPass() const { return swapChain_->GetRenderPass(); }
     float GetAspectRatio() const { return swapChain_->GetExtentAspectRatio(); }
+    vk::Extent2D GetExtent() const { return swapChain_->GetSwapChainExtent(); }
     bool IsFrameInProgress() const { return isFrameStarted; }
 
     vk::CommandBuffer GetCurrentCommandBuffer() const {
@@ -30,6 +32,9 @@ class IdaRenderer final {
         return currentFrameIndex;
     }
 
+    // Transient uniform/storage memory of the frame being recorded
+    IdaFrameAllocator& GetFrameAllocator() const { return *frameAllocator_; }
+
     vk::CommandBuffer BeginFrame();
     void EndFrame();
     void BeginSwapChainRenderPass(vk::CommandBuffer commandBuffer);
@@ -44,7 +49,9 @@ class IdaRenderer final {
 
     std::unique_ptr<IdaSwapChain> swapChain_;
     std::vector<vk::CommandBuffer> commandBuffers_;
+    std::unique_ptr<IdaFrameAllocator> frameAllocator_;
 
+    uint64_t uploadWaitValue_ = 0;
     uint32_t currentImageIndex = 0;
     int currentFrameIndex = 0;
     bool isFrameStarted = false;
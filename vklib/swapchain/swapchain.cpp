@@ -35,7 +35,7 @@ IdaSwapChain::~IdaSwapChain() {
     for (size_t i = 0; i < depthImages_.size(); i++) {
         device.destroyImageView(depthImageViews_[i]);
         device.destroyImage(depthImages_[i]);
-        device.freeMemory(depthImageMemories_[i]);
+        Context::GetInstance().allocator->Free(depthImageAllocations_[i]);
     }
 
     for (auto framebuffer : swapChainFramebuffers_) {
@@ -66,7 +66,11 @@ vk::Result IdaSwapChain::AcquireNextImageIndex(uint32_t& imageIndex) {
     return resultValue.result;
 }
 
-vk::Result IdaSwapChain::SubmitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t* imageIndex) {
+vk::Result IdaSwapChain::SubmitCommandBuffers(
+    const vk::CommandBuffer* buffers,
+    uint32_t* imageIndex,
+    vk::Semaphore uploadTimeline,
+    uint64_t uploadValue) {
     auto& ctx = Context::GetInstance();
     auto& device = ctx.device;
     if (imagesInFlight_[*imageIndex] != nullptr) {
@@ -74,11 +78,21 @@ vk::Result IdaSwapChain::SubmitCommandBuffers(const vk::CommandBuffer* buffers,
     }
     imagesInFlight_[*imageIndex] = inFlightFences_[currentFrame];
 
-    std::array<vk::PipelineStageFlags, 1> waitStages = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-    std::array<vk::Semaphore, 1> waitSemaphores = {imageAvailableSemaphores_[currentFrame]};
+    std::vector<vk::PipelineStageFlags> waitStages = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
+    std::vector<vk::Semaphore> waitSemaphores = {imageAvailableSemaphores_[currentFrame]};
+    std::vector<uint64_t> waitValues = {0};
     std::array<vk::Semaphore, 1> signalSemaphores = {renderFinishedSemaphores_[currentFrame]};
+    // uploads acquired by this frame come from another queue, wait on their timeline value
+    if (uploadTimeline && uploadValue > 0) {
+        waitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+        waitSemaphores.push_back(uploadTimeline);
+        waitValues.push_back(uploadValue);
+    }
+    auto timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+                            .setWaitSemaphoreValues(waitValues);
     auto submitInfo = vk::SubmitInfo()
-                          .setWaitSemaphoreCount(1)
+                          .setPNext(&timelineInfo)
+                          .setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size()))
                           .setPWaitSemaphores(waitSemaphores.data())
                           .setPWaitDstStageMask(waitStages.data())
                           .setCommandBufferCount(1)
@@ -167,7 +181,7 @@ void IdaSwapChain::CreateDepthResources() {
     swapChainDepthFormat_ = FindDepthFormat();
 
     depthImages_.resize(GetImageCount());
-    depthImageMemories_.resize(GetImageCount());
+    depthImageAllocations_.resize(GetImageCount());
     depthImageViews_.resize(GetImageCount());
 
     for (int i = 0; i < depthImages_.size(); i++) {
@@ -183,7 +197,7 @@ void IdaSwapChain::CreateDepthResources() {
                                         .setSamples(vk::SampleCountFlagBits::e1)
                                         .setSharingMode(vk::SharingMode::eExclusive)
                                         .setQueueFamilyIndexCount(0);
-        ctx.CreateImageWithInfo(depthImageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImages_[i], depthImageMemories_[i]);
+        ctx.CreateImageWithInfo(depthImageCreateInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImages_[i], depthImageAllocations_[i]);
 
         auto depthImageViewCreateInfo = vk::ImageViewCreateInfo()
                                             .setImage(depthImages_[i])
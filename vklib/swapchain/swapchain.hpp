@@ -3,6 +3,8 @@
 
 #include "vulkan/vulkan.hpp"
 
+#include "memory/allocator.hpp"
+
 namespace ida {
 class IdaSwapChain final {
   public:
@@ -26,7 +28,11 @@ class IdaSwapChain final {
 
     vk::Format FindDepthFormat();
     vk::Result AcquireNextImageIndex(uint32_t& imageIndex);
-    vk::Result SubmitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t* imageIndex);
+    vk::Result SubmitCommandBuffers(
+        const vk::CommandBuffer* buffers,
+        uint32_t* imageIndex,
+        vk::Semaphore uploadTimeline = nullptr,
+        uint64_t uploadValue = 0);
 
     bool CompareSwapFormats(const IdaSwapChain& other) const {
         return swapChainImageFormat_ == other.swapChainImageFormat_ &&
@@ -54,7 +60,7 @@ class IdaSwapChain final {
     vk::RenderPass renderPass_;
 
     std::vector<vk::Image> depthImages_;
-    std::vector<vk::DeviceMemory> depthImageMemories_;
+    std::vector<IdaAllocation*> depthImageAllocations_;
     std::vector<vk::ImageView> depthImageViews_;
     std::vector<vk::Image> swapChainImages_;
     std::vector<vk::ImageView> swapChainImageViews_;
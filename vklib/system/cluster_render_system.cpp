@@ -0,0 +1,443 @@
+#include "cluster_render_system.hpp"
+#include "core/context.hpp"
+#include "model/meshlet_builder.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <utility>
+
+namespace ida {
+namespace {
+// local_size_x of cluster_cull.comp
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+// the smallest maxComputeWorkGroupCount[1] a device may report, more instances continue in z
+constexpr uint32_t MAX_GROUPS_Y = 65535;
+// one uvec4 per batch, or per task command of a batch with mesh shaders: the visible count, which is
+// also the x of a VkDrawMeshTasksIndirectCommandEXT, and in w the appends of the batch
+constexpr vk::DeviceSize COUNT_STRIDE = 16;
+// the smallest maxMeshWorkGroupCount[0] a device may report, also below maxMeshWorkGroupTotalCount
+constexpr uint32_t MAX_TASKS_PER_COMMAND = 65535;
+constexpr vk::DeviceSize DRAW_COMMAND_STRIDE = sizeof(vk::DrawIndexedIndirectCommand);
+// (instance, meshlet) pairs of the mesh shader path
+constexpr vk::DeviceSize VISIBLE_MESHLET_STRIDE = 2 * sizeof(uint32_t);
+// frame allocator bytes the meshlet arrays may stage per frame, large models stream in over several
+constexpr vk::DeviceSize MAX_MESHLET_UPLOAD_BYTES = 256ull * 1024;
+
+struct ClusterCullUbo {
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition{0.0f}; // world space
+    uint32_t instanceCount = 0;
+    uint32_t batchCount = 0;
+    uint32_t meshletCount = 0;
+    uint32_t coneCulling = 0;
+    uint32_t meshShading = 0;
+    uint32_t padding[3]{};
+};
+
+// simple_shader.frag still declares the 128-byte Push block of SimpleRenderSystem
+struct ClusterPushConstantData {
+    uint32_t commandOffset = 0;
+    uint32_t padding[31]{};
+};
+static_assert(sizeof(ClusterPushConstantData) == 2 * sizeof(glm::mat4));
+} // namespace
+
+ClusterRenderSystem::ClusterRenderSystem(vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout)
+    : meshlets_(vk::BufferUsageFlagBits::eStorageBuffer),
+      meshletVertices_(vk::BufferUsageFlagBits::eStorageBuffer),
+      meshletTriangles_(vk::BufferUsageFlagBits::eStorageBuffer),
+      instances_(vk::BufferUsageFlagBits::eStorageBuffer),
+      batchRanges_(vk::BufferUsageFlagBits::eStorageBuffer) {
+    auto& ctx = Context::GetInstance();
+    meshShading_ = ctx.features.meshShader;
+    IO::Assert(
+        meshShading_ || ctx.features.drawIndirectFirstInstance,
+        "Cluster rendering needs drawIndirectFirstInstance or mesh shaders");
+    IO::PrintLog(
+        LOG_LEVEL::LOG_LEVEL_INFO,
+        "Cluster rendering through {}",
+        meshShading_ ? "mesh shaders" : ctx.features.drawIndirectCount ? "drawIndexedIndirectCount" : "drawIndexedIndirect");
+    CreatePipelineLayouts(globalSetLayout);
+    CreatePipelines(renderPass);
+}
+
+ClusterRenderSystem::~ClusterRenderSystem() {
+    auto& device = Context::GetInstance().device;
+    device.destroyPipelineLayout(cullPipelineLayout_);
+    device.destroyPipelineLayout(pipelineLayout_);
+}
+
+void ClusterRenderSystem::CreatePipelineLayouts(vk::DescriptorSetLayout globalSetLayout) {
+    auto drawStage = meshShading_ ? vk::ShaderStageFlagBits::eMeshEXT : vk::ShaderStageFlagBits::eVertex;
+    auto storage = vk::DescriptorType::eStorageBuffer;
+    clusterSetLayout_ = IdaDescriptorSetLayout::Builder()
+                            .AddBinding(0, storage, vk::ShaderStageFlagBits::eCompute | drawStage)
+                            .AddBinding(1, storage, vk::ShaderStageFlagBits::eCompute | drawStage)
+                            .AddBinding(2, storage, vk::ShaderStageFlagBits::eCompute | drawStage)
+                            .AddBinding(3, storage, vk::ShaderStageFlagBits::eCompute)
+                            .AddBinding(4, storage, drawStage)
+                            .AddBinding(5, storage, drawStage)
+                            .AddBinding(6, vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eCompute)
+                            .AddBinding(7, storage, vk::ShaderStageFlagBits::eCompute)
+                            .Build();
+    pageSetLayout_ = IdaDescriptorSetLayout::Builder()
+                         .AddBinding(0, storage, drawStage)
+                         .Build();
+
+    std::vector<vk::DescriptorSetLayout> cullLayouts = {clusterSetLayout_->GetDescriptorSetLayout()};
+    cullPipelineLayout_ = Context::GetInstance().device.createPipelineLayout(vk::PipelineLayoutCreateInfo().setSetLayouts(cullLayouts));
+
+    auto pushConstantRange = vk::PushConstantRange()
+                                 .setStageFlags(drawStage | vk::ShaderStageFlagBits::eFragment)
+                                 .setOffset(0)
+                                 .setSize(sizeof(ClusterPushConstantData));
+    std::vector<vk::DescriptorSetLayout> layouts = {globalSetLayout, clusterSetLayout_->GetDescriptorSetLayout()};
+    if (meshShading_) {
+        layouts.push_back(pageSetLayout_->GetDescriptorSetLayout());
+    }
+    auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                        .setSetLayouts(layouts)
+                                        .setPushConstantRanges(pushConstantRange);
+    pipelineLayout_ = Context::GetInstance().device.createPipelineLayout(pipelineLayoutCreateInfo);
+}
+
+void ClusterRenderSystem::CreatePipelines(vk::RenderPass renderPass) {
+    cullPipeline_ = std::make_unique<IdaComputePipeline>(ReadWholeFile("shaders/cluster_cull.comp.spv"), cullPipelineLayout_);
+
+    PipelineConfigInfo pipelineConfig{};
+    IdaPipeline::DefaultPipelineConfigInfo(pipelineConfig);
+    // the normal cones only reject meshlets that are entirely backfacing, the rest is culled here
+    pipelineConfig.rasterizationInfo.cullMode = vk::CullModeFlagBits::eBack;
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = pipelineLayout_;
+    if (meshShading_) {
+        pipelineConfig.firstStage = vk::ShaderStageFlagBits::eMeshEXT;
+        pipeline_ = std::make_unique<IdaPipeline>(ReadWholeFile("shaders/cluster_shader.mesh.spv"),
+                                                  ReadWholeFile("shaders/simple_shader.frag.spv"),
+                                                  pipelineConfig);
+    } else {
+        pipeline_ = std::make_unique<IdaPipeline>(ReadWholeFile("shaders/cluster_shader.vert.spv"),
+                                                  ReadWholeFile("shaders/simple_shader.frag.spv"),
+                                                  pipelineConfig);
+    }
+}
+
+void ClusterRenderSystem::Cull(FrameInfo& frameInfo) {
+    auto& ctx = Context::GetInstance();
+    auto& cmd = frameInfo.commandBuffer;
+    culledInstanceCount_ = 0;
+    RegisterModels(frameInfo);
+    CollectInstances(frameInfo);
+    bool uploading = !meshlets_.IsSynced() || !meshletVertices_.IsSynced() || !meshletTriangles_.IsSynced();
+    if (instances_.Empty() && !uploading) {
+        return;
+    }
+
+    // the previous frame may still be drawing from the buffers rewritten below
+    auto readStages = vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader |
+                      (meshShading_ ? vk::PipelineStageFlagBits::eMeshShaderEXT : vk::PipelineStageFlagBits::eVertexShader);
+    cmd.pipelineBarrier(readStages, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), nullptr, nullptr, nullptr);
+
+    // instances only use models whose meshlets were synced by an earlier frame, see CollectInstances()
+    vk::DeviceSize uploaded = meshlets_.Sync(cmd, frameInfo.frameAllocator, MAX_MESHLET_UPLOAD_BYTES);
+    uploaded += meshletVertices_.Sync(cmd, frameInfo.frameAllocator, MAX_MESHLET_UPLOAD_BYTES - uploaded);
+    meshletTriangles_.Sync(cmd, frameInfo.frameAllocator, MAX_MESHLET_UPLOAD_BYTES - uploaded);
+    if (instances_.Empty()) {
+        return;
+    }
+    ReserveCommands();
+    // only instances that changed are staged, the rest keep what earlier frames uploaded
+    instances_.Sync(cmd, frameInfo.frameAllocator, maxUploadBytes_);
+    batchRanges_.Sync(cmd, frameInfo.frameAllocator);
+    UpdateDescriptorSets(frameInfo.frameAllocator);
+    culledInstanceCount_ = static_cast<uint32_t>(instances_.GetSyncedSize());
+    if (culledInstanceCount_ == 0) {
+        return;
+    }
+
+    std::vector<glm::uvec4> counts(countSize_, glm::uvec4(0, 1, 1, 0));
+    cmd.updateBuffer(countBuffer_->GetBuffer(), 0, counts.size() * COUNT_STRIDE, counts.data());
+    if (!meshShading_ && !ctx.features.drawIndirectCount) {
+        // every command slot is drawn, the ones culling leaves untouched must be empty draws
+        cmd.fillBuffer(commandBuffer_->GetBuffer(), 0, commandCapacity_ * DRAW_COMMAND_STRIDE, 0);
+    }
+    auto toCompute = vk::MemoryBarrier()
+                         .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                         .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), toCompute, nullptr, nullptr);
+
+    ClusterCullUbo ubo{};
+    auto planes = frameInfo.camera.GetFrustumPlanes();
+    std::copy(planes.begin(), planes.end(), ubo.frustumPlanes);
+    ubo.cameraPosition = glm::vec4(frameInfo.camera.GetPosition(), 1.0f);
+    ubo.instanceCount = culledInstanceCount_;
+    ubo.batchCount = static_cast<uint32_t>(batches_.size());
+    ubo.meshletCount = static_cast<uint32_t>(meshlets_.GetSyncedSize());
+    ubo.coneCulling = coneCulling_ ? 1 : 0;
+    ubo.meshShading = meshShading_ ? 1 : 0;
+    cullUboOffset_ = frameInfo.frameAllocator.Push(ubo).dynamicOffset;
+
+    cullPipeline_->Bind(cmd);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout_, 0, clusterSet_, cullUboOffset_);
+    // x walks the meshlets of an instance, y and z the instances
+    uint32_t groupsY = std::min(ubo.instanceCount, MAX_GROUPS_Y);
+    cmd.dispatch((maxInstanceMeshlets_ + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, groupsY, (ubo.instanceCount + groupsY - 1) / groupsY);
+
+    auto toDraw = vk::MemoryBarrier()
+                      .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                      .setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, readStages, vk::DependencyFlags(), toDraw, nullptr, nullptr);
+}
+
+void ClusterRenderSystem::Render(FrameInfo& frameInfo) {
+    if (culledInstanceCount_ == 0) {
+        return;
+    }
+    auto& ctx = Context::GetInstance();
+    auto& cmd = frameInfo.commandBuffer;
+    pipeline_->Bind(cmd);
+    std::vector<vk::DescriptorSet> sets = {frameInfo.globalDescriptorSet, clusterSet_};
+    std::vector<uint32_t> dynamicOffsets = {frameInfo.globalUboOffset, cullUboOffset_};
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout_, 0, sets, dynamicOffsets);
+
+    auto pushStages = (meshShading_ ? vk::ShaderStageFlagBits::eMeshEXT : vk::ShaderStageFlagBits::eVertex) | vk::ShaderStageFlagBits::eFragment;
+    for (uint32_t i = 0; i < batches_.size(); i++) {
+        const Batch& batch = batches_[i];
+        if (meshShading_) {
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout_, 2, pageSets_[batch.page], nullptr);
+            for (uint32_t command = 0; command < batch.countSize; command++) {
+                ClusterPushConstantData push{};
+                push.commandOffset = batch.commandOffset + command * MAX_TASKS_PER_COMMAND;
+                cmd.pushConstants<ClusterPushConstantData>(pipelineLayout_, pushStages, 0, push);
+                cmd.drawMeshTasksIndirectEXT(countBuffer_->GetBuffer(), (batch.countOffset + command) * COUNT_STRIDE, 1, COUNT_STRIDE, ctx.dispatcher);
+            }
+            continue;
+        }
+
+        ctx.geometryArena->Bind(cmd, batch.page, batch.indexType);
+        vk::DeviceSize offset = batch.commandOffset * DRAW_COMMAND_STRIDE;
+        if (ctx.features.drawIndirectCount) {
+            cmd.drawIndexedIndirectCount(commandBuffer_->GetBuffer(), offset, countBuffer_->GetBuffer(), batch.countOffset * COUNT_STRIDE, batch.capacity, DRAW_COMMAND_STRIDE);
+        } else if (ctx.features.multiDrawIndirect) {
+            cmd.drawIndexedIndirect(commandBuffer_->GetBuffer(), offset, batch.capacity, DRAW_COMMAND_STRIDE);
+        } else {
+            for (uint32_t slot = 0; slot < batch.capacity; slot++) {
+                cmd.drawIndexedIndirect(commandBuffer_->GetBuffer(), offset + slot * DRAW_COMMAND_STRIDE, 1, DRAW_COMMAND_STRIDE);
+            }
+        }
+    }
+}
+
+void ClusterRenderSystem::RegisterModels(FrameInfo& frameInfo) {
+    // released models leave holes in the shared arrays, which are rebuilt from the live ones
+    bool expired = std::any_of(models_.begin(), models_.end(), [](const auto& entry) { return entry.second.model.expired(); });
+    if (expired) {
+        std::vector<std::shared_ptr<IdaModel>> live;
+        for (auto& [_, entry] : models_) {
+            if (auto model = entry.model.lock()) {
+                live.push_back(std::move(model));
+            }
+        }
+        models_.clear();
+        meshlets_.Clear();
+        meshletVertices_.Clear();
+        meshletTriangles_.Clear();
+        for (auto& model : live) {
+            AddModel(model);
+        }
+    }
+
+    for (auto& [_, obj] : frameInfo.gameObjects) {
+        if (obj.model != nullptr && obj.model->HasMeshlets() && !models_.count(obj.model.get())) {
+            AddModel(obj.model);
+        }
+    }
+}
+
+void ClusterRenderSystem::AddModel(const std::shared_ptr<IdaModel>& model) {
+    const MeshletData& data = model->GetMeshlets();
+    ModelEntry entry{model, static_cast<uint32_t>(meshlets_.Size()), static_cast<uint32_t>(data.meshlets.size())};
+    // the vertex path only reads the bounds and index ranges
+    auto vertexOffset = static_cast<uint32_t>(meshletVertices_.Size());
+    auto triangleOffset = static_cast<uint32_t>(meshletTriangles_.Size());
+    for (Meshlet meshlet : data.meshlets) {
+        meshlet.vertexOffset += vertexOffset;
+        meshlet.triangleOffset += triangleOffset;
+        meshlets_.PushBack(meshlet);
+    }
+    if (meshShading_) {
+        for (uint32_t vertex : data.vertices) {
+            meshletVertices_.PushBack(vertex);
+        }
+        for (uint32_t triangle : data.triangles) {
+            meshletTriangles_.PushBack(triangle);
+        }
+    }
+    entry.vertexEnd = static_cast<uint32_t>(meshletVertices_.Size());
+    entry.triangleEnd = static_cast<uint32_t>(meshletTriangles_.Size());
+    models_.emplace(model.get(), entry);
+}
+
+bool ClusterRenderSystem::IsSynced(const ModelEntry& entry) const {
+    return entry.meshletOffset + entry.meshletCount <= meshlets_.GetSyncedSize() &&
+           entry.vertexEnd <= meshletVertices_.GetSyncedSize() && entry.triangleEnd <= meshletTriangles_.GetSyncedSize();
+}
+
+void ClusterRenderSystem::CollectInstances(FrameInfo& frameInfo) {
+    collected_.clear();
+    batches_.clear();
+    maxInstanceMeshlets_ = 0;
+    meshletCount_ = 0;
+    // batches are keyed by page and index type, mesh shaders fetch indices themselves
+    std::map<std::pair<uint32_t, vk::IndexType>, uint32_t> batchIndices;
+    for (auto& [_, obj] : frameInfo.gameObjects) {
+        if (obj.model == nullptr || !obj.model->HasMeshlets() || !obj.model->IsResident()) {
+            continue;
+        }
+        const IdaModel& model = *obj.model;
+        const ModelEntry& entry = models_.at(&model);
+        if (!IsSynced(entry)) {
+            continue;
+        }
+        auto key = std::make_pair(model.GetArenaPage(), meshShading_ ? vk::IndexType::eUint32 : model.GetIndexType());
+        auto [it, inserted] = batchIndices.emplace(key, static_cast<uint32_t>(batches_.size()));
+        if (inserted) {
+            batches_.push_back({key.first, key.second});
+        }
+
+        Instance instance{};
+        instance.modelMatrix = obj.transform.mat4();
+        instance.normalMatrix = glm::transpose(glm::inverse(instance.modelMatrix));
+        instance.meshletOffset = entry.meshletOffset;
+        instance.meshletCount = entry.meshletCount;
+        instance.firstIndex = model.GetFirstIndex();
+        instance.vertexOffset = model.GetVertexOffset();
+        instance.batch = it->second;
+        glm::vec3 scale = glm::abs(obj.transform.scale);
+        instance.scale = std::max({scale.x, scale.y, scale.z});
+        batches_[instance.batch].capacity += entry.meshletCount;
+        collected_.push_back(instance);
+
+        maxInstanceMeshlets_ = std::max(maxInstanceMeshlets_, entry.meshletCount);
+        meshletCount_ += entry.meshletCount;
+    }
+
+    // every batch gets a slot for each of its meshlets, culling fills them from the front, and with
+    // mesh shaders a task command for each MAX_TASKS_PER_COMMAND of them
+    uint32_t commandOffset = 0;
+    countSize_ = 0;
+    batchRanges_.Resize(batches_.size());
+    for (uint32_t i = 0; i < batches_.size(); i++) {
+        Batch& batch = batches_[i];
+        batch.commandOffset = commandOffset;
+        batch.countOffset = countSize_;
+        batch.countSize = meshShading_ ? std::max(1u, (batch.capacity + MAX_TASKS_PER_COMMAND - 1) / MAX_TASKS_PER_COMMAND) : 1;
+        commandOffset += batch.capacity;
+        countSize_ += batch.countSize;
+        glm::uvec4 range(batch.commandOffset, batch.capacity, batch.countOffset, 0);
+        if (batchRanges_[i] != range) {
+            batchRanges_.Set(i, range);
+        }
+    }
+
+    // a still scene stages nothing, a moving object only its own slot
+    instances_.Resize(collected_.size());
+    for (size_t i = 0; i < collected_.size(); i++) {
+        if (std::memcmp(&instances_[i], &collected_[i], sizeof(Instance)) != 0) {
+            instances_.Set(i, collected_[i]);
+        }
+    }
+}
+
+void ClusterRenderSystem::ReserveCommands() {
+    if (meshletCount_ <= commandCapacity_ && countSize_ <= countCapacity_) {
+        return;
+    }
+    commandCapacity_ = std::max(meshletCount_, commandCapacity_ * 2);
+    countCapacity_ = std::max(countSize_, countCapacity_ * 2);
+    auto usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    // the old buffers go through the deletion queue, frames in flight keep drawing from them
+    commandBuffer_ = std::make_unique<IdaBuffer>(
+        BufferType::StorageBuffer,
+        meshShading_ ? VISIBLE_MESHLET_STRIDE : DRAW_COMMAND_STRIDE,
+        commandCapacity_,
+        usage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    countBuffer_ = std::make_unique<IdaBuffer>(
+        BufferType::StorageBuffer,
+        COUNT_STRIDE,
+        countCapacity_,
+        usage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    commandGeneration_++;
+}
+
+void ClusterRenderSystem::UpdateDescriptorSets(IdaFrameAllocator& frameAllocator) {
+    auto& arena = *Context::GetInstance().geometryArena;
+    std::vector<uint32_t> generations = {
+        meshlets_.GetGeneration(),
+        meshletVertices_.GetGeneration(),
+        meshletTriangles_.GetGeneration(),
+        instances_.GetGeneration(),
+        batchRanges_.GetGeneration(),
+        commandGeneration_,
+    };
+    std::vector<vk::Buffer> pageBuffers;
+    if (meshShading_) {
+        for (uint32_t page = 0; page < arena.GetPageCount(); page++) {
+            pageBuffers.push_back(arena.IsPageValid(page) ? arena.GetVertexBuffer(page) : vk::Buffer());
+        }
+    }
+    if (descriptorPool_ && generations == setGenerations_ && pageBuffers == pageBuffers_) {
+        return;
+    }
+    setGenerations_ = std::move(generations);
+    pageBuffers_ = std::move(pageBuffers);
+
+    if (descriptorPool_) {
+        // frames in flight still use the old sets, so their pool only goes once those have finished
+        Context::GetInstance().deletionQueue->Push([pool = std::shared_ptr<IdaDescriptorPool>(std::move(descriptorPool_))]() {});
+    }
+    auto setCount = static_cast<uint32_t>(1 + pageBuffers_.size());
+    descriptorPool_ = IdaDescriptorPool::Builder()
+                          .SetMaxSets(setCount)
+                          .AddPoolSize(vk::DescriptorType::eStorageBuffer, 7 + setCount)
+                          .AddPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1)
+                          .Build();
+
+    auto meshletInfo = meshlets_.GetDescriptorInfo();
+    auto instanceInfo = instances_.GetDescriptorInfo();
+    auto commandInfo = commandBuffer_->GetDescriptorInfo();
+    auto countInfo = countBuffer_->GetDescriptorInfo();
+    auto vertexInfo = meshletVertices_.GetDescriptorInfo();
+    auto triangleInfo = meshletTriangles_.GetDescriptorInfo();
+    auto cullUboInfo = frameAllocator.GetDescriptorInfo(sizeof(ClusterCullUbo));
+    auto batchInfo = batchRanges_.GetDescriptorInfo();
+    IdaDescriptorWriter(*clusterSetLayout_, *descriptorPool_)
+        .WriteBuffer(0, &meshletInfo)
+        .WriteBuffer(1, &instanceInfo)
+        .WriteBuffer(2, &commandInfo)
+        .WriteBuffer(3, &countInfo)
+        .WriteBuffer(4, &vertexInfo)
+        .WriteBuffer(5, &triangleInfo)
+        .WriteBuffer(6, &cullUboInfo)
+        .WriteBuffer(7, &batchInfo)
+        .Build(clusterSet_);
+
+    pageSets_.assign(pageBuffers_.size(), vk::DescriptorSet());
+    for (uint32_t page = 0; page < pageBuffers_.size(); page++) {
+        if (!pageBuffers_[page]) {
+            continue;
+        }
+        auto pageInfo = vk::DescriptorBufferInfo(pageBuffers_[page], 0, vk::WholeSize);
+        IdaDescriptorWriter(*pageSetLayout_, *descriptorPool_)
+            .WriteBuffer(0, &pageInfo)
+            .Build(pageSets_[page]);
+    }
+}
+} // namespace ida
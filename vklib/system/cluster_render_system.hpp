@@ -0,0 +1,138 @@
+#ifndef VULKAN_LIB_CLUSTER_RENDER_SYSTEM_HPP
+#define VULKAN_LIB_CLUSTER_RENDER_SYSTEM_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include "global_info.hpp"
+#include "buffer/gpu_vector.hpp"
+#include "descriptor/descriptors.hpp"
+#include "render/pipeline.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ida {
+/**
+ * Draws models imported with ImportOptions::buildMeshlets, culling every meshlet on the GPU.
+ *
+ * Cull() runs cluster_cull.comp before the render pass: one invocation per meshlet of every
+ * instance tests the bounding sphere against the frustum and the normal cone against the camera,
+ * and appends the survivors to the compacted list of its batch (the instances sharing an arena
+ * page and index type) with an atomic counter. Render() then draws each batch with one indirect
+ * call. With VK_EXT_mesh_shader the list holds (instance, meshlet) pairs, drawn by one
+ * drawMeshTasksIndirectEXT per 65535 slots of the batch whose task counts culling fills in. Otherwise it holds indexed draws of the
+ * meshlets' index ranges, drawn with drawIndexedIndirectCount, or over the whole batch capacity
+ * with the unused commands zeroed when the device lacks it. Meshlet data is staged under a per-frame
+ * byte budget, so a model is only culled and drawn once all of it has arrived. Instances persist
+ * across frames as well: only the ones whose transform or batch changed are staged again, at most
+ * maxUploadBytes per frame, and the camera reaches the cone test through the culling uniforms.
+ */
+class ClusterRenderSystem {
+  public:
+    static constexpr vk::DeviceSize DEFAULT_MAX_UPLOAD_BYTES = 256ull * 1024;
+
+    ClusterRenderSystem(vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout);
+    ~ClusterRenderSystem();
+    ClusterRenderSystem(const ClusterRenderSystem&) = delete;
+    ClusterRenderSystem& operator=(const ClusterRenderSystem&) = delete;
+
+    // Records the culling dispatch, must be called outside the render pass
+    void Cull(FrameInfo& frameInfo);
+    // Draws what the last Cull() of this frame kept
+    void Render(FrameInfo& frameInfo);
+
+    void SetConeCulling(bool enabled) { coneCulling_ = enabled; }
+    bool IsUsingMeshShaders() const { return meshShading_; }
+    // meshlets submitted to culling in the last frame
+    uint32_t GetMeshletCount() const { return meshletCount_; }
+    // bytes of the frame allocator the instance table may stage per frame
+    void SetMaxUploadBytes(vk::DeviceSize bytes) { maxUploadBytes_ = bytes; }
+
+  private:
+    // std430 layout of the Instance struct in the cluster shaders
+    struct Instance {
+        glm::mat4 modelMatrix{1.0f};
+        glm::mat4 normalMatrix{1.0f}; // its transpose takes the camera into model space for the cones
+        uint32_t meshletOffset = 0;
+        uint32_t meshletCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        uint32_t batch = 0;
+        float scale = 1.0f; // largest axis of the transform scale
+        uint32_t padding[2]{};
+    };
+    struct ModelEntry {
+        std::weak_ptr<IdaModel> model;
+        // into meshlets_, the meshlets already point into the shared vertex and triangle arrays
+        uint32_t meshletOffset = 0;
+        uint32_t meshletCount = 0;
+        // ends of its ranges in meshletVertices_ and meshletTriangles_, 0 without mesh shaders
+        uint32_t vertexEnd = 0;
+        uint32_t triangleEnd = 0;
+    };
+    struct Batch {
+        uint32_t page = 0;
+        vk::IndexType indexType = vk::IndexType::eUint32;
+        uint32_t commandOffset = 0;
+        uint32_t capacity = 0;
+        // entries of countBuffer_, one per task command with mesh shaders
+        uint32_t countOffset = 0;
+        uint32_t countSize = 1;
+    };
+
+    void RegisterModels(FrameInfo& frameInfo);
+    void AddModel(const std::shared_ptr<IdaModel>& model);
+    // whether every array range the model's meshlets read has reached the GPU
+    bool IsSynced(const ModelEntry& entry) const;
+    void CollectInstances(FrameInfo& frameInfo);
+    void ReserveCommands();
+    void UpdateDescriptorSets(IdaFrameAllocator& frameAllocator);
+
+    void CreatePipelineLayouts(vk::DescriptorSetLayout globalSetLayout);
+    void CreatePipelines(vk::RenderPass renderPass);
+
+    bool meshShading_ = false;
+    bool coneCulling_ = true;
+    uint32_t meshletCount_ = 0;
+    uint32_t culledInstanceCount_ = 0;
+    vk::DeviceSize maxUploadBytes_ = DEFAULT_MAX_UPLOAD_BYTES;
+
+    std::unique_ptr<IdaComputePipeline> cullPipeline_;
+    std::unique_ptr<IdaPipeline> pipeline_;
+    vk::PipelineLayout cullPipelineLayout_;
+    vk::PipelineLayout pipelineLayout_;
+
+    std::unordered_map<const IdaModel*, ModelEntry> models_;
+    IdaGpuVector<Meshlet> meshlets_;
+    IdaGpuVector<uint32_t> meshletVertices_;
+    IdaGpuVector<uint32_t> meshletTriangles_;
+    IdaGpuVector<Instance> instances_;
+    // this frame's instances, compared against instances_ so unchanged ones are not staged again
+    std::vector<Instance> collected_;
+    // (commandOffset, capacity, countOffset) per batch on the GPU
+    IdaGpuVector<glm::uvec4> batchRanges_;
+    std::vector<Batch> batches_;
+    uint32_t maxInstanceMeshlets_ = 0;
+    uint32_t countSize_ = 0;
+
+    // written by the culling shader, grown with commandGeneration_
+    std::unique_ptr<IdaBuffer> commandBuffer_;
+    std::unique_ptr<IdaBuffer> countBuffer_;
+    uint32_t commandCapacity_ = 0;
+    uint32_t countCapacity_ = 0;
+    uint32_t commandGeneration_ = 0;
+    uint32_t cullUboOffset_ = 0;
+
+    // rebuilt, together with their pool, whenever a buffer they point at is replaced
+    std::unique_ptr<IdaDescriptorSetLayout> clusterSetLayout_;
+    std::unique_ptr<IdaDescriptorSetLayout> pageSetLayout_;
+    std::unique_ptr<IdaDescriptorPool> descriptorPool_;
+    vk::DescriptorSet clusterSet_;
+    std::vector<vk::DescriptorSet> pageSets_;
+    std::vector<uint32_t> setGenerations_;
+    std::vector<vk::Buffer> pageBuffers_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_CLUSTER_RENDER_SYSTEM_HPP
@@ -0,0 +1,392 @@
+#include "indirect_render_system.hpp"
+#include "core/context.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ida {
+namespace {
+// local_size_x of indirect_cull.comp
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+// the smallest maxComputeWorkGroupCount[0] a device may report, larger dispatches continue in y
+constexpr uint32_t MAX_GROUPS_X = 65535;
+// one uint per batch, the draw count read by drawIndexedIndirectCount
+constexpr vk::DeviceSize COUNT_STRIDE = sizeof(uint32_t);
+constexpr vk::DeviceSize DRAW_COMMAND_STRIDE = sizeof(vk::DrawIndexedIndirectCommand);
+// simple_shader.frag still declares the 128-byte Push block of SimpleRenderSystem
+constexpr uint32_t FRAGMENT_PUSH_SIZE = 2 * sizeof(glm::mat4);
+
+struct IndirectCullUbo {
+    glm::vec4 frustumPlanes[6];
+    uint32_t objectCount = 0;
+    uint32_t padding[3]{};
+};
+} // namespace
+
+IndirectRenderSystem::IndirectRenderSystem(vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout)
+    : objects_(vk::BufferUsageFlagBits::eStorageBuffer),
+      meshes_(vk::BufferUsageFlagBits::eStorageBuffer),
+      batchRanges_(vk::BufferUsageFlagBits::eStorageBuffer) {
+    auto& ctx = Context::GetInstance();
+    IO::Assert(ctx.features.drawIndirectFirstInstance, "Indirect rendering needs drawIndirectFirstInstance");
+    IO::PrintLog(
+        LOG_LEVEL::LOG_LEVEL_INFO,
+        "Indirect rendering through {}",
+        ctx.features.drawIndirectCount ? "drawIndexedIndirectCount" : ctx.features.multiDrawIndirect ? "drawIndexedIndirect" : "one drawIndexedIndirect per object");
+    arenaGeneration_ = ctx.geometryArena->GetGeneration();
+    CreatePipelineLayouts(globalSetLayout);
+    CreatePipelines(renderPass);
+}
+
+IndirectRenderSystem::~IndirectRenderSystem() {
+    auto& device = Context::GetInstance().device;
+    device.destroyPipelineLayout(cullPipelineLayout_);
+    device.destroyPipelineLayout(pipelineLayout_);
+}
+
+void IndirectRenderSystem::CreatePipelineLayouts(vk::DescriptorSetLayout globalSetLayout) {
+    auto storage = vk::DescriptorType::eStorageBuffer;
+    objectSetLayout_ = IdaDescriptorSetLayout::Builder()
+                           .AddBinding(0, storage, vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex)
+                           .AddBinding(1, storage, vk::ShaderStageFlagBits::eCompute)
+                           .AddBinding(2, storage, vk::ShaderStageFlagBits::eCompute)
+                           .AddBinding(3, storage, vk::ShaderStageFlagBits::eCompute)
+                           .AddBinding(4, storage, vk::ShaderStageFlagBits::eCompute)
+                           .AddBinding(5, vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eCompute)
+                           .Build();
+
+    std::vector<vk::DescriptorSetLayout> cullLayouts = {objectSetLayout_->GetDescriptorSetLayout()};
+    cullPipelineLayout_ = Context::GetInstance().device.createPipelineLayout(vk::PipelineLayoutCreateInfo().setSetLayouts(cullLayouts));
+
+    auto pushConstantRange = vk::PushConstantRange()
+                                 .setStageFlags(vk::ShaderStageFlagBits::eFragment)
+                                 .setOffset(0)
+                                 .setSize(FRAGMENT_PUSH_SIZE);
+    std::vector<vk::DescriptorSetLayout> layouts = {globalSetLayout, objectSetLayout_->GetDescriptorSetLayout()};
+    auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
+                                        .setSetLayouts(layouts)
+                                        .setPushConstantRanges(pushConstantRange);
+    pipelineLayout_ = Context::GetInstance().device.createPipelineLayout(pipelineLayoutCreateInfo);
+}
+
+void IndirectRenderSystem::CreatePipelines(vk::RenderPass renderPass) {
+    cullPipeline_ = std::make_unique<IdaComputePipeline>(ReadWholeFile("shaders/indirect_cull.comp.spv"), cullPipelineLayout_);
+
+    PipelineConfigInfo pipelineConfig{};
+    IdaPipeline::DefaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = pipelineLayout_;
+    pipeline_ = std::make_unique<IdaPipeline>(ReadWholeFile("shaders/indirect_shader.vert.spv"),
+                                              ReadWholeFile("shaders/simple_shader.frag.spv"),
+                                              pipelineConfig);
+}
+
+IndirectRenderSystem::ObjectId IndirectRenderSystem::AddObject(std::shared_ptr<IdaModel> model, const glm::mat4& transform) {
+    IO::Assert(
+        model != nullptr && model->GetVertexFormat() == VertexFormat::Float && model->GetLodCount() > 0,
+        "Indirect rendering needs indexed models with float vertices");
+    ObjectId id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    } else {
+        id = static_cast<ObjectId>(idSlots_.size());
+        idSlots_.push_back(0);
+    }
+    idSlots_[id] = static_cast<uint32_t>(objects_.Size());
+    slotIds_.push_back(id);
+
+    Object object{};
+    object.mesh = AcquireMesh(std::move(model));
+    objects_.PushBack(object);
+    SetTransform(id, transform);
+    return id;
+}
+
+void IndirectRenderSystem::SetTransform(ObjectId id, const glm::mat4& transform) {
+    uint32_t slot = idSlots_[id];
+    Object& object = objects_.At(slot);
+    glm::mat4 rows = glm::transpose(transform);
+    std::copy(&rows[0], &rows[3], object.modelRows);
+    object.scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+    objects_.MarkDirty(slot, 1);
+}
+
+void IndirectRenderSystem::RemoveObject(ObjectId id) {
+    uint32_t slot = idSlots_[id];
+    auto last = static_cast<uint32_t>(objects_.Size() - 1);
+    ReleaseMesh(objects_[slot].mesh);
+    // the last object fills the hole, so the table the culling shader walks stays dense
+    if (slot != last) {
+        objects_.Set(slot, objects_[last]);
+        slotIds_[slot] = slotIds_[last];
+        idSlots_[slotIds_[slot]] = slot;
+    }
+    objects_.Resize(last);
+    slotIds_.pop_back();
+    freeIds_.push_back(id);
+}
+
+uint32_t IndirectRenderSystem::AcquireMesh(std::shared_ptr<IdaModel> model) {
+    batchesDirty_ = true;
+    auto it = meshIndices_.find(model.get());
+    if (it != meshIndices_.end()) {
+        meshEntries_[it->second].objectCount++;
+        return it->second;
+    }
+
+    uint32_t mesh;
+    if (!freeMeshes_.empty()) {
+        mesh = freeMeshes_.back();
+        freeMeshes_.pop_back();
+    } else {
+        mesh = static_cast<uint32_t>(meshEntries_.size());
+        meshEntries_.emplace_back();
+        meshes_.PushBack(Mesh{});
+    }
+    meshIndices_.emplace(model.get(), mesh);
+    meshEntries_[mesh] = {std::move(model), 1, false};
+    // culling skips the mesh until UpdateMeshes() finds it resident
+    meshes_.Set(mesh, Mesh{});
+    pendingMeshes_.push_back(mesh);
+    return mesh;
+}
+
+void IndirectRenderSystem::ReleaseMesh(uint32_t mesh) {
+    batchesDirty_ = true;
+    MeshEntry& entry = meshEntries_[mesh];
+    if (--entry.objectCount > 0) {
+        return;
+    }
+    meshIndices_.erase(entry.model.get());
+    entry = MeshEntry{};
+    meshes_.Set(mesh, Mesh{});
+    freeMeshes_.push_back(mesh);
+}
+
+void IndirectRenderSystem::WriteMesh(uint32_t mesh) {
+    const IdaModel& model = *meshEntries_[mesh].model;
+    const IdaModel::Lod& lod = model.GetLods()[0];
+    auto key = std::make_pair(model.GetArenaPage(), model.GetIndexType());
+    auto [it, inserted] = batchIndices_.emplace(key, static_cast<uint32_t>(batches_.size()));
+    if (inserted) {
+        batches_.push_back({key.first, key.second, 0, 0});
+    }
+
+    Mesh data{};
+    data.sphere = glm::vec4(model.GetBoundsCenter(), model.GetBoundsRadius());
+    data.indexCount = lod.indexCount;
+    data.firstIndex = model.GetFirstIndex() + lod.firstIndex;
+    data.vertexOffset = model.GetVertexOffset();
+    data.batch = it->second;
+    meshes_.Set(mesh, data);
+    batchesDirty_ = true;
+}
+
+void IndirectRenderSystem::UpdateMeshes() {
+    auto& arena = *Context::GetInstance().geometryArena;
+    if (arena.GetGeneration() != arenaGeneration_) {
+        // the defragmenter moved geometry, possibly into another page and so another batch
+        arenaGeneration_ = arena.GetGeneration();
+        for (uint32_t mesh = 0; mesh < meshEntries_.size(); mesh++) {
+            if (meshEntries_[mesh].resident) {
+                WriteMesh(mesh);
+            }
+        }
+    }
+
+    auto pending = std::remove_if(pendingMeshes_.begin(), pendingMeshes_.end(), [this](uint32_t mesh) {
+        MeshEntry& entry = meshEntries_[mesh];
+        // released while loading, or listed twice after its slot was reused
+        if (entry.model == nullptr || entry.resident) {
+            return true;
+        }
+        if (!entry.model->IsResident()) {
+            return false;
+        }
+        entry.resident = true;
+        WriteMesh(mesh);
+        return true;
+    });
+    pendingMeshes_.erase(pending, pendingMeshes_.end());
+}
+
+void IndirectRenderSystem::UpdateBatches() {
+    if (!batchesDirty_) {
+        return;
+    }
+    batchesDirty_ = false;
+    // every object of a resident mesh gets a command slot in its batch, culling fills them from the front
+    for (Batch& batch : batches_) {
+        batch.capacity = 0;
+    }
+    for (uint32_t mesh = 0; mesh < meshEntries_.size(); mesh++) {
+        if (meshEntries_[mesh].resident) {
+            batches_[meshes_[mesh].batch].capacity += meshEntries_[mesh].objectCount;
+        }
+    }
+
+    commandCount_ = 0;
+    batchRanges_.Resize(batches_.size());
+    for (uint32_t i = 0; i < batches_.size(); i++) {
+        batches_[i].commandOffset = commandCount_;
+        commandCount_ += batches_[i].capacity;
+        glm::uvec2 range(batches_[i].commandOffset, batches_[i].capacity);
+        if (batchRanges_[i] != range) {
+            batchRanges_.Set(i, range);
+        }
+    }
+}
+
+void IndirectRenderSystem::ReserveCommands() {
+    auto batchCount = static_cast<uint32_t>(batches_.size());
+    if (commandCount_ <= commandCapacity_ && batchCount <= batchCapacity_) {
+        return;
+    }
+    commandCapacity_ = std::max(commandCount_, commandCapacity_ * 2);
+    batchCapacity_ = std::max(batchCount, batchCapacity_ * 2);
+    auto usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    // the old buffers go through the deletion queue, frames in flight keep drawing from them
+    commandBuffer_ = std::make_unique<IdaBuffer>(
+        BufferType::StorageBuffer,
+        DRAW_COMMAND_STRIDE,
+        commandCapacity_,
+        usage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    countBuffer_ = std::make_unique<IdaBuffer>(
+        BufferType::StorageBuffer,
+        COUNT_STRIDE,
+        batchCapacity_,
+        usage,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    commandGeneration_++;
+}
+
+void IndirectRenderSystem::Cull(FrameInfo& frameInfo) {
+    auto& ctx = Context::GetInstance();
+    auto& cmd = frameInfo.commandBuffer;
+    culledObjectCount_ = 0;
+    UpdateMeshes();
+    UpdateBatches();
+    if (commandCount_ == 0) {
+        return;
+    }
+    ReserveCommands();
+
+    // the previous frame may still be drawing from the buffers rewritten below
+    auto readStages = vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexShader;
+    cmd.pipelineBarrier(readStages, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), nullptr, nullptr, nullptr);
+
+    // only changed objects are staged, large scenes stream in over several frames
+    objects_.Sync(cmd, frameInfo.frameAllocator, maxUploadBytes_);
+    meshes_.Sync(cmd, frameInfo.frameAllocator);
+    batchRanges_.Sync(cmd, frameInfo.frameAllocator);
+    UpdateDescriptorSets(frameInfo.frameAllocator);
+    culledObjectCount_ = static_cast<uint32_t>(objects_.GetSyncedSize());
+    if (culledObjectCount_ == 0) {
+        return;
+    }
+
+    cmd.fillBuffer(countBuffer_->GetBuffer(), 0, batches_.size() * COUNT_STRIDE, 0);
+    if (!ctx.features.drawIndirectCount) {
+        // every command slot is drawn, the ones culling leaves untouched must be empty draws
+        cmd.fillBuffer(commandBuffer_->GetBuffer(), 0, commandCount_ * DRAW_COMMAND_STRIDE, 0);
+    }
+    auto toCompute = vk::MemoryBarrier()
+                         .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                         .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), toCompute, nullptr, nullptr);
+
+    IndirectCullUbo ubo{};
+    auto planes = frameInfo.camera.GetFrustumPlanes();
+    std::copy(planes.begin(), planes.end(), ubo.frustumPlanes);
+    ubo.objectCount = culledObjectCount_;
+    cullUboOffset_ = frameInfo.frameAllocator.Push(ubo).dynamicOffset;
+
+    cullPipeline_->Bind(cmd);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout_, 0, objectSet_, cullUboOffset_);
+    uint32_t groups = (culledObjectCount_ + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+    uint32_t groupsX = std::min(groups, MAX_GROUPS_X);
+    cmd.dispatch(groupsX, (groups + groupsX - 1) / groupsX, 1);
+
+    auto toDraw = vk::MemoryBarrier()
+                      .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                      .setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, readStages, vk::DependencyFlags(), toDraw, nullptr, nullptr);
+}
+
+void IndirectRenderSystem::Render(FrameInfo& frameInfo) {
+    drawCount_ = 0;
+    if (culledObjectCount_ == 0) {
+        return;
+    }
+    auto& ctx = Context::GetInstance();
+    auto& cmd = frameInfo.commandBuffer;
+    pipeline_->Bind(cmd);
+    std::vector<vk::DescriptorSet> sets = {frameInfo.globalDescriptorSet, objectSet_};
+    std::vector<uint32_t> dynamicOffsets = {frameInfo.globalUboOffset, cullUboOffset_};
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout_, 0, sets, dynamicOffsets);
+
+    for (uint32_t i = 0; i < batches_.size(); i++) {
+        const Batch& batch = batches_[i];
+        if (batch.capacity == 0) {
+            continue;
+        }
+        ctx.geometryArena->Bind(cmd, batch.page, batch.indexType);
+        vk::DeviceSize offset = batch.commandOffset * DRAW_COMMAND_STRIDE;
+        if (ctx.features.drawIndirectCount) {
+            cmd.drawIndexedIndirectCount(commandBuffer_->GetBuffer(), offset, countBuffer_->GetBuffer(), i * COUNT_STRIDE, batch.capacity, DRAW_COMMAND_STRIDE);
+        } else if (ctx.features.multiDrawIndirect) {
+            cmd.drawIndexedIndirect(commandBuffer_->GetBuffer(), offset, batch.capacity, DRAW_COMMAND_STRIDE);
+        } else {
+            // the only path whose recording grows with the object count
+            for (uint32_t slot = 0; slot < batch.capacity; slot++) {
+                cmd.drawIndexedIndirect(commandBuffer_->GetBuffer(), offset + slot * DRAW_COMMAND_STRIDE, 1, DRAW_COMMAND_STRIDE);
+            }
+        }
+        drawCount_++;
+    }
+}
+
+void IndirectRenderSystem::UpdateDescriptorSets(IdaFrameAllocator& frameAllocator) {
+    std::vector<uint32_t> generations = {
+        objects_.GetGeneration(),
+        meshes_.GetGeneration(),
+        batchRanges_.GetGeneration(),
+        commandGeneration_,
+    };
+    if (descriptorPool_ && generations == setGenerations_) {
+        return;
+    }
+    setGenerations_ = std::move(generations);
+
+    if (descriptorPool_) {
+        // frames in flight still use the old set, so its pool only goes once those have finished
+        Context::GetInstance().deletionQueue->Push([pool = std::shared_ptr<IdaDescriptorPool>(std::move(descriptorPool_))]() {});
+    }
+    descriptorPool_ = IdaDescriptorPool::Builder()
+                          .SetMaxSets(1)
+                          .AddPoolSize(vk::DescriptorType::eStorageBuffer, 5)
+                          .AddPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1)
+                          .Build();
+
+    auto objectInfo = objects_.GetDescriptorInfo();
+    auto meshInfo = meshes_.GetDescriptorInfo();
+    auto batchInfo = batchRanges_.GetDescriptorInfo();
+    auto commandInfo = commandBuffer_->GetDescriptorInfo();
+    auto countInfo = countBuffer_->GetDescriptorInfo();
+    auto cullUboInfo = frameAllocator.GetDescriptorInfo(sizeof(IndirectCullUbo));
+    IdaDescriptorWriter(*objectSetLayout_, *descriptorPool_)
+        .WriteBuffer(0, &objectInfo)
+        .WriteBuffer(1, &meshInfo)
+        .WriteBuffer(2, &batchInfo)
+        .WriteBuffer(3, &commandInfo)
+        .WriteBuffer(4, &countInfo)
+        .WriteBuffer(5, &cullUboInfo)
+        .Build(objectSet_);
+}
+} // namespace ida
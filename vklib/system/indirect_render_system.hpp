@@ -0,0 +1,142 @@
+#ifndef VULKAN_LIB_INDIRECT_RENDER_SYSTEM_HPP
+#define VULKAN_LIB_INDIRECT_RENDER_SYSTEM_HPP
+
+#include "vulkan/vulkan.hpp"
+
+#include "global_info.hpp"
+#include "buffer/gpu_vector.hpp"
+#include "descriptor/descriptors.hpp"
+#include "render/pipeline.hpp"
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ida {
+/**
+ * GPU driven renderer for large numbers of static or rarely moving objects.
+ *
+ * Objects are registered once with AddObject() and live in a device local table next to a table
+ * of the models they draw, so recording a frame does not touch them: only objects whose transform
+ * changed are uploaded, at most maxUploadBytes per frame, which streams large scenes in over a few
+ * frames. Cull() runs indirect_cull.comp before the render pass, one invocation per object tests
+ * its bounding sphere against the frustum and appends a drawIndexed of the model to the command
+ * range of its batch (the models sharing an arena page and index type). Render() then draws each
+ * batch with drawIndexedIndirectCount, or over the whole batch capacity with the unused commands
+ * zeroed when the device lacks it, as software implementations may. The CPU cost per frame only
+ * grows with the number of models, batches and changed objects.
+ *
+ * Models must use VertexFormat::Float and an index buffer, and are drawn at their first level of
+ * detail. They may still be loading when added, their objects are drawn once they are resident.
+ */
+class IndirectRenderSystem {
+  public:
+    using ObjectId = uint32_t;
+
+    static constexpr vk::DeviceSize DEFAULT_MAX_UPLOAD_BYTES = 256ull * 1024;
+
+    IndirectRenderSystem(vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout);
+    ~IndirectRenderSystem();
+    IndirectRenderSystem(const IndirectRenderSystem&) = delete;
+    IndirectRenderSystem& operator=(const IndirectRenderSystem&) = delete;
+
+    ObjectId AddObject(std::shared_ptr<IdaModel> model, const glm::mat4& transform);
+    void SetTransform(ObjectId id, const glm::mat4& transform);
+    void RemoveObject(ObjectId id);
+    uint32_t GetObjectCount() const { return static_cast<uint32_t>(objects_.Size()); }
+
+    // Records the culling dispatch, must be called outside the render pass
+    void Cull(FrameInfo& frameInfo);
+    // Draws what the last Cull() of this frame kept
+    void Render(FrameInfo& frameInfo);
+
+    // bytes of the frame allocator the object table may stage per frame
+    void SetMaxUploadBytes(vk::DeviceSize bytes) { maxUploadBytes_ = bytes; }
+    // indirect draw calls recorded in the last frame, one per non empty batch
+    uint32_t GetDrawCount() const { return drawCount_; }
+
+  private:
+    // std430 layout of the Object struct in the indirect shaders
+    struct Object {
+        glm::vec4 modelRows[3]; // rows of the affine model matrix
+        uint32_t mesh = 0;
+        float scale = 1.0f; // largest axis of the transform scale
+        uint32_t padding[2]{};
+    };
+    // std430 layout of the Mesh struct in indirect_cull.comp
+    struct Mesh {
+        glm::vec4 sphere{0.0f}; // model space center, radius
+        uint32_t indexCount = 0; // 0 while the model is not resident
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        uint32_t batch = 0;
+    };
+    struct MeshEntry {
+        std::shared_ptr<IdaModel> model;
+        uint32_t objectCount = 0;
+        bool resident = false;
+    };
+    struct Batch {
+        uint32_t page = 0;
+        vk::IndexType indexType = vk::IndexType::eUint32;
+        uint32_t commandOffset = 0;
+        uint32_t capacity = 0;
+    };
+
+    uint32_t AcquireMesh(std::shared_ptr<IdaModel> model);
+    void ReleaseMesh(uint32_t mesh);
+    void WriteMesh(uint32_t mesh);
+    void UpdateMeshes();
+    void UpdateBatches();
+    void ReserveCommands();
+    void UpdateDescriptorSets(IdaFrameAllocator& frameAllocator);
+
+    void CreatePipelineLayouts(vk::DescriptorSetLayout globalSetLayout);
+    void CreatePipelines(vk::RenderPass renderPass);
+
+    std::unique_ptr<IdaComputePipeline> cullPipeline_;
+    std::unique_ptr<IdaPipeline> pipeline_;
+    vk::PipelineLayout cullPipelineLayout_;
+    vk::PipelineLayout pipelineLayout_;
+
+    // objects are kept dense, ids map to their slot and back
+    IdaGpuVector<Object> objects_;
+    std::vector<ObjectId> slotIds_;
+    std::vector<uint32_t> idSlots_;
+    std::vector<ObjectId> freeIds_;
+
+    IdaGpuVector<Mesh> meshes_;
+    std::vector<MeshEntry> meshEntries_;
+    std::unordered_map<const IdaModel*, uint32_t> meshIndices_;
+    std::vector<uint32_t> freeMeshes_;
+    std::vector<uint32_t> pendingMeshes_;
+    uint32_t arenaGeneration_ = 0;
+
+    // (commandOffset, capacity) per batch on the GPU
+    IdaGpuVector<glm::uvec2> batchRanges_;
+    std::vector<Batch> batches_;
+    std::map<std::pair<uint32_t, vk::IndexType>, uint32_t> batchIndices_;
+    bool batchesDirty_ = false;
+    uint32_t commandCount_ = 0;
+
+    // written by the culling shader, grown with commandGeneration_
+    std::unique_ptr<IdaBuffer> commandBuffer_;
+    std::unique_ptr<IdaBuffer> countBuffer_;
+    uint32_t commandCapacity_ = 0;
+    uint32_t batchCapacity_ = 0;
+    uint32_t commandGeneration_ = 0;
+    uint32_t cullUboOffset_ = 0;
+    uint32_t culledObjectCount_ = 0;
+    uint32_t drawCount_ = 0;
+    vk::DeviceSize maxUploadBytes_ = DEFAULT_MAX_UPLOAD_BYTES;
+
+    // rebuilt, together with their pool, whenever a buffer they point at is replaced
+    std::unique_ptr<IdaDescriptorSetLayout> objectSetLayout_;
+    std::unique_ptr<IdaDescriptorPool> descriptorPool_;
+    vk::DescriptorSet objectSet_;
+    std::vector<uint32_t> setGenerations_;
+};
+} // namespace ida
+
+#endif // VULKAN_LIB_INDIRECT_RENDER_SYSTEM_HPP
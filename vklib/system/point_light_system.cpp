@@ -7,8 +7,6 @@
 #include "glm/gtc/constants.hpp"
 #include "glm/gtx/rotate_vector.hpp"
 
-#include <map>
-
 namespace ida {
 struct PointLightPushConstants {
     glm::vec4 position;
@@ -44,23 +42,30 @@ void PointLightSystem::Update(FrameInfo& frameInfo, GlobalUbo& globalUbo) {
 }
 
 void PointLightSystem::Render(FrameInfo& frameInfo) {
-    std::map<float, IdaGameObject::id_t> sorted;
+    // the billboards blend, so they go through the transparent pass, farthest first
+    renderQueue_.Clear();
+    lights_.clear();
     for (auto& kv : frameInfo.gameObjects) {
         auto& obj = kv.second;
         if (obj.pointLight == nullptr)
             continue;
-        auto offset = frameInfo.camera.GetPosition() - obj.transform.translation;
-        float disSquared = glm::dot(offset, offset);
-        sorted[disSquared] = obj.GetId();
+        float distance = glm::length(frameInfo.camera.GetPosition() - obj.transform.translation);
+        RenderPacket packet{};
+        packet.key = renderQueue_.MakeKey(DrawPass::Transparent, 0, 0, 0, distance);
+        packet.object = static_cast<uint32_t>(lights_.size());
+        renderQueue_.Submit(packet);
+        lights_.push_back(&obj);
     }
+    renderQueue_.Sort();
+
     pipeline_->Bind(frameInfo.commandBuffer);
     frameInfo.commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                                                pipelineLayout_,
                                                0,
                                                frameInfo.globalDescriptorSet,
-                                               nullptr);
-    for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-        auto& obj = frameInfo.gameObjects.at(it->second);
+                                               frameInfo.globalUboOffset);
+    for (const RenderPacket& packet : renderQueue_.GetPackets()) {
+        auto& obj = *lights_[packet.object];
         PointLightPushConstants pushConstants{};
         pushConstants.position = glm::vec4(obj.transform.translation, 1.f);
         pushConstants.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
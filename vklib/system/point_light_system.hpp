@@ -5,6 +5,9 @@
 
 #include "global_info.hpp"
 #include "render/pipeline.hpp"
+#include "render/render_queue.hpp"
+
+#include <vector>
 
 namespace ida {
 class PointLightSystem {
@@ -23,6 +26,9 @@ class PointLightSystem {
 
     std::unique_ptr<IdaPipeline> pipeline_;
     vk::PipelineLayout pipelineLayout_;
+
+    IdaRenderQueue renderQueue_;
+    std::vector<IdaGameObject*> lights_;
 };
 } // namespace ida
 
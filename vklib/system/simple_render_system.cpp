@@ -6,16 +6,51 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/constants.hpp"
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 
 namespace ida {
+// no longer pushed per object, the range stays because simple_shader.frag declares the block
 struct SimplePushConstantData {
     glm::mat4 modelMatrix{1.f};
     glm::mat4 normalMatrix{1.f};
 };
 
+// Per instance attributes of the instanced simple shaders, at binding 1
+struct SimpleInstanceData {
+    glm::mat4 modelMatrix{1.f};
+    glm::mat4 normalMatrix{1.f};
+};
+
+namespace {
+constexpr uint32_t INSTANCE_BINDING = 1;
+constexpr uint32_t INSTANCE_LOCATION = 4;
+constexpr uint32_t MIN_INSTANCE_CAPACITY = 256;
+// pipeline ids in the render queue keys
+constexpr uint32_t FLOAT_PIPELINE = 0;
+constexpr uint32_t PACKED_PIPELINE = 1;
+
+void AddInstanceInput(PipelineConfigInfo& config) {
+    config.bindingDescriptions.push_back({INSTANCE_BINDING, sizeof(SimpleInstanceData), vk::VertexInputRate::eInstance});
+    // each mat4 attribute takes one location per column, 4 to 7 for the model and 8 to 11 for the normal matrix
+    for (uint32_t column = 0; column < 8; column++) {
+        config.attributeDescriptions.push_back(
+            {INSTANCE_LOCATION + column, INSTANCE_BINDING, vk::Format::eR32G32B32A32Sfloat, column * static_cast<uint32_t>(sizeof(glm::vec4))});
+    }
+}
+
+// Mesh field of a render queue key: arena page and index type first so geometry binds are grouped,
+// then the model and its level. Ids past the field width only cost instancing, never correctness.
+uint32_t MeshKey(const IdaModel& model, uint32_t modelId, uint32_t lod) {
+    uint32_t indexType = model.GetIndexType() == vk::IndexType::eUint16 ? 1 : 0;
+    return (model.GetArenaPage() & 0x3F) << 18 | indexType << 17 | (modelId & 0x3FFF) << 3 | (lod & 0x7);
+}
+} // namespace
+
 SimpleRenderSystem::SimpleRenderSystem(vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout) {
     CreatePipelineLayout(globalSetLayout);
     CreatePipeline(renderPass);
@@ -43,35 +78,164 @@ void SimpleRenderSystem::CreatePipeline(vk::RenderPass renderPass) {
     IdaPipeline::DefaultPipelineConfigInfo(pipelineConfig);
     pipelineConfig.renderPass = renderPass;
     pipelineConfig.pipelineLayout = pipelineLayout_;
-    pipeline_ = std::make_unique<IdaPipeline>(ReadWholeFile("shaders/simple_shader.vert.spv"),
+    AddInstanceInput(pipelineConfig);
+    pipeline_ = std::make_unique<IdaPipeline>(ReadWholeFile("shaders/simple_shader_instanced.vert.spv"),
                                                  ReadWholeFile("shaders/simple_shader.frag.spv"),
                                                  pipelineConfig);
+
+    pipelineConfig.bindingDescriptions = IdaModel::PackedVertex::GetBindingDescriptions();
+    pipelineConfig.attributeDescriptions = IdaModel::PackedVertex::GetAttributeDescriptions();
+    AddInstanceInput(pipelineConfig);
+    packedPipeline_ = std::make_unique<IdaPipeline>(ReadWholeFile("shaders/simple_shader_packed_instanced.vert.spv"),
+                                                       ReadWholeFile("shaders/simple_shader.frag.spv"),
+                                                       pipelineConfig);
 }
 
 void SimpleRenderSystem::RenderGameObjects(FrameInfo& frameInfo) {
     auto& cmd = frameInfo.commandBuffer;
+    CullObjects(frameInfo);
+    SelectLods(frameInfo);
+    drawCount_ = 0;
+    if (drawItems_.empty()) {
+        return;
+    }
+    // opaque packets sort by pipeline, geometry and model, then front to back, so objects drawing the
+    // same level of the same model end up next to each other and are replayed as one instanced draw
+    renderQueue_.Clear();
+    modelIds_.clear();
+    for (uint32_t i = 0; i < drawItems_.size(); i++) {
+        const DrawItem& item = drawItems_[i];
+        IdaModel& model = *item.object->model;
+        bool packed = model.GetVertexFormat() == VertexFormat::Packed;
+        auto modelId = modelIds_.emplace(&model, static_cast<uint32_t>(modelIds_.size())).first->second;
+        RenderPacket packet{};
+        packet.key = renderQueue_.MakeKey(DrawPass::Opaque, packed ? PACKED_PIPELINE : FLOAT_PIPELINE, 0, MeshKey(model, modelId, item.lod), item.distance);
+        packet.pipeline = packed ? packedPipeline_.get() : pipeline_.get();
+        packet.model = &model;
+        packet.lod = item.lod;
+        packet.object = i;
+        renderQueue_.Submit(packet);
+    }
+    renderQueue_.Sort();
+    WriteInstances(frameInfo);
 
-    pipeline_->Bind(cmd);
+    // both pipelines share the layout, so the descriptor set stays bound across their binds
     cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                            pipelineLayout_,
                            0,
                            frameInfo.globalDescriptorSet,
-                           nullptr);
+                           frameInfo.globalUboOffset);
+    vk::Buffer instanceBuffer = instanceBuffers_[frameInfo.frameIndex]->GetBuffer();
+    vk::DeviceSize instanceOffset = 0;
+    cmd.bindVertexBuffers(INSTANCE_BINDING, 1, &instanceBuffer, &instanceOffset);
+    renderQueue_.Replay(cmd);
+    drawCount_ = renderQueue_.GetDrawCount();
+}
+
+void SimpleRenderSystem::WriteInstances(FrameInfo& frameInfo) {
+    auto& buffer = instanceBuffers_[frameInfo.frameIndex];
+    auto count = static_cast<uint32_t>(drawItems_.size());
+    if (!buffer || buffer->GetInstanceCount() < count) {
+        // the replaced buffer may still be read by an earlier submission, IdaBuffer destroys it deferred
+        uint32_t capacity = std::max(MIN_INSTANCE_CAPACITY, std::bit_ceil(count));
+        buffer = std::make_unique<IdaBuffer>(BufferType::VertexBuffer,
+                                             sizeof(SimpleInstanceData),
+                                             capacity,
+                                             vk::BufferUsageFlagBits::eVertexBuffer,
+                                             vk::MemoryPropertyFlagBits::eHostVisible);
+        buffer->Map();
+    }
+
+    // in sorted packet order, the queue draws packet i as instance i
+    auto* instances = static_cast<SimpleInstanceData*>(buffer->GetMappedMemory());
+    const auto& packets = renderQueue_.GetPackets();
+    for (uint32_t i = 0; i < count; i++) {
+        const DrawItem& item = drawItems_[packets[i].object];
+        instances[i].modelMatrix = item.transform * item.object->model->GetDequantizeMatrix();
+        // normals are decoded to unit vectors, so the dequantize scale must not reach them
+        instances[i].normalMatrix = glm::transpose(glm::inverse(item.transform));
+    }
+    buffer->Flush(sizeof(SimpleInstanceData) * count);
+}
+
+void SimpleRenderSystem::CullObjects(FrameInfo& frameInfo) {
+    drawItems_.clear();
+    culler_.Clear();
     for (auto& gameObject : frameInfo.gameObjects) {
         auto& obj = gameObject.second;
-        if(obj.model == nullptr) {
+        // meshlet models are culled and drawn by ClusterRenderSystem
+        if (obj.model == nullptr || !obj.model->IsResident() || obj.model->HasMeshlets()) {
             continue;
         }
-        SimplePushConstantData push{};
-        push.modelMatrix = obj.transform.mat4();
-        push.normalMatrix = glm::transpose(glm::inverse(push.modelMatrix));
-        cmd.pushConstants<SimplePushConstantData>(pipelineLayout_,
-                                                  vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
-                                                  0,
-                                                  push);
-        obj.model->Bind(cmd);
-        obj.model->Draw(cmd);
+        drawItems_.push_back({&obj, obj.transform.mat4(), 0, 0.0f, 0.0f});
+        culler_.Add(drawItems_.back().transform, obj.model->GetBoundsMin(), obj.model->GetBoundsMax(), obj.model->GetBoundsRadius());
+    }
+    if (frustumCulling_) {
+        // the whole batch at once, before anything is recorded
+        culler_.Cull(frameInfo.camera.GetFrustumPlanes());
+        size_t visible = 0;
+        for (size_t i = 0; i < drawItems_.size(); i++) {
+            if (culler_.IsVisible(static_cast<uint32_t>(i))) {
+                drawItems_[visible++] = drawItems_[i];
+            }
+        }
+        drawItems_.resize(visible);
+    }
+    visibleCount_ = static_cast<uint32_t>(drawItems_.size());
+    culledCount_ = culler_.GetCount() - visibleCount_;
+}
+
+void SimpleRenderSystem::SelectLods(FrameInfo& frameInfo) {
+    glm::vec3 cameraPosition = frameInfo.camera.GetPosition();
+    float threshold = lodThreshold_ * std::exp2(lodBias_);
+    uint32_t triangles = 0;
+    for (auto& item : drawItems_) {
+        auto& obj = *item.object;
+        glm::vec3 scale = glm::abs(obj.transform.scale);
+        item.scale = std::max({scale.x, scale.y, scale.z});
+        glm::vec3 center = glm::vec3(item.transform * glm::vec4(obj.model->GetBoundsCenter(), 1.0f));
+        item.distance = std::max(glm::length(center - cameraPosition) - obj.model->GetBoundsRadius() * item.scale, 0.0f);
+        // the coarsest level within the threshold, levels go from fine to coarse
+        for (uint32_t lod = obj.model->GetLodCount(); lod-- > 1;) {
+            if (ProjectError(frameInfo, item, lod) <= threshold) {
+                item.lod = lod;
+                break;
+            }
+        }
+        triangles += obj.model->GetTriangleCount(item.lod);
+    }
+
+    if (triangleBudget_ > 0 && triangles > triangleBudget_) {
+        // min heap of the error every object would show one level coarser
+        using Candidate = std::pair<float, size_t>;
+        auto greater = [](const Candidate& a, const Candidate& b) { return a.first > b.first; };
+        std::vector<Candidate> heap;
+        for (size_t i = 0; i < drawItems_.size(); i++) {
+            const DrawItem& item = drawItems_[i];
+            if (item.lod + 1 < item.object->model->GetLodCount()) {
+                heap.emplace_back(ProjectError(frameInfo, item, item.lod + 1), i);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), greater);
+        while (triangles > triangleBudget_ && !heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            DrawItem& item = drawItems_[heap.back().second];
+            heap.pop_back();
+            auto& model = item.object->model;
+            triangles -= model->GetTriangleCount(item.lod) - model->GetTriangleCount(item.lod + 1);
+            item.lod++;
+            if (item.lod + 1 < model->GetLodCount()) {
+                heap.emplace_back(ProjectError(frameInfo, item, item.lod + 1), static_cast<size_t>(&item - drawItems_.data()));
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        }
     }
+    triangleCount_ = triangles;
+}
+
+float SimpleRenderSystem::ProjectError(const FrameInfo& frameInfo, const DrawItem& item, uint32_t lod) const {
+    float error = item.object->model->GetLods()[lod].error * item.scale;
+    return frameInfo.camera.ProjectLength(error, item.distance, static_cast<float>(frameInfo.extent.height));
 }
 
-} // namespace ida
\ No newline at end of file
+} // namespace ida
@@ -4,9 +4,24 @@
 #include "vulkan/vulkan.hpp"
 
 #include "global_info.hpp"
+#include "buffer/buffer.hpp"
+#include "render/frustum_culler.hpp"
 #include "render/pipeline.hpp"
+#include "render/render_queue.hpp"
+#include "swapchain/swapchain.hpp"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace ida {
+/**
+ * Draws every resident model without meshlets. Objects are frustum culled, get their level of
+ * detail and are submitted to a render queue, whose sorted replay draws the ones sharing the same
+ * level of the same model with one instanced call, their matrices coming from a per-frame instance
+ * buffer.
+ */
 class SimpleRenderSystem {
   public:
     SimpleRenderSystem(vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout);
@@ -16,12 +31,63 @@ class SimpleRenderSystem {
 
     void RenderGameObjects(FrameInfo &frameInfo);
 
+    // Levels are picked so their simplification error projects to at most this many pixels
+    void SetLodThreshold(float pixels) { lodThreshold_ = pixels; }
+    // Every +1 doubles the tolerated error, i.e. picks coarser levels, negative values finer ones
+    void SetLodBias(float bias) { lodBias_ = bias; }
+    // Triangles drawn per frame, once exceeded the objects whose next level adds the least
+    // projected error are coarsened first. 0 disables the budget.
+    void SetTriangleBudget(uint32_t triangles) { triangleBudget_ = triangles; }
+    uint32_t GetTriangleCount() const { return triangleCount_; }
+
+    // Tests every object's bounds against the camera frustum before recording, on by default
+    void SetFrustumCulling(bool enabled) { frustumCulling_ = enabled; }
+    // objects drawn and skipped by culling in the last frame
+    uint32_t GetVisibleCount() const { return visibleCount_; }
+    uint32_t GetCulledCount() const { return culledCount_; }
+    // instanced draw calls recorded in the last frame
+    uint32_t GetDrawCount() const { return drawCount_; }
+
   private:
+    struct DrawItem {
+        IdaGameObject *object;
+        glm::mat4 transform;
+        uint32_t lod;
+        float scale;    // largest axis of the transform scale
+        float distance; // from the camera to the bounding sphere
+    };
+
+    void CullObjects(FrameInfo &frameInfo);
+    void SelectLods(FrameInfo &frameInfo);
+    void WriteInstances(FrameInfo &frameInfo);
+    float ProjectError(const FrameInfo &frameInfo, const DrawItem &item, uint32_t lod) const;
+
     void CreatePipelineLayout(vk::DescriptorSetLayout globalSetLayout);
     void CreatePipeline(vk::RenderPass renderPass);
 
     std::unique_ptr<IdaPipeline> pipeline_;
+    // same shading for IdaModel::PackedVertex, dequantized in the vertex shader
+    std::unique_ptr<IdaPipeline> packedPipeline_;
     vk::PipelineLayout pipelineLayout_;
+
+    float lodThreshold_ = 1.0f;
+    float lodBias_ = 0.0f;
+    uint32_t triangleBudget_ = 0;
+    uint32_t triangleCount_ = 0;
+    std::vector<DrawItem> drawItems_;
+
+    IdaFrustumCuller culler_;
+    bool frustumCulling_ = true;
+    uint32_t visibleCount_ = 0;
+    uint32_t culledCount_ = 0;
+
+    // host visible, grown to the next power of two when a frame needs more instances
+    std::array<std::unique_ptr<IdaBuffer>, IdaSwapChain::MAX_FRAMES_IN_FLIGHT> instanceBuffers_;
+    uint32_t drawCount_ = 0;
+
+    IdaRenderQueue renderQueue_;
+    // frame local ids of the models in the queue keys
+    std::unordered_map<const IdaModel *, uint32_t> modelIds_;
 };
 }
 
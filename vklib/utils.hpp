@@ -1,6 +1,9 @@
 #ifndef VULKAN_LIB_UTILS_HPP
 #define VULKAN_LIB_UTILS_HPP
 
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace ida {
@@ -11,6 +14,80 @@ void hashCombine(std::size_t& seed, const T& v, const Rest&... rest) {
     (hashCombine(seed, rest), ...);
 };
 
+// xxHash64 (https://github.com/Cyan4973/xxHash), fast enough to fingerprint files at memory bandwidth
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+    constexpr uint64_t PRIME1 = 11400714785074694791ull;
+    constexpr uint64_t PRIME2 = 14029467366897019727ull;
+    constexpr uint64_t PRIME3 = 1609587929392839161ull;
+    constexpr uint64_t PRIME4 = 9650029242287828579ull;
+    constexpr uint64_t PRIME5 = 2870177450012600261ull;
+
+    auto read64 = [](const uint8_t* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    };
+    auto read32 = [](const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    };
+    auto round = [](uint64_t acc, uint64_t input) {
+        acc += input * PRIME2;
+        return std::rotl(acc, 31) * PRIME1;
+    };
+    auto merge = [&round](uint64_t acc, uint64_t value) {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    };
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t hash;
+    if (size >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        hash = merge(hash, v1);
+        hash = merge(hash, v2);
+        hash = merge(hash, v3);
+        hash = merge(hash, v4);
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += size;
+
+    for (; end - p >= 8; p += 8) {
+        hash ^= round(0, read64(p));
+        hash = std::rotl(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (end - p >= 4) {
+        hash ^= read32(p) * PRIME1;
+        hash = std::rotl(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= *p * PRIME5;
+        hash = std::rotl(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
 } // namespace ida
 
 #endif // VULKAN_LIB_UTILS_HPP